@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/flat_hash_map.h"
+#include "../src/tagged.h"
+
+/*
+ *  Сравнение util::FlatHashMap и std::unordered_map на ключах, устроенных как
+ *  идентификаторы собак и игроков: Tagged<uint64_t> со значениями shared_ptr.
+ *  Для каждого размера измеряются вставка, поиск существующих ключей,
+ *  поиск отсутствующих ключей и удаление; время выводится в наносекундах на операцию.
+ */
+
+namespace {
+
+struct IdTag {};
+using Id = util::Tagged<uint64_t, IdTag>;
+using Hasher = util::TaggedHasher<Id>;
+using ValuePtr = std::shared_ptr<int>;
+
+using Clock = std::chrono::steady_clock;
+
+template <typename Fn>
+double MeasureNsPerOp(size_t ops, Fn&& fn) {
+    const auto start = Clock::now();
+    fn();
+    const auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start);
+    return elapsed.count() / static_cast<double>(ops);
+}
+
+struct Result {
+    double insert;
+    double find_hit;
+    double find_miss;
+    double erase;
+};
+
+template <typename Map>
+Result Run(const std::vector<uint64_t>& keys, const std::vector<uint64_t>& lookups) {
+    Result result{};
+    Map map;
+    const auto value = std::make_shared<int>(0);
+
+    result.insert = MeasureNsPerOp(keys.size(), [&] {
+        for (uint64_t key : keys) {
+            map.emplace(Id{key}, value);
+        }
+    });
+
+    size_t found = 0;
+    result.find_hit = MeasureNsPerOp(lookups.size(), [&] {
+        for (uint64_t key : lookups) {
+            found += map.find(Id{key}) != map.end();
+        }
+    });
+
+    result.find_miss = MeasureNsPerOp(lookups.size(), [&] {
+        for (uint64_t key : lookups) {
+            // Ключи вставлялись чётными
+            found += map.find(Id{key + 1}) != map.end();
+        }
+    });
+
+    result.erase = MeasureNsPerOp(keys.size(), [&] {
+        for (uint64_t key : keys) {
+            map.erase(Id{key});
+        }
+    });
+
+    if (found != lookups.size() || !map.empty()) {
+        std::cerr << "Unexpected map state" << std::endl;
+    }
+    return result;
+}
+
+void Print(std::string_view name, size_t size, const Result& result) {
+    std::cout << std::left << std::setw(20) << name << std::right
+              << std::setw(10) << size
+              << std::fixed << std::setprecision(1)
+              << std::setw(12) << result.insert
+              << std::setw(12) << result.find_hit
+              << std::setw(12) << result.find_miss
+              << std::setw(12) << result.erase << '\n';
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937_64 random{2024};
+
+    std::cout << std::left << std::setw(20) << "map" << std::right
+              << std::setw(10) << "size"
+              << std::setw(12) << "insert,ns"
+              << std::setw(12) << "hit,ns"
+              << std::setw(12) << "miss,ns"
+              << std::setw(12) << "erase,ns" << '\n';
+
+    for (size_t size : {10'000, 100'000, 1'000'000}) {
+        // Идентификаторы выдаются подряд, но их порядок в запросах случаен
+        std::vector<uint64_t> keys(size);
+        std::iota(keys.begin(), keys.end(), 0);
+        for (auto& key : keys) {
+            key *= 2;
+        }
+        std::shuffle(keys.begin(), keys.end(), random);
+
+        std::vector<uint64_t> lookups(keys);
+        std::shuffle(lookups.begin(), lookups.end(), random);
+
+        Print("std::unordered_map", size, Run<std::unordered_map<Id, ValuePtr, Hasher>>(keys, lookups));
+        Print("util::FlatHashMap", size, Run<util::FlatHashMap<Id, ValuePtr, Hasher>>(keys, lookups));
+    }
+    return 0;
+}
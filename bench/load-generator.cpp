@@ -0,0 +1,391 @@
+#include "../src/sdk.h"
+//
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/json.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/prng.h"
+
+/*
+ *  Нагрузочный генератор с замкнутым циклом.
+ *  Каждый виртуальный игрок входит в игру, а затем по своему keep-alive соединению
+ *  отправляет следующий запрос только после ответа на предыдущий: действие
+ *  с вероятностью --action-share, иначе опрос состояния.
+ *  По окончании печатает пропускную способность и задержки p50/p99/p999 по каждому методу API.
+ */
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace json = boost::json;
+namespace po = boost::program_options;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct CommandLineArgs {
+    std::string host = "127.0.0.1"s;
+    std::string port = "8080"s;
+    std::string map_id;
+    size_t players = 100;
+    int duration = 10;
+    double action_share = 0.2;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    bool json_output = false;
+};
+
+std::optional<CommandLineArgs> ParseCommandLine(int argc, const char* argv[]) {
+    po::options_description desc("Allowed options");
+
+    CommandLineArgs args;
+    desc.add_options()
+        ("help,h", "produced help message")
+        ("host", po::value(&args.host)->value_name("address"s), "server address (127.0.0.1 by default)")
+        ("port,p", po::value(&args.port)->value_name("port"s), "server port (8080 by default)")
+        ("map,m", po::value(&args.map_id)->value_name("id"s), "map to join (first map by default)")
+        ("players,n", po::value(&args.players)->value_name("count"s), "number of virtual players (100 by default)")
+        ("duration,d", po::value(&args.duration)->value_name("seconds"s), "load duration after all players joined (10 by default)")
+        ("action-share,a", po::value(&args.action_share)->value_name("ratio"s), "share of action requests, the rest are state polls (0.2 by default)")
+        ("threads,t", po::value(&args.threads)->value_name("count"s), "client threads (all cores by default)")
+        ("json", "print the report as JSON");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.contains("help"s)) {
+        std::cout << desc;
+        return std::nullopt;
+    }
+    if (args.players == 0 || args.duration <= 0 || args.action_share < 0.0 || args.action_share > 1.0) {
+        throw std::runtime_error("Invalid load parameters"s);
+    }
+    args.threads = std::max(1u, args.threads);
+    args.json_output = vm.contains("json"s);
+    return args;
+}
+
+enum class Endpoint {
+    JOIN,
+    ACTION,
+    STATE
+};
+
+constexpr size_t ENDPOINT_COUNT = 3;
+constexpr std::array<std::string_view, ENDPOINT_COUNT> ENDPOINT_NAMES = {
+    "/api/v1/game/join"sv,
+    "/api/v1/game/player/action"sv,
+    "/api/v1/game/state"sv
+};
+constexpr std::array<std::string_view, 5> MOVES = {"L"sv, "R"sv, "U"sv, "D"sv, ""sv};
+
+using Request = http::request<http::string_body>;
+using Response = http::response<http::string_body>;
+
+struct EndpointStats {
+    // Задержки в микросекундах
+    std::vector<uint32_t> latencies;
+    size_t errors = 0;
+};
+
+using Stats = std::array<EndpointStats, ENDPOINT_COUNT>;
+
+// Один игрок со своим соединением. Все обработчики выполняются на strand соединения
+class VirtualPlayer : public std::enable_shared_from_this<VirtualPlayer> {
+public:
+    VirtualPlayer(net::io_context& ioc, const CommandLineArgs& args, size_t index, std::atomic<size_t>& joined)
+        : stream_(net::make_strand(ioc))
+        , args_(args)
+        , index_(index)
+        , random_(index)
+        , joined_(joined) {
+    }
+
+    void Start(const tcp::resolver::results_type& endpoints) {
+        stream_.async_connect(endpoints, beast::bind_front_handler(&VirtualPlayer::OnConnect, shared_from_this()));
+    }
+
+    // Момент окончания нагрузки становится известен, когда вошли все игроки
+    void SetDeadline(Clock::time_point deadline) {
+        net::post(stream_.get_executor(), [self = shared_from_this(), deadline] {
+            self->deadline_ = deadline;
+            self->started_ = true;
+            if (self->idle_) {
+                self->idle_ = false;
+                self->SendNext();
+            }
+        });
+    }
+
+    const Stats& GetStats() const noexcept {
+        return stats_;
+    }
+
+private:
+    void OnConnect(beast::error_code ec, [[maybe_unused]] const tcp::endpoint& endpoint) {
+        if (ec) {
+            return Fail(Endpoint::JOIN);
+        }
+
+        json::object body{{"userName", "bot"s + std::to_string(index_)}, {"mapId", args_.map_id}};
+        Send(Endpoint::JOIN, MakeRequest(http::verb::post, ENDPOINT_NAMES[0], json::serialize(body)));
+    }
+
+    void SendNext() {
+        if (Clock::now() >= deadline_) {
+            beast::error_code ec;
+            stream_.socket().shutdown(tcp::socket::shutdown_both, ec);
+            return;
+        }
+
+        if (std::bernoulli_distribution(args_.action_share)(random_)) {
+            const auto move = MOVES[std::uniform_int_distribution<size_t>(0, MOVES.size() - 1)(random_)];
+            json::object body{{"move", move}};
+            Send(Endpoint::ACTION, MakeRequest(http::verb::post, ENDPOINT_NAMES[1], json::serialize(body)));
+        } else {
+            Send(Endpoint::STATE, MakeRequest(http::verb::get, ENDPOINT_NAMES[2], {}));
+        }
+    }
+
+    Request MakeRequest(http::verb method, std::string_view target, std::string body) const {
+        Request request{method, target, 11};
+        request.set(http::field::host, args_.host);
+        request.keep_alive(true);
+        if (!token_.empty()) {
+            request.set(http::field::authorization, "Bearer "s + token_);
+        }
+        if (method == http::verb::post) {
+            request.set(http::field::content_type, "application/json"sv);
+            request.body() = std::move(body);
+        }
+        request.prepare_payload();
+        return request;
+    }
+
+    void Send(Endpoint endpoint, Request request) {
+        endpoint_ = endpoint;
+        request_ = std::move(request);
+        sent_at_ = Clock::now();
+        http::async_write(stream_, request_, beast::bind_front_handler(&VirtualPlayer::OnWrite, shared_from_this()));
+    }
+
+    void OnWrite(beast::error_code ec, [[maybe_unused]] size_t bytes_written) {
+        if (ec) {
+            return Fail(endpoint_);
+        }
+        response_ = {};
+        http::async_read(stream_, buffer_, response_, beast::bind_front_handler(&VirtualPlayer::OnRead, shared_from_this()));
+    }
+
+    void OnRead(beast::error_code ec, [[maybe_unused]] size_t bytes_read) {
+        if (ec) {
+            return Fail(endpoint_);
+        }
+
+        auto& stats = stats_[static_cast<size_t>(endpoint_)];
+        const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - sent_at_);
+        stats.latencies.push_back(static_cast<uint32_t>(std::min<int64_t>(latency.count(), UINT32_MAX)));
+        if (response_.result() != http::status::ok) {
+            ++stats.errors;
+        }
+
+        if (endpoint_ == Endpoint::JOIN) {
+            if (response_.result() != http::status::ok) {
+                return Fail(Endpoint::JOIN, false);
+            }
+            token_ = json::parse(response_.body()).at("authToken").get_string();
+            ++joined_;
+            // Ждём, пока войдут остальные игроки
+            if (!started_) {
+                idle_ = true;
+                return;
+            }
+        }
+        SendNext();
+    }
+
+    // Игрок выбывает после сетевой ошибки или неудачного входа
+    void Fail(Endpoint endpoint, bool count = true) {
+        if (count) {
+            ++stats_[static_cast<size_t>(endpoint)].errors;
+        }
+        if (endpoint == Endpoint::JOIN) {
+            ++joined_;
+        }
+        beast::error_code ec;
+        stream_.socket().close(ec);
+    }
+
+    beast::tcp_stream stream_;
+    beast::flat_buffer buffer_;
+    const CommandLineArgs& args_;
+    size_t index_;
+    util::Xoshiro256 random_;
+    std::atomic<size_t>& joined_;
+
+    std::string token_;
+    Endpoint endpoint_ = Endpoint::JOIN;
+    Request request_;
+    Response response_;
+    Clock::time_point sent_at_;
+    Clock::time_point deadline_ = Clock::time_point::max();
+    bool started_ = false;
+    bool idle_ = false;
+
+    Stats stats_;
+};
+
+std::string FindFirstMap(net::io_context& ioc, const tcp::resolver::results_type& endpoints, const CommandLineArgs& args) {
+    beast::tcp_stream stream(ioc);
+    stream.connect(endpoints);
+
+    Request request{http::verb::get, "/api/v1/maps"sv, 11};
+    request.set(http::field::host, args.host);
+    http::write(stream, request);
+
+    beast::flat_buffer buffer;
+    Response response;
+    http::read(stream, buffer, response);
+
+    const auto maps = json::parse(response.body()).as_array();
+    if (maps.empty()) {
+        throw std::runtime_error("Server has no maps"s);
+    }
+    return std::string(maps.at(0).at("id").get_string());
+}
+
+double Percentile(const std::vector<uint32_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    const auto idx = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+    return sorted[idx] / 1000.0;
+}
+
+void PrintReport(const Stats& stats, double load_seconds, bool json_output) {
+    json::array report;
+    if (!json_output) {
+        std::cout << std::left << std::setw(30) << "endpoint" << std::right
+                  << std::setw(10) << "requests" << std::setw(8) << "errors" << std::setw(12) << "req/s"
+                  << std::setw(10) << "p50,ms" << std::setw(10) << "p99,ms" << std::setw(10) << "p999,ms"
+                  << std::setw(10) << "max,ms" << '\n';
+    }
+
+    for (size_t i = 0; i < ENDPOINT_COUNT; ++i) {
+        auto latencies = stats[i].latencies;
+        std::sort(latencies.begin(), latencies.end());
+        // Вход выполняется до начала замера, для него пропускная способность не считается
+        const double rps = i == static_cast<size_t>(Endpoint::JOIN) ? 0.0 : latencies.size() / load_seconds;
+
+        if (json_output) {
+            report.push_back(json::object{
+                {"endpoint", ENDPOINT_NAMES[i]},
+                {"requests", latencies.size()},
+                {"errors", stats[i].errors},
+                {"rps", rps},
+                {"p50Ms", Percentile(latencies, 0.5)},
+                {"p99Ms", Percentile(latencies, 0.99)},
+                {"p999Ms", Percentile(latencies, 0.999)},
+                {"maxMs", Percentile(latencies, 1.0)}
+            });
+            continue;
+        }
+
+        std::cout << std::left << std::setw(30) << ENDPOINT_NAMES[i] << std::right
+                  << std::setw(10) << latencies.size() << std::setw(8) << stats[i].errors
+                  << std::fixed << std::setprecision(1) << std::setw(12) << rps << std::setprecision(3)
+                  << std::setw(10) << Percentile(latencies, 0.5) << std::setw(10) << Percentile(latencies, 0.99)
+                  << std::setw(10) << Percentile(latencies, 0.999) << std::setw(10) << Percentile(latencies, 1.0) << '\n';
+    }
+
+    if (json_output) {
+        std::cout << json::serialize(report) << std::endl;
+    }
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        auto args = ParseCommandLine(argc, argv);
+        if (!args) {
+            return EXIT_FAILURE;
+        }
+
+        net::io_context ioc(static_cast<int>(args->threads));
+        tcp::resolver resolver(ioc);
+        const auto endpoints = resolver.resolve(args->host, args->port);
+
+        if (args->map_id.empty()) {
+            args->map_id = FindFirstMap(ioc, endpoints, *args);
+        }
+
+        // 1. Все игроки подключаются и входят в игру
+        std::atomic<size_t> joined = 0;
+        std::vector<std::shared_ptr<VirtualPlayer>> players;
+        players.reserve(args->players);
+        for (size_t i = 0; i < args->players; ++i) {
+            players.push_back(std::make_shared<VirtualPlayer>(ioc, *args, i, joined));
+            players.back()->Start(endpoints);
+        }
+
+        // Пока игроки ждут остальных, у io_context может не остаться операций
+        auto work = net::make_work_guard(ioc);
+        std::vector<std::jthread> workers;
+        for (unsigned i = 0; i < args->threads; ++i) {
+            workers.emplace_back([&ioc] {
+                ioc.run();
+            });
+        }
+
+        while (joined < args->players) {
+            std::this_thread::sleep_for(10ms);
+        }
+
+        // 2. Замкнутый цикл запросов до истечения времени
+        const auto start = Clock::now();
+        const auto deadline = start + std::chrono::seconds(args->duration);
+        for (const auto& player : players) {
+            player->SetDeadline(deadline);
+        }
+        work.reset();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        const double load_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        Stats total;
+        for (const auto& player : players) {
+            for (size_t i = 0; i < ENDPOINT_COUNT; ++i) {
+                const auto& stats = player->GetStats()[i];
+                total[i].latencies.insert(total[i].latencies.end(), stats.latencies.begin(), stats.latencies.end());
+                total[i].errors += stats.errors;
+            }
+        }
+        PrintReport(total, load_seconds, args->json_output);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,212 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/unordered_map.hpp>
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/collision_detector.h"
+#include "../src/loot_generator.h"
+#include "../src/model.h"
+#include "../src/model_serialization.h"
+#include "../src/prng.h"
+
+/*
+ *  Бенчмарки горячих путей модели на сгенерированных картах.
+ *  Параметры (число собак, предметов и дорог) перебираются через GENERATE
+ *  и входят в имя бенчмарка. Машиночитаемый отчёт: game_server_bench --reporter xml
+ */
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+constexpr Coord ROAD_STEP = 10;
+constexpr double DOG_SPEED = 3.0;
+constexpr auto TICK = 50ms;
+
+// Сетка из road_count дорог: половина горизонтальных, половина вертикальных.
+// Офисы стоят на каждом десятом перекрёстке главной диагонали
+Map MakeGridMap(size_t road_count) {
+    boost::json::array loot_types;
+    for (int value : {1, 2, 5}) {
+        loot_types.push_back(boost::json::object{{"value", value}});
+    }
+
+    Map map{Map::Id{"grid"s}, "Grid"s, extra_data::ExtraData{loot_types}};
+    const auto horizontal = static_cast<Coord>(std::max<size_t>(road_count / 2, 1));
+    const auto vertical = static_cast<Coord>(std::max<size_t>(road_count - road_count / 2, 1));
+    const Coord width = (vertical - 1) * ROAD_STEP;
+    const Coord height = (horizontal - 1) * ROAD_STEP;
+
+    for (Coord i = 0; i < horizontal; ++i) {
+        map.AddRoad(Road{Road::HORIZONTAL, Point{0, i * ROAD_STEP}, std::max(width, ROAD_STEP)});
+    }
+    for (Coord i = 0; i < vertical; ++i) {
+        map.AddRoad(Road{Road::VERTICAL, Point{i * ROAD_STEP, 0}, std::max(height, ROAD_STEP)});
+    }
+    for (Coord i = 0; i < std::min(horizontal, vertical); i += 10) {
+        map.AddOffice(Office{Office::Id{"office"s + std::to_string(i)}, Point{i * ROAD_STEP, i * ROAD_STEP}, Offset{0, 0}});
+    }
+
+    map.SetDogSpeed(DOG_SPEED);
+    map.BuildRoadIndexes();
+    return map;
+}
+
+Position RandomRoadPoint(const Map& map, util::Xoshiro256& random) {
+    const auto& roads = map.GetRoadNetwork();
+    const Road& road = roads[std::uniform_int_distribution<size_t>(0, roads.size() - 1)(random)];
+    const auto coord = road.GetRoadCoord();
+    return {std::uniform_real_distribution<double>(coord.min_x, coord.max_x)(random),
+            std::uniform_real_distribution<double>(coord.min_y, coord.max_y)(random)};
+}
+
+Speed RandomSpeed(util::Xoshiro256& random) {
+    static constexpr Speed SPEEDS[] = {{DOG_SPEED, 0.0}, {-DOG_SPEED, 0.0}, {0.0, DOG_SPEED}, {0.0, -DOG_SPEED}};
+    return SPEEDS[std::uniform_int_distribution<size_t>(0, 3)(random)];
+}
+
+void AddRandomLoot(GameSession& session, size_t loot_count, util::Xoshiro256& random) {
+    for (size_t i = 0; i < loot_count; ++i) {
+        const auto type = std::uniform_int_distribution<size_t>(0, session.GetMap().GetCountTypes() - 1)(random);
+        session.AddLoot(Loot{RandomRoadPoint(session.GetMap(), random), Loot::Id{i}, type});
+    }
+}
+
+// Сессия с собаками в случайных точках дорог, бегущими в случайных направлениях
+std::unique_ptr<GameSession> MakeSession(const Map& map, size_t dog_count, size_t loot_count) {
+    // Собаки не уходят из игры, даже если упрутся в край дороги
+    constexpr double RETIREMENT_TIME = 1e9;
+    auto session = std::make_unique<GameSession>(GameSession::Id{"grid#0"s}, map, lootGeneratorConfig{5000.0, 0.5}, RETIREMENT_TIME);
+
+    util::Xoshiro256 random{1};
+    for (size_t i = 0; i < dog_count; ++i) {
+        session->AddDog("dog"s + std::to_string(i), true)->SetSpeed(RandomSpeed(random));
+    }
+    AddRandomLoot(*session, loot_count, random);
+    return session;
+}
+
+std::string Params(size_t dogs, size_t loots, size_t roads) {
+    return " dogs="s + std::to_string(dogs) + " loots="s + std::to_string(loots) + " roads="s + std::to_string(roads);
+}
+
+}  // namespace
+
+TEST_CASE("FindGatherEvents") {
+    const size_t dogs = GENERATE(10, 100, 1000);
+    const size_t loots = GENERATE(100, 1000, 10000);
+    constexpr size_t ROADS = 40;
+
+    const Map map = MakeGridMap(ROADS);
+    util::Xoshiro256 random{2};
+
+    ItemGathererProviderImpl::Loots loot_store;
+    for (size_t i = 0; i < loots; ++i) {
+        loot_store.Insert(Loot{RandomRoadPoint(map, random), Loot::Id{i}, 0});
+    }
+
+    std::vector<ItemGathererProviderImpl::Movement> movements;
+    for (size_t slot = 0; slot < dogs; ++slot) {
+        Position start = RandomRoadPoint(map, random);
+        Speed speed = RandomSpeed(random);
+        Position position = start;
+        Position stop = Dog::MoveAlongRoads(position, speed, std::chrono::duration<double>(TICK).count(), map);
+        movements.push_back({start, stop, slot});
+    }
+    const ItemGathererProviderImpl provider(movements, loot_store, map.GetOffices());
+
+    BENCHMARK("FindGatherEvents"s + Params(dogs, loots, ROADS)) {
+        return collision_detector::FindGatherEvents(provider);
+    };
+}
+
+TEST_CASE("Dog::MoveAlongRoads") {
+    const size_t dogs = GENERATE(100, 1000, 10000);
+    const size_t roads = GENERATE(10, 100, 1000);
+
+    const Map map = MakeGridMap(roads);
+    util::Xoshiro256 random{3};
+
+    std::vector<Position> positions;
+    std::vector<Speed> speeds;
+    for (size_t i = 0; i < dogs; ++i) {
+        positions.push_back(RandomRoadPoint(map, random));
+        speeds.push_back(RandomSpeed(random));
+    }
+
+    BENCHMARK_ADVANCED("Dog::MoveAlongRoads"s + Params(dogs, 0, roads))(Catch::Benchmark::Chronometer meter) {
+        // Каждый прогон начинает с исходных позиций, чтобы собаки не скапливались у краёв дорог
+        std::vector<std::vector<Position>> run_positions(meter.runs(), positions);
+        std::vector<std::vector<Speed>> run_speeds(meter.runs(), speeds);
+        const double delta = std::chrono::duration<double>(TICK).count();
+
+        meter.measure([&](int run) {
+            auto& pos = run_positions[run];
+            auto& speed = run_speeds[run];
+            for (size_t i = 0; i < pos.size(); ++i) {
+                Dog::MoveAlongRoads(pos[i], speed[i], delta, map);
+            }
+            return pos.back().x;
+        });
+    };
+}
+
+TEST_CASE("GameSession::UpdateState") {
+    const size_t dogs = GENERATE(10, 100, 1000);
+    const size_t loots = GENERATE(100, 1000);
+    const size_t roads = GENERATE(10, 100);
+
+    const Map map = MakeGridMap(roads);
+    auto session = MakeSession(map, dogs, loots);
+
+    // Мир от тика к тику меняется: предметы подбираются и появляются снова,
+    // поэтому замер показывает установившийся режим
+    BENCHMARK("GameSession::UpdateState"s + Params(dogs, loots, roads)) {
+        return session->UpdateState(TICK);
+    };
+}
+
+TEST_CASE("LootGenerator::Generate") {
+    const unsigned looters = GENERATE(10u, 1000u, 100000u);
+
+    loot_gen::LootGenerator generator{5s, 0.5, [random = util::Xoshiro256{4}]() mutable {
+        return std::uniform_real_distribution<double>(0.0, 1.0)(random);
+    }};
+
+    BENCHMARK("LootGenerator::Generate looters="s + std::to_string(looters)) {
+        return generator.Generate(TICK, looters / 2, looters);
+    };
+}
+
+TEST_CASE("GameSession serialization round-trip") {
+    const size_t dogs = GENERATE(10, 100, 1000);
+    const size_t loots = GENERATE(100, 1000);
+    constexpr size_t ROADS = 40;
+
+    Game game;
+    game.AddMap(MakeGridMap(ROADS));
+    auto session = MakeSession(game.GetMaps().front(), dogs, loots);
+
+    BENCHMARK("GameSessionRepr round-trip"s + Params(dogs, loots, ROADS)) {
+        std::stringstream stream;
+        {
+            boost::archive::text_oarchive output{stream};
+            serialization::GameSessionRepr repr{*session};
+            output << repr;
+        }
+        boost::archive::text_iarchive input{stream};
+        serialization::GameSessionRepr restored;
+        input >> restored;
+        return restored.Restore(game);
+    };
+}
@@ -1,7 +1,9 @@
 #include "api_handler.h"
+#include "state_encoding.h"
 
 #include <algorithm> 
 #include <cctype>
+#include <charconv>
 #include <boost/algorithm/string/predicate.hpp>
 
 namespace http_handler {
@@ -9,11 +11,13 @@ namespace http_handler {
 using namespace json_fields;
 using namespace response_errors;
 
-    ApiHandler::ApiHandler(app::Application& application): application_(application) {} 
+    ApiHandler::ApiHandler(app::Application& application, util::SimulationThread& simulation)
+        : application_(application), simulation_(simulation) {}
 
-    ApiHandler::StringResponse ApiHandler::HandleRequest(const StringRequest& req) {
+    ApiHandler::Response ApiHandler::HandleRequest(const StringRequest& req) {
         const auto target = std::string(req.target());
         const auto method = req.method();
+        const auto path = GetPath(target);
 
         if (target == requests::GAME_TICK) {
             if (method == http::verb::post) {
@@ -23,8 +27,11 @@ using namespace response_errors;
         }
 
 
-        if (target == requests::GAME_STATE) {
+        if (path == requests::GAME_STATE) {
             if (method == http::verb::get || method == http::verb::head) {
+                if (auto since = GetQueryParam(target, "since")) {
+                    return HandleGameStateDelta(req, *since);
+                }
                 return HandleGameState(req);
             }
             return MakeMethodNotAllowed("GET, HEAD");
@@ -76,6 +83,91 @@ using namespace response_errors;
         return MakeErrorResponse(http::status::bad_request, BAD_REQUEST, "Bad request");
     }
 
+    bool ApiHandler::RunsOnSimulation(const StringRequest& req) {
+        if (req.method() != http::verb::post) {
+            return false;
+        }
+        return req.target() == requests::GAME_JOIN || req.target() == requests::GAME_TICK;
+    }
+
+    std::string_view ApiHandler::GetPath(std::string_view target) {
+        return target.substr(0, target.find('?'));
+    }
+
+    std::optional<std::string_view> ApiHandler::GetQueryParam(std::string_view target, std::string_view name) {
+        auto pos = target.find('?');
+        if (pos == std::string_view::npos) {
+            return std::nullopt;
+        }
+
+        std::string_view query = target.substr(pos + 1);
+        while (!query.empty()) {
+            auto end = query.find('&');
+            std::string_view param = query.substr(0, end);
+
+            if (param.size() > name.size() && param.substr(0, name.size()) == name && param[name.size()] == '=') {
+                return param.substr(name.size() + 1);
+            }
+            if (end == std::string_view::npos) {
+                break;
+            }
+            query.remove_prefix(end + 1);
+        }
+        return std::nullopt;
+    }
+
+    std::string ApiHandler::MakeRecordsCursor(const domain::RecordsKey& key) {
+        static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+        std::string cursor = std::to_string(key.score) + '.' + std::to_string(key.play_time_ms) + '.' + key.id.ToString() + '.';
+        for (unsigned char c : key.name) {
+            cursor += HEX_DIGITS[c >> 4];
+            cursor += HEX_DIGITS[c & 0xF];
+        }
+        return cursor;
+    }
+
+    std::optional<domain::RecordsKey> ApiHandler::ParseRecordsCursor(std::string_view cursor) {
+        auto parse_int = [&cursor](int& value) {
+            const auto* end = cursor.data() + cursor.size();
+            auto [ptr, ec] = std::from_chars(cursor.data(), end, value);
+            if (ec != std::errc{} || ptr == end || *ptr != '.') {
+                return false;
+            }
+            cursor.remove_prefix(ptr - cursor.data() + 1);
+            return true;
+        };
+
+        domain::RecordsKey key;
+        if (!parse_int(key.score) || !parse_int(key.play_time_ms)) {
+            return std::nullopt;
+        }
+
+        const auto id_end = cursor.find('.');
+        if (id_end == std::string_view::npos) {
+            return std::nullopt;
+        }
+        try {
+            key.id = domain::RetiredPlayerId::FromString(std::string(cursor.substr(0, id_end)));
+        }
+        catch (const std::exception&) {
+            return std::nullopt;
+        }
+        cursor.remove_prefix(id_end + 1);
+
+        if (cursor.size() % 2 != 0) {
+            return std::nullopt;
+        }
+        for (size_t pos = 0; pos < cursor.size(); pos += 2) {
+            unsigned value = 0;
+            auto [ptr, ec] = std::from_chars(cursor.data() + pos, cursor.data() + pos + 2, value, 16);
+            if (ec != std::errc{} || ptr != cursor.data() + pos + 2) {
+                return std::nullopt;
+            }
+            key.name += static_cast<char>(value);
+        }
+        return key;
+    }
+
     ApiHandler::StringResponse ApiHandler::MakeJsonResponse(http::status status, json::value&& data) {
         StringResponse response;
         response.result(status);
@@ -211,6 +303,15 @@ using namespace response_errors;
             return MakeErrorResponse(http::status::bad_request, INVALID_ARGUMENT, "Invalid mapId");
         }
 
+        // Длинное имя не поместится в таблицу рекордов, когда игрок уйдёт на покой.
+        // Считаем символы UTF-8, а не байты, как и столбец varchar
+        const auto name_length = std::count_if(user_name.begin(), user_name.end(), [](char c) {
+            return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+        });
+        if (static_cast<size_t>(name_length) > domain::MAX_NAME_LENGTH) {
+            return MakeErrorResponse(http::status::bad_request, INVALID_ARGUMENT, "Invalid userName: too long");
+        }
+
         if (obj.contains("mapId") && !obj.at("mapId").get_string().empty()) {
             map_id_str = obj.at("mapId").get_string();
         }
@@ -222,7 +323,7 @@ using namespace response_errors;
             auto [token, player_ptr] = application_.JoinGame(map_id_str, user_name);
 
             json::value result = json::object{
-                {"authToken", *token},
+                {"authToken", app::TokenToHex(token)},
                 {"playerId", *player_ptr }
             };
 
@@ -234,7 +335,7 @@ using namespace response_errors;
 
     }
 
-    std::optional<app::Token> ApiHandler::GetToken(const StringRequest& req) const {
+    std::optional<app::Token> ApiHandler::GetToken(const StringRequest& req) {
         auto it = req.find(http::field::authorization);
         
         if (it != req.end()) {
@@ -242,31 +343,69 @@ using namespace response_errors;
             constexpr std::string_view BEARER_PREFIX = "Bearer "; 
 
             if (boost::algorithm::starts_with(header_value, BEARER_PREFIX)) {
-                std::string_view token_str_view = header_value.substr(BEARER_PREFIX.length());
-                
-                if (!token_str_view.empty() && token_str_view.length() == 32 && 
-                    std::all_of(token_str_view.begin(), token_str_view.end(), 
-                    [](char c){ return std::isxdigit(c); })) {
-                    return app::Token{std::string(token_str_view)}; 
-                }
-                
+                return ParseToken(header_value.substr(BEARER_PREFIX.length()));
             }
+            return std::nullopt;
+        }
+
+        // Браузер не может передать заголовок при открытии WebSocket
+        if (websocket::is_upgrade(req)) {
+            return GetProtocolToken(req);
         }
         return std::nullopt;
     }
 
+    std::optional<app::Token> ApiHandler::GetProtocolToken(const StringRequest& req) {
+        // Sec-WebSocket-Protocol: bearer, <токен>. В параметре запроса токен попал бы в журналы доступа
+        auto it = req.find(http::field::sec_websocket_protocol);
+        if (it == req.end()) {
+            return std::nullopt;
+        }
+
+        std::vector<std::string_view> protocols;
+        std::string_view value = it->value();
+        while (!value.empty()) {
+            const auto comma = value.find(',');
+            std::string_view protocol = value.substr(0, comma);
+            while (!protocol.empty() && protocol.front() == ' ') {
+                protocol.remove_prefix(1);
+            }
+            while (!protocol.empty() && protocol.back() == ' ') {
+                protocol.remove_suffix(1);
+            }
+            protocols.push_back(protocol);
+            value = comma == std::string_view::npos ? std::string_view{} : value.substr(comma + 1);
+        }
+
+        if (protocols.size() != 2 || protocols[0] != TOKEN_PROTOCOL) {
+            return std::nullopt;
+        }
+        return ParseToken(protocols[1]);
+    }
+
+    std::optional<app::Token> ApiHandler::ParseToken(std::string_view token_str_view) {
+        return app::TokenFromHex(token_str_view);
+    }
+
+    bool ApiHandler::IsValidMoveDirection(std::string_view move_direction) {
+        return move_direction == move_direction::UP || 
+            move_direction == move_direction::DOWN || 
+            move_direction == move_direction::LEFT || 
+            move_direction == move_direction::RIGHT ||
+            move_direction == move_direction::STOP;
+    }
+
     ApiHandler::StringResponse ApiHandler::HandleGetPlayers(const StringRequest& req) {
         return ExecuteAuthorized(req, [this](const app::Token& token) {
-            std::shared_ptr<app::Player> player = application_.GetPlayers().FindPlayerByToken(token);
-            auto session_dogs = player->GetSession()->GetDogs();
+            auto state = application_.ListPlayers(token);
             json::object players_list;
 
-            for (const auto& [dog_id, dog] : session_dogs) {
+            for (const auto& dog : state->dogs) {
                 json::value dog_info = json::object{
-                    {"name", dog->GetName()}
+                    {"name", dog.name}
                 };
                 
-                players_list[std::to_string(*dog_id)] = std::move(dog_info);
+                players_list[std::to_string(*dog.id)] = std::move(dog_info);
             }
             
             json::object result_data;
@@ -276,60 +415,177 @@ using namespace response_errors;
         });
     }
 
-    ApiHandler::StringResponse ApiHandler::HandleGameState(const StringRequest& req) {
-        return ExecuteAuthorized(req, [this](const app::Token& token) {
-            
+    ApiHandler::Response ApiHandler::HandleGameState(const StringRequest& req) {
+        return ExecuteAuthorized(req, [this, &req](const app::Token& token) -> Response {
             auto state = application_.GameState(token);
+            // Кадр снимка строится один раз на тик и общий для всех игроков сессии
+            using FrameFormat = model::GameSession::GameStateData::FrameFormat;
 
-            json::object game_state_players;
-
-            for (const auto& [id, player] : state.dogs) {
-                auto position = player->GetPosition();
-                auto speed = player->GetSpeed();
-                auto direction = model::DirectionToString(player->GetDirection());
-                json::array bag;
-                size_t score = player->GetScore();
-
-                for (const auto& item : player->GetItemsFromBag()) {
-                    bag.push_back(json::object{
-                        { "id", *item.id },
-                        { "type", item.type }
-                    });
+            const std::string* binary_frame = nullptr;
+            if (AcceptsBinary(req)) {
+                try {
+                    binary_frame = &state->GetFrame(FrameFormat::BINARY, state_encoding::EncodeBinary);
+                }
+                catch (const std::out_of_range&) {
+                    // Координаты карты не помещаются в 16.16, отдаём JSON
                 }
+            }
+            const bool binary = binary_frame != nullptr;
+            // У разных представлений одного снимка разные ETag
+            const std::string etag = MakeETag(state->session_id, state->version, binary ? "-bin" : "");
+
+            // Состояние не менялось с прошлого опроса клиента
+            if (auto it = req.find(http::field::if_none_match); it != req.end() && it->value() == etag) {
+                StringResponse response;
+                response.result(http::status::not_modified);
+                response.set(http::field::cache_control, "no-cache");
+                response.set(http::field::etag, etag);
+                response.set(http::field::vary, "Accept, Authorization");
+                return response;
+            }
 
-                json::value player_info = json::object {
-                    { "pos", json::array{position.x, position.y} },
-                    { "speed", json::array{speed.x, speed.y} },
-                    { "dir", direction },
-                    { "bag", bag },
-                    { "score", score }
-                };
+            // Тело ссылается на кадр в снимке, снимок живёт, пока ответ не отправлен
+            SharedResponse response;
+            response.result(http::status::ok);
+            response.set(http::field::cache_control, "no-cache");
+            response.set(http::field::etag, etag);
+            // Ответ зависит от токена: после повторного входа игрок может попасть в другую сессию
+            response.set(http::field::vary, "Accept, Authorization");
+            if (binary) {
+                response.set(http::field::content_type, BINARY_CONTENT_TYPE);
+                response.body().data = *binary_frame;
+            }
+            else {
+                response.set(http::field::content_type, "application/json");
+                response.body().data = state->GetFrame(FrameFormat::JSON, RenderGameState);
+            }
+            response.body().owner = std::move(state);
+            response.content_length(response.body().data.size());
+            return response;
+        });
+    }
 
-                game_state_players[std::to_string(*id)] = std::move(player_info);
+    std::string ApiHandler::MakeETag(const model::GameSession::Id& session_id, uint64_t version, std::string_view suffix) {
+        // В ETag допустимы только видимые ASCII-символы без кавычки, остальное кодируем как %XX
+        std::string etag = "\"";
+        for (unsigned char c : *session_id) {
+            if (c > 0x20 && c < 0x7F && c != '"' && c != '%' && c != '\\') {
+                etag.push_back(static_cast<char>(c));
             }
+            else {
+                constexpr std::string_view HEX = "0123456789ABCDEF";
+                etag += '%';
+                etag += HEX[c >> 4];
+                etag += HEX[c & 0xF];
+            }
+        }
+        return etag + ":" + std::to_string(version) + std::string(suffix) + "\"";
+    }
 
-            json::object game_state_types;
+    bool ApiHandler::AcceptsBinary(const StringRequest& req) {
+        auto it = req.find(http::field::accept);
+        return it != req.end() && it->value().find(BINARY_CONTENT_TYPE) != std::string_view::npos;
+    }
 
-            for (const auto& [id, loot] : state.loots) {
-                auto type = loot->GetType();
-                auto position = loot->GetPosition();
+    ApiHandler::StringResponse ApiHandler::HandleGameStateDelta(const StringRequest& req, std::string_view since_str) {
+        uint64_t since = 0;
+        if (since_str.empty() || !std::all_of(since_str.begin(), since_str.end(), [](char c) { return std::isdigit(c); })) {
+            return MakeErrorResponse(http::status::bad_request, INVALID_ARGUMENT, "Invalid argument: since must be a state version");
+        }
+        try {
+            since = std::stoull(std::string(since_str));
+        }
+        catch (const std::exception& e) {
+            return MakeErrorResponse(http::status::bad_request, INVALID_ARGUMENT, "Invalid argument: since must be a state version");
+        }
 
-                json::value loot_info = json::object {
-                    { "type", type },
-                    { "pos", json::array{position.x, position.y} }
-                };
+        return ExecuteAuthorized(req, [this, since](const app::Token& token) {
+            auto delta = application_.GameStateSince(token, since);
 
-                game_state_types[std::to_string(*id)] = std::move(loot_info);
+            json::array removed_players;
+            for (const auto& id : delta.removed_dogs) {
+                removed_players.push_back(json::value(std::to_string(*id)));
             }
 
-            json::object result_data;
-            result_data["players"] = std::move(game_state_players);
-            result_data["lostObjects"] = std::move(game_state_types);
+            json::array removed_objects;
+            for (const auto& id : delta.removed_loots) {
+                removed_objects.push_back(json::value(std::to_string(*id)));
+            }
 
-            return this->MakeJsonResponse(http::status::ok, std::move(result_data));
+            json::object result_data;
+            result_data["version"] = delta.version;
+            result_data["tick"] = delta.tick;
+            result_data["since"] = delta.since;
+            result_data["full"] = delta.full;
+            result_data["players"] = RenderPlayers(delta.dogs);
+            result_data["lostObjects"] = RenderLostObjects(delta.loots);
+            result_data["removedPlayers"] = std::move(removed_players);
+            result_data["removedObjects"] = std::move(removed_objects);
+
+            auto response = this->MakeJsonResponse(http::status::ok, std::move(result_data));
+            response.set(http::field::etag, MakeETag(delta.session_id, delta.version, "-delta"));
+            response.set(http::field::vary, "Authorization");
+            return response;
         });
     }
 
+    std::string ApiHandler::RenderGameState(const model::GameSession::GameStateData& state) {
+        json::object result_data;
+        result_data["players"] = RenderPlayers(state.dogs);
+        result_data["lostObjects"] = RenderLostObjects(state.loots);
+
+        return json::serialize(result_data);
+    }
+
+    json::object ApiHandler::RenderPlayers(const std::vector<model::GameSession::DogState>& dogs) {
+        json::object game_state_players;
+
+        for (const auto& player : dogs) {
+            auto position = player.position;
+            auto speed = player.speed;
+            auto direction = model::DirectionToString(player.direction);
+            json::array bag;
+            size_t score = player.score;
+
+            for (const auto& item : player.bag) {
+                bag.push_back(json::object{
+                    { "id", *item.id },
+                    { "type", item.type }
+                });
+            }
+
+            json::value player_info = json::object {
+                { "pos", json::array{position.x, position.y} },
+                { "speed", json::array{speed.x, speed.y} },
+                { "dir", direction },
+                { "bag", bag },
+                { "score", score }
+            };
+
+            game_state_players[std::to_string(*player.id)] = std::move(player_info);
+        }
+
+        return game_state_players;
+    }
+
+    json::object ApiHandler::RenderLostObjects(const std::vector<model::GameSession::LootState>& loots) {
+        json::object game_state_types;
+
+        for (const auto& loot : loots) {
+            auto type = loot.type;
+            auto position = loot.position;
+
+            json::value loot_info = json::object {
+                { "type", type },
+                { "pos", json::array{position.x, position.y} }
+            };
+
+            game_state_types[std::to_string(*loot.id)] = std::move(loot_info);
+        }
+
+        return game_state_types;
+    }
+
     ApiHandler::StringResponse ApiHandler::HandlePlayerSetAction(const StringRequest& req) {
         return ExecuteAuthorized(req, [this, req](const app::Token& token) {
             if (req[http::field::content_type] != "application/json") {
@@ -354,15 +610,19 @@ using namespace response_errors;
 
             std::string_view move_direction = req_body.as_object().at("move").get_string();
 
-            if (move_direction != move_direction::UP && 
-                move_direction != move_direction::DOWN && 
-                move_direction != move_direction::LEFT && 
-                move_direction != move_direction::RIGHT &&
-                move_direction != move_direction::STOP) {
+            if (!IsValidMoveDirection(move_direction)) {
                 return this->MakeErrorResponse(http::status::bad_request, INVALID_ARGUMENT, "Failed to parse action");
             }
 
-            application_.SetPlayerAction(token, move_direction);
+            // Действие применится до следующего тика, ответ его не ждёт
+            simulation_.Post([&application = application_, token, move = std::string(move_direction)] {
+                try {
+                    application.SetPlayerAction(token, move);
+                }
+                catch (const app::ApiError&) {
+                    // Игрок успел уйти на покой
+                }
+            });
             json::value result = json::object{};
             return this->MakeJsonResponse(http::status::ok, std::move(result));
         });
@@ -460,7 +720,17 @@ using namespace response_errors;
             return MakeErrorResponse(http::status::bad_request, INVALID_ARGUMENT, "Failed to parse config");
         }
 
-        auto records = application_.Records(config.start, config.max_items);
+        // С курсором after страница продолжается от последней записи предыдущей, а не от смещения start
+        const auto after_str = GetQueryParam(req.target(), "after");
+        std::optional<domain::RecordsKey> after;
+        if (after_str) {
+            after = ParseRecordsCursor(*after_str);
+            if (!after || config.start != 0) {
+                return MakeErrorResponse(http::status::bad_request, INVALID_ARGUMENT, "Invalid argument: after must be a cursor from a previous page and cannot be combined with start");
+            }
+        }
+
+        auto records = after ? application_.RecordsAfter(*after, config.max_items) : application_.Records(config.start, config.max_items);
 
         json::array result;
 
@@ -474,6 +744,12 @@ using namespace response_errors;
             });
         }
 
-        return MakeJsonResponse(http::status::ok, std::move(result));
+        auto response = MakeJsonResponse(http::status::ok, std::move(result));
+        // Полная страница - возможно, есть следующая
+        if (config.max_items > 0 && records.size() == static_cast<size_t>(config.max_items)) {
+            response.set(http::field::link, std::string("<") + requests::GAME_RECORDS + "?maxItems=" + std::to_string(config.max_items)
+                + "&after=" + MakeRecordsCursor(records.back().GetRecordsKey()) + ">; rel=\"next\"");
+        }
+        return response;
     }
 }
\ No newline at end of file
@@ -1,12 +1,17 @@
 #pragma once
 
 #include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
 #include <boost/json.hpp>
+#include <boost/optional.hpp>
+#include <memory>
 #include <optional>
 #include <string_view>
+#include <variant>
 
 #include "model.h"
 #include "app.h"
+#include "simulation_thread.h"
 
 
 
@@ -19,6 +24,7 @@ namespace requests {
     constexpr const char* GAME_PLAYER_ACTION = "/api/v1/game/player/action";
     constexpr const char* MAPS_BY_ID = "/api/v1/maps/";
     constexpr const char* GAME_RECORDS = "/api/v1/game/records";
+    constexpr const char* GAME_WS = "/api/v1/game/ws";
 }
 
 namespace response_errors {
@@ -32,9 +38,46 @@ namespace http_handler {
 
 namespace beast = boost::beast;
 namespace http = beast::http;
+namespace websocket = beast::websocket;
 namespace json = boost::json;
 
+/*
+ *  Тело ответа, которое не копирует данные, а ссылается на уже готовый буфер.
+ *  owner держит буфер живым, пока ответ не отправлен (например, снимок сессии,
+ *  в котором лежит общий для всех игроков кадр состояния).
+ */
+struct SharedBufferBody {
+    struct value_type {
+        std::shared_ptr<const void> owner;
+        std::string_view data;
+    };
+
+    static std::uint64_t size(const value_type& body) {
+        return body.data.size();
+    }
 
+    class writer {
+    public:
+        using const_buffers_type = boost::asio::const_buffer;
+
+        template <bool isRequest, class Fields>
+        writer(const http::header<isRequest, Fields>&, const value_type& body)
+            : body_{body} {
+        }
+
+        void init(beast::error_code& ec) {
+            ec = {};
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+            ec = {};
+            return {{const_buffers_type{body_.data.data(), body_.data.size()}, false}};
+        }
+
+    private:
+        const value_type& body_;
+    };
+};
 
 class ApiHandler {
 public:
@@ -45,28 +88,60 @@ public:
 
     using StringRequest = http::request<http::string_body>;
     using StringResponse = http::response<http::string_body>;
-
-    explicit ApiHandler(app::Application& application);
-    StringResponse HandleRequest(const StringRequest& req);
+    // Кадр состояния отдаётся из снимка без копирования
+    using SharedResponse = http::response<SharedBufferBody>;
+    using Response = std::variant<StringResponse, SharedResponse>;
+
+    ApiHandler(app::Application& application, util::SimulationThread& simulation);
+    Response HandleRequest(const StringRequest& req);
+
+    // Вход в игру и ручной тик меняют мир и возвращают результат, поэтому выполняются
+    // в потоке симуляции. Остальные запросы читают снимки и неизменяемые карты в потоках
+    // ввода-вывода, а действия игроков уходят в поток симуляции командами
+    static bool RunsOnSimulation(const StringRequest& req);
+
+    // Подпротокол, которым браузер передаёт токен при открытии WebSocket
+    static constexpr std::string_view TOKEN_PROTOCOL = "bearer";
+
+    // Токен из заголовка Authorization или, для WebSocket, из подпротокола TOKEN_PROTOCOL
+    static std::optional<app::Token> GetToken(const StringRequest& req);
+    // Токен из Sec-WebSocket-Protocol: bearer, <токен>
+    static std::optional<app::Token> GetProtocolToken(const StringRequest& req);
+    static std::optional<app::Token> ParseToken(std::string_view token_str);
+    static std::string RenderGameState(const model::GameSession::GameStateData& state);
+    static std::string_view GetPath(std::string_view target);
+    static std::optional<std::string_view> GetQueryParam(std::string_view target, std::string_view name);
+    static bool IsValidMoveDirection(std::string_view move_direction);
+    // Курсор постраничного чтения рекордов: "<очки>.<время игры в мс>.<id>.<имя в hex>"
+    static std::string MakeRecordsCursor(const domain::RecordsKey& key);
+    static std::optional<domain::RecordsKey> ParseRecordsCursor(std::string_view cursor);
 
 private:
     StringResponse HandleGetMaps();
     StringResponse HandleGetMapById(std::string_view map_id_str);
     StringResponse HandleJoinGame(const StringRequest& req);
     StringResponse HandleGetPlayers(const StringRequest& req);
-    StringResponse HandleGameState(const StringRequest& req);
+    Response HandleGameState(const StringRequest& req);
     StringResponse HandlePlayerSetAction(const StringRequest& req);
     StringResponse HandleGameTick(const StringRequest& req);
     StringResponse HandleGetRecords(const StringRequest& req);
+    StringResponse HandleGameStateDelta(const StringRequest& req, std::string_view since_str);
 
-    std::optional<app::Token> GetToken(const StringRequest& req) const;
+    static json::object RenderPlayers(const std::vector<model::GameSession::DogState>& dogs);
+    static json::object RenderLostObjects(const std::vector<model::GameSession::LootState>& loots);
+    // Номера публикаций у разных сессий совпадают, поэтому в ETag входит и сессия
+    static std::string MakeETag(const model::GameSession::Id& session_id, uint64_t version, std::string_view suffix = "");
+    static bool AcceptsBinary(const StringRequest& req);
+
+    static constexpr std::string_view BINARY_CONTENT_TYPE = "application/octet-stream";
 
     StringResponse MakeJsonResponse(http::status status, json::value&& data);
     StringResponse MakeErrorResponse(http::status status, std::string_view code, std::string_view message);
     StringResponse MakeMethodNotAllowed(std::string_view allowed_methods, std::string_view message = "Invalid method");
 
+    // Возвращает то же, что action: StringResponse или Response
     template <typename Fn>
-    StringResponse ExecuteAuthorized(const StringRequest& req, Fn&& action) {
+    std::invoke_result_t<Fn, const app::Token&> ExecuteAuthorized(const StringRequest& req, Fn&& action) {
         auto token = GetToken(req);
 
         if (!token) {
@@ -77,12 +152,19 @@ private:
             return MakeErrorResponse(http::status::unauthorized, "unknownToken", "Player token has not been found");
         }
 
-        return action(*token);
+        // Вне потока симуляции игрок может уйти на покой между проверкой токена и действием
+        try {
+            return action(*token);
+        }
+        catch (const app::ApiError&) {
+            return MakeErrorResponse(http::status::unauthorized, "unknownToken", "Player token has not been found");
+        }
     }
 
     ConfigScores GetConfigScoresFromUrl(std::string_view url) const;
 
     app::Application& application_;
+    util::SimulationThread& simulation_;
 };
 
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "app.h"
 
+#include "metrics.h"
+
 namespace app {
 
     std::string HexEncode(uint64_t val) {
@@ -8,6 +10,28 @@ namespace app {
         return ss.str();
     }
 
+    std::string TokenToHex(const Token& token) {
+        return HexEncode((*token).high) + HexEncode((*token).low);
+    }
+
+    std::optional<Token> TokenFromHex(std::string_view hex) {
+        if (hex.size() != TOKEN_HEX_LENGTH) {
+            return std::nullopt;
+        }
+
+        detail::TokenValue value;
+        const auto parse_half = [](std::string_view half, uint64_t& result) {
+            auto [ptr, ec] = std::from_chars(half.data(), half.data() + half.size(), result, 16);
+            return ec == std::errc{} && ptr == half.data() + half.size();
+        };
+
+        constexpr size_t HALF_LENGTH = TOKEN_HEX_LENGTH / 2;
+        if (!parse_half(hex.substr(0, HALF_LENGTH), value.high) || !parse_half(hex.substr(HALF_LENGTH), value.low)) {
+            return std::nullopt;
+        }
+        return Token{value};
+    }
+
 
 
     Player::Player(DogPtr dog, SessionPtr session) :
@@ -17,7 +41,7 @@ namespace app {
         return dog_->GetId(); 
     }
 
-    const std::string Player::GetName() const noexcept {
+    const std::string Player::GetName() const {
         return dog_->GetName();
     }
 
@@ -30,15 +54,13 @@ namespace app {
     }
 
     Token PlayerTokens::GenerateToken() {
-        uint64_t part1 = generator1_();
-        uint64_t part2 = generator2_();
-        std::string token_str = HexEncode(part1) + HexEncode(part2);
-        return Token{std::move(token_str)};
+        return Token{detail::TokenValue{generator1_(), generator2_()}};
     }    
 
     Token PlayerTokens::AddPlayer(PlayerPtr player) {
         Token token = GenerateToken();
-        tokens_.emplace(token, player);
+        player_tokens_.emplace(player.get(), token);
+        tokens_.emplace(token, std::move(player));
         return token;
     }
 
@@ -52,30 +74,32 @@ namespace app {
     }
 
     void PlayerTokens::DeletePlayerTokens(PlayerPtr player) {
-        auto token = FindTokenByPlayer(player);
-        if (token) {
-            tokens_.erase(*token);
+        auto it = player_tokens_.find(player.get());
+        if (it != player_tokens_.end()) {
+            tokens_.erase(it->second);
+            player_tokens_.erase(it);
         }
     }    
 
     std::optional<Token> PlayerTokens::FindTokenByPlayer(PlayerPtr player_ptr) const {
-        for (const auto& [token, player] : tokens_) {
-            if (player == player_ptr) {
-                return token;
-            }
+        auto it = player_tokens_.find(player_ptr.get());
+        if (it != player_tokens_.end()) {
+            return it->second;
         }
         return std::nullopt;
     }
 
     std::pair<Players::PlayerPtr, Token> Players::AddPlayer(PlayerPtr player) {
-        Player::Id player_id = player->GetId();
+        std::unique_lock lock(mutex_);
+        const model::Dog* dog = player->GetDog().get();
         Token token = player_tokens_.AddPlayer(player);
-        players_.emplace(player_id, player);
+        players_.emplace(dog, player);
         return { player, token };
     }
 
-    Players::PlayerPtr Players::FindPlayer(Id id) const {
-        auto it = players_.find(id);
+    Players::PlayerPtr Players::FindPlayer(const model::Dog* dog) const {
+        std::shared_lock lock(mutex_);
+        auto it = players_.find(dog);
 
         if(it != players_.end()) {
             return it->second;
@@ -83,12 +107,14 @@ namespace app {
         return nullptr;
     }
 
-    Players::PlayerPtr Players::FindPlayerByToken(const Token& token) {
+    Players::PlayerPtr Players::FindPlayerByToken(const Token& token) const {
+        std::shared_lock lock(mutex_);
         return player_tokens_.FindPlayer(token);
     }
 
-    void Players::DeletePlayer(Players::Id id) {
-        if (auto it = players_.find(id); it != players_.end()) {
+    void Players::DeletePlayer(const model::Dog* dog) {
+        std::unique_lock lock(mutex_);
+        if (auto it = players_.find(dog); it != players_.end()) {
             player_tokens_.DeletePlayerTokens(it->second);
             players_.erase(it);
         }
@@ -124,24 +150,43 @@ namespace app {
         auto dog = session->AddDog(name_str, random_pos_generate_);
         app::Players::PlayerPtr player = std::make_shared<app::Player>(dog, session);
         auto [player_ptr, token ] = players_.AddPlayer(player);
+        // Новый игрок должен видеть себя в состоянии и списке игроков, не дожидаясь тика
+        session->PublishState();
         return { token, player_ptr->GetId() };
     }
 
+    bool JoinGameUseCase::IsRandomPosGenerate() const noexcept {
+        return random_pos_generate_;
+    }
+
 
     ListPlayersUseCase::ListPlayersUseCase(model::Game& game, Players& players) : game_(game), players_(players) {}
 
-    const model::GameSession::Dogs& ListPlayersUseCase::List(const Token& token) const {
+    model::GameSession::GameStatePtr ListPlayersUseCase::List(const Token& token) const {
         std::shared_ptr<app::Player> player = players_.FindPlayerByToken(token);
-        return player->GetSession()->GetDogs();
+        if (!player) {
+            throw ApiError::TokenUnknown;
+        }
+        return player->GetSession()->GetGameState();
     }
 
 
     GameStateUseCase::GameStateUseCase(Players& players) : players_(players) {}
 
-    const model::GameSession::GameStateData GameStateUseCase::GetState(const Token& token) const {
+    model::GameSession::GameStatePtr GameStateUseCase::GetState(const Token& token) const {
+        Players::PlayerPtr player = players_.FindPlayerByToken(token);
+        if (!player) {
+            throw ApiError::TokenUnknown;
+        }
+        return player->GetSession()->GetGameState();
+    }
+
+    model::GameSession::GameStateDelta GameStateUseCase::GetDelta(const Token& token, uint64_t since) const {
         Players::PlayerPtr player = players_.FindPlayerByToken(token);
-        const auto& game_state = player->GetSession()->GetGameState(); 
-        return game_state;
+        if (!player) {
+            throw ApiError::TokenUnknown;
+        }
+        return player->GetSession()->GetGameStateDelta(since);
     }
 
 
@@ -149,6 +194,9 @@ namespace app {
 
     void PlayerStateActionUseCase::SetAction(const Token& token, std::string_view move_direction) {
         auto player = players_.FindPlayerByToken(token);
+        if (!player) {
+            throw ApiError::TokenUnknown;
+        }
         double default_speed = player->GetSession()->GetMap().GetDogSpeed();
         model::Speed speed = {0.0, 0.0};
         model::Direction dir;
@@ -184,17 +232,64 @@ namespace app {
         : game_(game), players_(players), game_db_(game_db) {}
 
     void GameTickUseCase::UpdateState(std::chrono::milliseconds time) {
-        for (auto [map_id, session] : game_.GetSessions()) {
+        std::vector<model::Game::SessionPtr> sessions;
+        sessions.reserve(game_.GetSessions().size());
+        for (const auto& [session_id, session] : game_.GetSessions()) {
             if (session) {
-                auto inactive_dogs = session->UpdateState(time);
+                sessions.push_back(session);
+            }
+        }
 
-                for (const auto& dog : inactive_dogs) {
-                    game_db_.SaveRetiredPlayer({ dog->GetName(), static_cast<int>(dog->GetScore()), dog->GetLeaveTime() });
-                    session->DeletePlayer(dog);
-                    players_.DeletePlayer(dog->GetId());
-                }
+        // Порядок сессий фиксирован, чтобы уход игроков всегда применялся одинаково
+        std::sort(sessions.begin(), sessions.end(), [](const auto& lhs, const auto& rhs) {
+            return *lhs->GetId() < *rhs->GetId();
+        });
+
+        auto& server_metrics = metrics::GetServerMetrics();
+        auto phase_start = metrics::Clock::now();
+
+        // Сессии не делят изменяемых данных, поэтому обновляются параллельно
+        std::vector<std::vector<model::GameSession::DogPtr>> inactive_dogs(sessions.size());
+        task_pool_.ParallelFor(sessions.size(), [&](size_t idx) {
+            inactive_dogs[idx] = sessions[idx]->Simulate(time);
+        });
+        auto phase_end = metrics::Clock::now();
+        server_metrics.tick_sessions.Record(phase_end - phase_start);
+
+        // Уход игроков затрагивает общие реестры, применяем его последовательно.
+        // Запись в базу только ставится в очередь и не задерживает тик
+        phase_start = phase_end;
+        for (size_t idx = 0; idx < sessions.size(); ++idx) {
+            for (const auto& dog : inactive_dogs[idx]) {
+                game_db_.SaveRetiredPlayer({ dog->GetName(), static_cast<int>(dog->GetScore()), dog->GetLeaveTime() });
+                sessions[idx]->DeletePlayer(dog);
+                players_.DeletePlayer(dog.get());
             }
         }
+        server_metrics.tick_retirement.Record(metrics::Clock::now() - phase_start);
+
+        // Снимок публикуется один раз за тик, вместе со входами и уходами игроков
+        task_pool_.ParallelFor(sessions.size(), [&](size_t idx) {
+            sessions[idx]->PublishState();
+        });
+
+        for (const auto& session : sessions) {
+            const auto& timings = session->GetLastTickTimings();
+            server_metrics.session_loot_generation.Record(timings.loot_generation);
+            server_metrics.session_movement.Record(timings.movement);
+            server_metrics.session_collection.Record(timings.collection);
+            server_metrics.session_publish.Record(timings.publish);
+        }
+
+        size_t dogs = 0;
+        size_t loots = 0;
+        for (const auto& session : sessions) {
+            dogs += session->GetDogs().size();
+            loots += session->GetLoot().Size();
+        }
+        server_metrics.sessions.Set(static_cast<int64_t>(sessions.size()));
+        server_metrics.dogs.Set(static_cast<int64_t>(dogs));
+        server_metrics.loots.Set(static_cast<int64_t>(loots));
     }
 
 
@@ -204,6 +299,10 @@ namespace app {
         return game_db_.GetRetiredPlayers(offset, max_elements);
     }
 
+    std::vector<domain::RetiredPlayer> RecordsUseCase::GetRecordsAfter(const domain::RecordsKey& after, int max_elements) const {
+        return game_db_.GetRetiredPlayersAfter(after, max_elements);
+    }
+
 
     Application::Application(model::Game& game, Players& players, postgres_database::DataBaseConfig db_config) : 
         game_(game),
@@ -232,18 +331,22 @@ namespace app {
 
     const JoinGameUseCase::JoinGameResult Application::JoinGame(std::string_view map_id_str, std::string_view name_str) {
         try{
-            return join_game_.Join(std::string(map_id_str), std::string(name_str));
+            auto result = join_game_.Join(std::string(map_id_str), std::string(name_str));
+            if (journal_) {
+                journal_->RecordJoin(model::Map::Id{std::string(map_id_str)}, name_str, join_game_.IsRandomPosGenerate());
+            }
+            return result;
         }
         catch(const ApiError& error) {
             throw error;
         }
     }
 
-    const model::GameSession::Dogs& Application::ListPlayers(const Token& token) const {
+    model::GameSession::GameStatePtr Application::ListPlayers(const Token& token) const {
         return list_players_.List(token);
     }
 
-    const model::GameSession::GameStateData Application::GameState(const Token& token) const {
+    model::GameSession::GameStatePtr Application::GameState(const Token& token) const {
         try{
             return game_state_.GetState(token);
         }
@@ -252,8 +355,19 @@ namespace app {
         }
     }
 
+    model::GameSession::GameStateDelta Application::GameStateSince(const Token& token, uint64_t since) const {
+        return game_state_.GetDelta(token, since);
+    }
+
     void Application::SetPlayerAction(const Token& token, std::string_view move_direction) {
         player_state_action_.SetAction(token, move_direction);
+        if (journal_) {
+            // В журнал попадает уже применённое действие, токены при воспроизведении не нужны
+            if (auto player = players_.FindPlayerByToken(token)) {
+                const auto dog = player->GetDog();
+                journal_->RecordAction(player->GetSession()->GetId(), dog->GetId(), dog->GetSpeed(), dog->GetDirection());
+            }
+        }
     }
 
     bool Application::IsAutoTickEnabled() const {
@@ -265,22 +379,41 @@ namespace app {
     }
 
     void Application::Tick(std::chrono::milliseconds delta) {
+        auto& server_metrics = metrics::GetServerMetrics();
+        const auto tick_start = metrics::Clock::now();
+
+        if (journal_) {
+            journal_->RecordTick(delta);
+        }
         game_tick_.UpdateState(delta);
-        if (listener_) {
-            listener_->OnTick(delta);
+
+        const auto listeners_start = metrics::Clock::now();
+        for (const auto& listener : listeners_) {
+            listener->OnTick(delta);
         }
+        const auto tick_end = metrics::Clock::now();
+        server_metrics.tick_listeners.Record(tick_end - listeners_start);
+        server_metrics.tick_duration.Record(tick_end - tick_start);
     }
 
     void Application::SetGenerateRandPos(bool enabled) {
         randomize_spavn_dogs_ = enabled;
     }
 
-    void Application::SetApplicationListener(std::unique_ptr<ApplicationListener> listener) {
-        listener_ = std::move(listener);
+    void Application::AddApplicationListener(std::shared_ptr<ApplicationListener> listener) {
+        listeners_.push_back(std::move(listener));
+    }
+
+    void Application::SetInputJournal(std::shared_ptr<replay::JournalWriter> journal) {
+        journal_ = std::move(journal);
     }
 
     const std::vector<domain::RetiredPlayer> Application::Records(int offset, int max_elements) const {
         return records_.GetRecords(offset, max_elements);
     }
+
+    const std::vector<domain::RetiredPlayer> Application::RecordsAfter(const domain::RecordsKey& after, int max_elements) const {
+        return records_.GetRecordsAfter(after, max_elements);
+    }
     
 }
\ No newline at end of file
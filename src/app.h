@@ -1,17 +1,23 @@
 #pragma once
 
 #include <algorithm>
+#include <charconv>
 #include <iomanip>
 #include <memory>
 #include <optional>
+#include <shared_mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <chrono> 
 
+#include "flat_hash_map.h"
 #include "model.h"
 #include "postgres.h"
+#include "replay.h"
 #include "tagged.h"
+#include "task_pool.h"
 
 
 
@@ -27,13 +33,34 @@ namespace app {
 
 namespace detail {
 struct TokenTag {};
+
+// 128 случайных бит токена
+struct TokenValue {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    auto operator<=>(const TokenValue&) const = default;
+};
 }
 
-// Токен — сущность уровня приложения (аутентификация)
-using Token = util::Tagged<std::string, detail::TokenTag>;
+// Токен — сущность уровня приложения (аутентификация).
+// Внутри хранится числом, в шестнадцатеричную строку переводится только при обмене с клиентом
+using Token = util::Tagged<detail::TokenValue, detail::TokenTag>;
 enum class ApiError {InvalidName, MapNotFound, TokenUnknown};
 
+// Биты токена случайны, поэтому хешем может служить их свёртка
+struct TokenHasher {
+    size_t operator()(const Token& token) const noexcept {
+        return static_cast<size_t>((*token).high ^ (*token).low);
+    }
+};
+
+constexpr size_t TOKEN_HEX_LENGTH = 32;
+
 std::string HexEncode(uint64_t val);
+std::string TokenToHex(const Token& token);
+// Возвращает nullopt, если строка не состоит ровно из 32 шестнадцатеричных цифр
+std::optional<Token> TokenFromHex(std::string_view hex);
 
 
 class Player {
@@ -45,7 +72,7 @@ public:
     Player(DogPtr dog, SessionPtr session);
 
     const Id& GetId() const noexcept;
-    const std::string GetName() const noexcept;
+    const std::string GetName() const;
     DogPtr GetDog() const noexcept;
     SessionPtr GetSession() const noexcept;
 
@@ -59,9 +86,11 @@ private:
 class PlayerTokens {
 public:
     friend class serialization::PlayerTokensRepr;
+    friend class serialization::PlayersRepr;
 
     using PlayerPtr = std::shared_ptr<Player>;
-    using TokenToPlayer = std::unordered_map<Token, PlayerPtr, util::TaggedHasher<Token>>;
+    using TokenToPlayer = util::FlatHashMap<Token, PlayerPtr, TokenHasher>;
+    using PlayerToToken = util::FlatHashMap<const Player*, Token>;
 
     Token AddPlayer(PlayerPtr player);
     PlayerPtr FindPlayer(const Token& token) const;
@@ -84,6 +113,8 @@ private:
     }()};
 
     TokenToPlayer tokens_;
+    // Обратный индекс, чтобы удаление игрока не требовало обхода всех токенов
+    PlayerToToken player_tokens_;
 };
 
 
@@ -94,16 +125,19 @@ public:
     using Id = Player::Id;
     using PlayerPtr = std::shared_ptr<Player>;
     using SessionPtr = std::shared_ptr<model::GameSession>;
-    using PlayerMap = std::unordered_map<Id, PlayerPtr, util::TaggedHasher<Id>>;
+    // Идентификаторы собак уникальны только внутри сессии, поэтому игроки ищутся по собаке
+    using PlayerMap = util::FlatHashMap<const model::Dog*, PlayerPtr>;
 
     std::pair<PlayerPtr, Token> AddPlayer(PlayerPtr player);
-    PlayerPtr FindPlayer(Id id) const;
-    PlayerPtr FindPlayerByToken(const Token& token);
+    PlayerPtr FindPlayer(const model::Dog* dog) const;
+    PlayerPtr FindPlayerByToken(const Token& token) const;
 
-    void DeletePlayer(Id id);
+    void DeletePlayer(const model::Dog* dog);
 
 private:
 
+    // Поиск игроков идёт из потоков ввода-вывода параллельно с тиком
+    mutable std::shared_mutex mutex_;
     PlayerMap players_;
     PlayerTokens player_tokens_;
     uint32_t next_player_ = 0;
@@ -138,6 +172,7 @@ class JoinGameUseCase {
     };
 
     JoinGameResult Join(std::string map_id_str, std::string name_str);
+    bool IsRandomPosGenerate() const noexcept;
 
 private:
     model::Game& game_;
@@ -149,7 +184,7 @@ private:
 class ListPlayersUseCase {
  public:
     explicit ListPlayersUseCase(model::Game& game, Players& players);
-    const model::GameSession::Dogs& List(const Token& token) const;
+    model::GameSession::GameStatePtr List(const Token& token) const;
 private:
     model::Game& game_;
     Players& players_;
@@ -159,7 +194,8 @@ private:
 class GameStateUseCase {
 public:
     explicit GameStateUseCase(Players& players);
-    const model::GameSession::GameStateData GetState(const Token& token) const;
+    model::GameSession::GameStatePtr GetState(const Token& token) const;
+    model::GameSession::GameStateDelta GetDelta(const Token& token, uint64_t since) const;
 private:
     Players& players_;
 };
@@ -182,6 +218,7 @@ private:
     model::Game& game_;
     Players& players_;
     postgres_database::DataBase& game_db_;
+    util::TaskPool task_pool_;
 };
 
 
@@ -196,6 +233,7 @@ class RecordsUseCase {
 public:
     explicit RecordsUseCase(const postgres_database::DataBase& game_db);
     std::vector<domain::RetiredPlayer> GetRecords(int offset, int max_elements) const;
+    std::vector<domain::RetiredPlayer> GetRecordsAfter(const domain::RecordsKey& after, int max_elements) const;
 private:
     const postgres_database::DataBase& game_db_;
 };
@@ -212,8 +250,10 @@ public:
     const model::Map* FindMap(std::string_view map_id_str) const;
     const JoinGameUseCase::JoinGameResult JoinGame(std::string_view map_id_str, std::string_view name_str);
 
-    const model::GameSession::Dogs& ListPlayers(const Token& token) const;
-    const model::GameSession::GameStateData GameState(const Token& token) const;
+    // Читают опубликованный снимок сессии и могут вызываться из любого потока
+    model::GameSession::GameStatePtr ListPlayers(const Token& token) const;
+    model::GameSession::GameStatePtr GameState(const Token& token) const;
+    model::GameSession::GameStateDelta GameStateSince(const Token& token, uint64_t since) const;
 
     void SetPlayerAction(const Token& token, std::string_view move_direction);
 
@@ -222,9 +262,13 @@ public:
     void Tick(std::chrono::milliseconds delta);
     void SetGenerateRandPos(bool enabled);
 
-    void SetApplicationListener(std::unique_ptr<ApplicationListener> listener);
+    void AddApplicationListener(std::shared_ptr<ApplicationListener> listener);
+    // Входы, меняющие мир (вход игроков, действия, тики), записываются в журнал для воспроизведения
+    void SetInputJournal(std::shared_ptr<replay::JournalWriter> journal);
 
     const std::vector<domain::RetiredPlayer> Records(int offset, int max_elements) const;
+    // Страница, следующая за последней записью предыдущей страницы
+    const std::vector<domain::RetiredPlayer> RecordsAfter(const domain::RecordsKey& after, int max_elements) const;
 
 private:
     model::Game& game_;
@@ -242,7 +286,8 @@ private:
     bool auto_tick_enabled_ = false;
     bool randomize_spavn_dogs_ = false;
 
-    std::unique_ptr<ApplicationListener> listener_ = nullptr;
+    std::vector<std::shared_ptr<ApplicationListener>> listeners_;
+    std::shared_ptr<replay::JournalWriter> journal_;
 
     postgres_database::DataBase game_db_;
     RecordsUseCase records_;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <filesystem>
+#include <optional>
 #include <fstream>
 #include <unordered_map>
 #include <boost/archive/text_oarchive.hpp>
@@ -18,23 +19,32 @@ public:
     PlayerRepr() = default;
 
     explicit PlayerRepr(app::Player& player) :
-        dog_(*player.GetDog()), session_(*player.GetSession()) {}
+        dog_id_(*player.GetId()), session_id_(*player.GetSession()->GetId()) {}
 
+    // Сессии восстанавливаются раньше игроков, игрок только ссылается на свою собаку в сессии
     [[nodiscard]] app::Player Restore(const model::Game& game) const {
-        auto dog = dog_.Restore();
-        auto session_ptr = session_.Restore(game);
-        return app::Player(std::make_shared<model::Dog>(dog), session_ptr);
+        auto session_ptr = game.FindGameSession(model::GameSession::Id{session_id_});
+        if (!session_ptr) {
+            throw std::runtime_error("Session not found for player restoration");
+        }
+
+        const auto& dogs = session_ptr->GetDogs();
+        auto dog = dogs.find(model::Dog::Id{dog_id_});
+        if (dog == dogs.end()) {
+            throw std::runtime_error("Dog not found for player restoration");
+        }
+        return app::Player(dog->second, session_ptr);
     }
 
     template <typename Archive>
     void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
-        ar& dog_;
-        ar& session_;
+        ar& dog_id_;
+        ar& session_id_;
     }
     
 private:
-    DogRepr dog_;
-    GameSessionRepr session_;
+    uint64_t dog_id_ = 0;
+    std::string session_id_;
 };
 
 class PlayerTokensRepr {
@@ -44,19 +54,23 @@ public:
     explicit PlayerTokensRepr(app::PlayerTokens& tokens_to_players) {
         for (const auto& [token, player] : tokens_to_players.tokens_) {
             PlayerRepr player_repr(*player);
-            std::string token_str(*token);
-            tokens_.emplace(token_str, player_repr);
+            tokens_.emplace(app::TokenToHex(token), player_repr);
         }
     }
 
     void Restore(app::PlayerTokens& tokens_to_players, const model::Game& game) const {
         tokens_to_players.tokens_.clear();
+        tokens_to_players.player_tokens_.clear();
 
         for (const auto& [str, player_repr] : tokens_) {
-            app::Token token(str);
+            auto token = app::TokenFromHex(str);
+            if (!token) {
+                throw std::runtime_error("Invalid token in saved state");
+            }
             app::Player player = player_repr.Restore(game);
             auto player_ptr = std::make_shared<app::Player>(player);
-            tokens_to_players.tokens_.emplace(token, player_ptr);
+            tokens_to_players.player_tokens_.emplace(player_ptr.get(), *token);
+            tokens_to_players.tokens_.emplace(*token, player_ptr);
         }
     }
 
@@ -74,36 +88,26 @@ public:
     PlayersRepr() = default;
 
     explicit PlayersRepr(app::Players& players)
-     : next_player_(players.next_player_), player_tokens_repr_(players.player_tokens_) {
-        for (const auto& [id, player] : players.players_) {
-            PlayerRepr player_repr(*player);
-            uint64_t id_num = *id;
-            players_.emplace(id_num, player_repr);
-        }
-    }
+     : next_player_(players.next_player_), player_tokens_repr_(players.player_tokens_) {}
 
+    // У каждого игрока ровно один токен, поэтому игроки восстанавливаются вместе с токенами
     void Restore(app::Players& players, const model::Game& game) const {
         players.next_player_ = next_player_;
         player_tokens_repr_.Restore(players.player_tokens_, game);
         players.players_.clear();
 
-        for (const auto& [id_num, player_repr] : players_) {
-            model::Dog::Id id{id_num};
-            app::Player player = player_repr.Restore(game);
-            auto player_ptr = std::make_shared<app::Player>(player);
-            players.players_.emplace(id, player_ptr);
+        for (const auto& [token, player_ptr] : players.player_tokens_.tokens_) {
+            players.players_.emplace(player_ptr->GetDog().get(), player_ptr);
         }
     }
 
     template <typename Archive>
     void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
-        ar& players_;
         ar& player_tokens_repr_;
         ar& next_player_;
     }
 
 private:
-    std::unordered_map<uint64_t, PlayerRepr> players_;
     PlayerTokensRepr player_tokens_repr_;
     uint32_t next_player_ = 0;
 };
@@ -115,28 +119,55 @@ public:
     explicit ApplicationRepr(app::Application& application)
      : players_(application.players_)
      , auto_tick_enabled_(application.auto_tick_enabled_)
-     , randomize_spavn_dogs_(application.randomize_spavn_dogs_) {}
+     , randomize_spavn_dogs_(application.randomize_spavn_dogs_)
+     , random_seed_(application.game_.GetRandomSeed()) {
+        for (const auto& [id, session] : application.game_.GetSessions()) {
+            sessions_.emplace_back(*session);
+        }
+    }
 
      void Restore(app::Application& application) const {
+        // Новые сессии получают seed из того же значения, что и до сохранения
+        if (random_seed_) {
+            application.game_.SetRandomSeed(*random_seed_);
+        }
+        for (const auto& session_repr : sessions_) {
+            application.game_.AddGameSession(session_repr.Restore(application.game_));
+        }
         players_.Restore(application.players_, application.game_);
         application.auto_tick_enabled_ = auto_tick_enabled_;
         application.randomize_spavn_dogs_ = randomize_spavn_dogs_;
      }
 
     template <typename Archive>
-    void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
+    void serialize(Archive& ar, const unsigned version) {
+        ar& sessions_;
         ar& players_;
         ar& auto_tick_enabled_;
         ar& randomize_spavn_dogs_;
+        if (version >= 1) {
+            uint64_t seed = random_seed_.value_or(0);
+            ar& seed;
+            random_seed_ = seed;
+        }
     }
 
 private:
+    std::vector<GameSessionRepr> sessions_;
     PlayersRepr players_;
     bool auto_tick_enabled_ = false;
     bool randomize_spavn_dogs_ = false;
+    std::optional<uint64_t> random_seed_;
 };
 
 
+}  // namespace serialization
+
+// Версия 1: seed игры
+BOOST_CLASS_VERSION(::serialization::ApplicationRepr, 1)
+
+namespace serialization {
+
 void AppSerialization(const std::filesystem::path& file_to_serialize_, app::Application& app);
 void AppDeserialization(const std::filesystem::path& file_to_serialize_, app::Application& app);
 
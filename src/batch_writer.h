@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+
+namespace util {
+
+/*
+ *  Фоновая запись пачками. Производители кладут элементы в ограниченную очередь
+ *  и сразу продолжают работу, а фоновый поток отдаёт их функции flush пачками
+ *  по max_batch элементов или раньше, если первый элемент пачки ждёт дольше max_delay.
+ *  Add никогда не ждёт записи: если очередь заполнена, то есть запись давно отстаёт
+ *  от потока данных, элемент отбрасывается и учитывается в метрике dropped, а о начале
+ *  переполнения сообщается обработчику ошибок.
+ *  Если flush бросил исключение, оно передаётся обработчику ошибок. Временную ошибку
+ *  (is_transient вернул true, например, обрыв соединения) пачка переживает целиком: она
+ *  возвращается в начало очереди и записывается повторно с паузой, которая удваивается
+ *  от retry_delay до max_retry_delay. При постоянной ошибке (например, строка нарушает
+ *  ограничение таблицы) пачка записывается по одному элементу, и отбрасываются только
+ *  те, которые не удаётся записать, иначе один плохой элемент навсегда остановил бы запись.
+ *  Без is_transient все ошибки считаются временными.
+ *  При разрушении оставшиеся элементы записываются. Если запись и тогда не удалась,
+ *  остаток очереди отбрасывается и учитывается в dropped.
+ */
+template <typename T>
+class BatchWriter {
+public:
+    using Batch = std::vector<T>;
+    using Flush = std::function<void(const Batch& batch)>;
+    using ErrorHandler = std::function<void(const std::exception& ex)>;
+    using IsTransient = std::function<bool(const std::exception& ex)>;
+
+    struct Config {
+        size_t queue_capacity = 10000;
+        size_t max_batch = 500;
+        std::chrono::milliseconds max_delay{200};
+        std::chrono::milliseconds retry_delay{100};
+        std::chrono::milliseconds max_retry_delay{5000};
+    };
+
+    struct Metrics {
+        metrics::Gauge& queue_depth;
+        metrics::Counter& written;
+        metrics::Counter& dropped;
+        metrics::Counter& retries;
+        metrics::Histogram& flush_duration;
+    };
+
+    // Имена метрик начинаются с prefix
+    static Metrics RegisterMetrics(metrics::Registry& registry, const std::string& prefix) {
+        using namespace std::literals;
+        return Metrics{
+            registry.AddGauge(prefix + "_queue_depth"s, "Items waiting to be written"sv),
+            registry.AddCounter(prefix + "_written_total"s, "Items written"sv),
+            registry.AddCounter(prefix + "_dropped_total"s, "Items dropped because of a full queue, a permanent write error or a failed write on shutdown"sv),
+            registry.AddCounter(prefix + "_retries_total"s, "Failed batch writes that were queued again"sv),
+            registry.AddHistogram(prefix + "_flush_duration_seconds"s, "Duration of a batch write"sv)
+        };
+    }
+
+    BatchWriter(Config config, Flush flush, ErrorHandler error_handler, Metrics metrics, IsTransient is_transient = nullptr)
+        : config_{config}
+        , flush_{std::move(flush)}
+        , error_handler_{std::move(error_handler)}
+        , is_transient_{std::move(is_transient)}
+        , metrics_{metrics}
+        , thread_{[this] {
+            Run();
+        }} {
+    }
+
+    BatchWriter(const BatchWriter&) = delete;
+    BatchWriter& operator=(const BatchWriter&) = delete;
+
+    ~BatchWriter() {
+        {
+            std::lock_guard lock{mutex_};
+            stopped_ = true;
+        }
+        not_empty_.notify_one();
+        thread_.join();
+    }
+
+    // Возвращает false, если очередь заполнена и элемент отброшен
+    bool Add(T item) {
+        {
+            std::unique_lock lock{mutex_};
+            if (queue_.size() >= config_.queue_capacity) {
+                metrics_.dropped.Add();
+                if (!overflowing_) {
+                    // Сообщаем один раз за переполнение, а не о каждом элементе
+                    overflowing_ = true;
+                    lock.unlock();
+                    error_handler_(std::length_error("Batch writer queue is full, items are dropped"));
+                }
+                return false;
+            }
+            overflowing_ = false;
+            queue_.push_back(std::move(item));
+            metrics_.queue_depth.Set(static_cast<int64_t>(queue_.size()));
+        }
+        not_empty_.notify_one();
+        return true;
+    }
+
+    size_t GetQueueDepth() const {
+        std::lock_guard lock{mutex_};
+        return queue_.size();
+    }
+
+private:
+    void Run() {
+        std::unique_lock lock{mutex_};
+        auto retry_delay = config_.retry_delay;
+        while (true) {
+            not_empty_.wait(lock, [this] {
+                return stopped_ || !queue_.empty();
+            });
+            if (queue_.empty()) {
+                // Остановлены и всё записано
+                return;
+            }
+
+            // Копим пачку, пока она не наполнится или первый элемент не прождёт max_delay
+            not_empty_.wait_for(lock, config_.max_delay, [this] {
+                return stopped_ || queue_.size() >= config_.max_batch;
+            });
+
+            const size_t count = std::min(queue_.size(), config_.max_batch);
+            Batch batch(std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.begin() + count));
+            queue_.erase(queue_.begin(), queue_.begin() + count);
+            metrics_.queue_depth.Set(static_cast<int64_t>(queue_.size()));
+
+            const bool stopping = stopped_;
+            lock.unlock();
+            WriteResult result = Write(batch);
+            if (result == WriteResult::PERMANENT) {
+                // Ищем плохие элементы, записывая по одному; до временной ошибки
+                // записанное из пачки убирается
+                result = WriteEach(batch);
+            }
+            lock.lock();
+
+            if (result != WriteResult::TRANSIENT) {
+                retry_delay = config_.retry_delay;
+                continue;
+            }
+            if (stopping) {
+                // Последняя попытка при остановке не удалась, дольше не ждём
+                metrics_.dropped.Add(batch.size() + queue_.size());
+                queue_.clear();
+                metrics_.queue_depth.Set(0);
+                return;
+            }
+
+            // Возвращаем пачку в начало очереди, чтобы сохранить порядок, и ждём перед повтором
+            queue_.insert(queue_.begin(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+            metrics_.queue_depth.Set(static_cast<int64_t>(queue_.size()));
+            metrics_.retries.Add();
+            not_empty_.wait_for(lock, retry_delay, [this] {
+                return stopped_;
+            });
+            retry_delay = std::min(retry_delay * 2, config_.max_retry_delay);
+        }
+    }
+
+    enum class WriteResult {
+        WRITTEN,
+        TRANSIENT,
+        PERMANENT
+    };
+
+    WriteResult Write(const Batch& batch) {
+        const auto start = metrics::Clock::now();
+        WriteResult result = WriteResult::WRITTEN;
+        try {
+            flush_(batch);
+            metrics_.written.Add(batch.size());
+        }
+        catch (const std::exception& ex) {
+            result = !is_transient_ || is_transient_(ex) ? WriteResult::TRANSIENT : WriteResult::PERMANENT;
+            error_handler_(ex);
+        }
+        metrics_.flush_duration.Record(metrics::Clock::now() - start);
+        return result;
+    }
+
+    // Записывает элементы пачки по одному и отбрасывает те, что дают постоянную ошибку.
+    // При временной ошибке в batch остаются ещё не записанные элементы
+    WriteResult WriteEach(Batch& batch) {
+        size_t done = 0;
+        for (; done < batch.size(); ++done) {
+            const WriteResult result = Write(Batch{batch[done]});
+            if (result == WriteResult::TRANSIENT) {
+                break;
+            }
+            if (result == WriteResult::PERMANENT) {
+                metrics_.dropped.Add();
+            }
+        }
+        batch.erase(batch.begin(), batch.begin() + done);
+        return batch.empty() ? WriteResult::WRITTEN : WriteResult::TRANSIENT;
+    }
+
+    Config config_;
+    Flush flush_;
+    ErrorHandler error_handler_;
+    IsTransient is_transient_;
+    Metrics metrics_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::deque<T> queue_;
+    bool stopped_ = false;
+    bool overflowing_ = false;
+
+    // Поток создаётся последним, когда остальные поля уже готовы
+    std::thread thread_;
+};
+
+}  // namespace util
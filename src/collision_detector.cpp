@@ -1,8 +1,134 @@
 #include "collision_detector.h"
 #include <cassert>
+#include <cmath>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace collision_detector {
 
+namespace {
+
+// Равномерная сетка по позициям предметов (broadphase для FindGatherEvents).
+// Предметы переупорядочены по ячейкам и упакованы в массивы x_, y_, width_:
+// предметы ячейки c лежат в диапазоне [cell_begin_[c], cell_begin_[c + 1]),
+// а item_ids_ хранит их исходные индексы.
+class ItemGrid {
+public:
+    using Range = std::pair<size_t, size_t>;
+
+    ItemGrid(const ItemArrays& items, size_t count, double reach) {
+        if (count == 0) {
+            return;
+        }
+
+        min_x_ = max_x_ = items.x[0];
+        min_y_ = max_y_ = items.y[0];
+        for (size_t i = 0; i < count; ++i) {
+            min_x_ = std::min(min_x_, items.x[i]);
+            max_x_ = std::max(max_x_, items.x[i]);
+            min_y_ = std::min(min_y_, items.y[i]);
+            max_y_ = std::max(max_y_, items.y[i]);
+        }
+
+        // В среднем около одного предмета на ячейку, но ячейка не меньше диаметра захвата
+        const double area = std::max(max_x_ - min_x_, 1.0) * std::max(max_y_ - min_y_, 1.0);
+        const double items_count = static_cast<double>(count);
+        cell_size_ = std::max({2.0 * reach, std::sqrt(area / items_count),
+                               std::max(max_x_ - min_x_, max_y_ - min_y_) / (4.0 * items_count)});
+        cols_ = static_cast<size_t>((max_x_ - min_x_) / cell_size_) + 1;
+        rows_ = static_cast<size_t>((max_y_ - min_y_) / cell_size_) + 1;
+
+        std::vector<size_t> item_cell(count);
+        cell_begin_.assign(cols_ * rows_ + 1, 0);
+        for (size_t i = 0; i < count; ++i) {
+            item_cell[i] = CellIndex(items.x[i], items.y[i]);
+            ++cell_begin_[item_cell[i] + 1];
+        }
+        for (size_t c = 1; c < cell_begin_.size(); ++c) {
+            cell_begin_[c] += cell_begin_[c - 1];
+        }
+
+        // Раскладываем по ячейкам, сохраняя возрастание индексов внутри ячейки
+        std::vector<size_t> fill(cell_begin_.begin(), cell_begin_.end() - 1);
+        item_ids_.resize(count);
+        x_.resize(count);
+        y_.resize(count);
+        width_.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            const size_t pos = fill[item_cell[i]]++;
+            item_ids_[pos] = i;
+            x_[pos] = items.x[i];
+            y_[pos] = items.y[i];
+            width_[pos] = items.width[i];
+        }
+    }
+
+    // Дописывает в out диапазоны упакованных предметов из ячеек, пересекающих прямоугольник.
+    // Если прямоугольник накрывает больше ячеек, чем есть предметов, дешевле
+    // проверить все предметы - тогда возвращается один диапазон на всё.
+    void Query(geom::Point2D min, geom::Point2D max, std::vector<Range>& out) const {
+        if (item_ids_.empty() || max.x < min_x_ || max.y < min_y_ || min.x > max_x_ || min.y > max_y_) {
+            return;
+        }
+
+        const size_t col_begin = ToCell(min.x - min_x_, cols_);
+        const size_t col_end = ToCell(max.x - min_x_, cols_);
+        const size_t row_begin = ToCell(min.y - min_y_, rows_);
+        const size_t row_end = ToCell(max.y - min_y_, rows_);
+
+        if ((col_end - col_begin + 1) * (row_end - row_begin + 1) > item_ids_.size()) {
+            out.emplace_back(0, item_ids_.size());
+            return;
+        }
+
+        // Ячейки одной строки сетки идут подряд, поэтому строка - один диапазон
+        for (size_t row = row_begin; row <= row_end; ++row) {
+            const size_t first = row * cols_ + col_begin;
+            const size_t last = row * cols_ + col_end;
+            if (cell_begin_[first] != cell_begin_[last + 1]) {
+                out.emplace_back(cell_begin_[first], cell_begin_[last + 1]);
+            }
+        }
+    }
+
+    ItemArrays GetPacked(size_t offset) const noexcept {
+        return {x_.data() + offset, y_.data() + offset, width_.data() + offset};
+    }
+
+    size_t GetItemId(size_t packed_idx) const noexcept {
+        return item_ids_[packed_idx];
+    }
+
+private:
+    size_t ToCell(double offset, size_t count) const {
+        if (offset <= 0.0) {
+            return 0;
+        }
+        return std::min(static_cast<size_t>(offset / cell_size_), count - 1);
+    }
+
+    size_t CellIndex(double x, double y) const {
+        return ToCell(y - min_y_, rows_) * cols_ + ToCell(x - min_x_, cols_);
+    }
+
+    double min_x_ = 0.0;
+    double min_y_ = 0.0;
+    double max_x_ = 0.0;
+    double max_y_ = 0.0;
+    double cell_size_ = 1.0;
+    size_t cols_ = 0;
+    size_t rows_ = 0;
+    std::vector<size_t> cell_begin_;
+    std::vector<size_t> item_ids_;
+    std::vector<double> x_;
+    std::vector<double> y_;
+    std::vector<double> width_;
+};
+
+}  // namespace
+
 CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D c) {
     // Проверим, что перемещение ненулевое.
     // Тут приходится использовать строгое равенство, а не приближённое,
@@ -22,6 +148,87 @@ CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D
     return CollectionResult(sq_distance, proj_ratio);
 }
 
+uint64_t TryCollectPoints(geom::Point2D a, geom::Point2D b, double gatherer_width, const ItemArrays& items,
+                          size_t count, double* sq_distance, double* proj_ratio) {
+    assert(b.x != a.x || b.y != a.y);
+    assert(count <= MAX_BATCH_SIZE);
+
+    // Формулы и порядок операций те же, что в TryCollectPoint, поэтому результаты совпадают
+    const double v_x = b.x - a.x;
+    const double v_y = b.y - a.y;
+    const double v_len2 = v_x * v_x + v_y * v_y;
+
+    uint64_t mask = 0;
+    size_t i = 0;
+
+#if defined(__AVX__)
+    const __m256d a_x4 = _mm256_set1_pd(a.x);
+    const __m256d a_y4 = _mm256_set1_pd(a.y);
+    const __m256d v_x4 = _mm256_set1_pd(v_x);
+    const __m256d v_y4 = _mm256_set1_pd(v_y);
+    const __m256d v_len2_4 = _mm256_set1_pd(v_len2);
+    const __m256d width4 = _mm256_set1_pd(gatherer_width);
+    const __m256d zero4 = _mm256_setzero_pd();
+    const __m256d one4 = _mm256_set1_pd(1.0);
+
+    for (; i + 4 <= count; i += 4) {
+        const __m256d u_x = _mm256_sub_pd(_mm256_loadu_pd(items.x + i), a_x4);
+        const __m256d u_y = _mm256_sub_pd(_mm256_loadu_pd(items.y + i), a_y4);
+        const __m256d u_dot_v = _mm256_add_pd(_mm256_mul_pd(u_x, v_x4), _mm256_mul_pd(u_y, v_y4));
+        const __m256d u_len2 = _mm256_add_pd(_mm256_mul_pd(u_x, u_x), _mm256_mul_pd(u_y, u_y));
+        const __m256d proj = _mm256_div_pd(u_dot_v, v_len2_4);
+        const __m256d sq_dist = _mm256_sub_pd(u_len2, _mm256_div_pd(_mm256_mul_pd(u_dot_v, u_dot_v), v_len2_4));
+        const __m256d radius = _mm256_add_pd(width4, _mm256_loadu_pd(items.width + i));
+
+        const __m256d collected = _mm256_and_pd(
+            _mm256_and_pd(_mm256_cmp_pd(proj, zero4, _CMP_GE_OQ), _mm256_cmp_pd(proj, one4, _CMP_LE_OQ)),
+            _mm256_cmp_pd(sq_dist, _mm256_mul_pd(radius, radius), _CMP_LE_OQ));
+
+        _mm256_storeu_pd(proj_ratio + i, proj);
+        _mm256_storeu_pd(sq_distance + i, sq_dist);
+        mask |= static_cast<uint64_t>(_mm256_movemask_pd(collected)) << i;
+    }
+#elif defined(__SSE2__)
+    const __m128d a_x2 = _mm_set1_pd(a.x);
+    const __m128d a_y2 = _mm_set1_pd(a.y);
+    const __m128d v_x2 = _mm_set1_pd(v_x);
+    const __m128d v_y2 = _mm_set1_pd(v_y);
+    const __m128d v_len2_2 = _mm_set1_pd(v_len2);
+    const __m128d width2 = _mm_set1_pd(gatherer_width);
+    const __m128d zero2 = _mm_setzero_pd();
+    const __m128d one2 = _mm_set1_pd(1.0);
+
+    for (; i + 2 <= count; i += 2) {
+        const __m128d u_x = _mm_sub_pd(_mm_loadu_pd(items.x + i), a_x2);
+        const __m128d u_y = _mm_sub_pd(_mm_loadu_pd(items.y + i), a_y2);
+        const __m128d u_dot_v = _mm_add_pd(_mm_mul_pd(u_x, v_x2), _mm_mul_pd(u_y, v_y2));
+        const __m128d u_len2 = _mm_add_pd(_mm_mul_pd(u_x, u_x), _mm_mul_pd(u_y, u_y));
+        const __m128d proj = _mm_div_pd(u_dot_v, v_len2_2);
+        const __m128d sq_dist = _mm_sub_pd(u_len2, _mm_div_pd(_mm_mul_pd(u_dot_v, u_dot_v), v_len2_2));
+        const __m128d radius = _mm_add_pd(width2, _mm_loadu_pd(items.width + i));
+
+        const __m128d collected = _mm_and_pd(
+            _mm_and_pd(_mm_cmpge_pd(proj, zero2), _mm_cmple_pd(proj, one2)),
+            _mm_cmple_pd(sq_dist, _mm_mul_pd(radius, radius)));
+
+        _mm_storeu_pd(proj_ratio + i, proj);
+        _mm_storeu_pd(sq_distance + i, sq_dist);
+        mask |= static_cast<uint64_t>(_mm_movemask_pd(collected)) << i;
+    }
+#endif
+
+    for (; i < count; ++i) {
+        const auto result = TryCollectPoint(a, b, geom::Point2D{items.x[i], items.y[i]});
+        proj_ratio[i] = result.proj_ratio;
+        sq_distance[i] = result.sq_distance;
+        if (result.IsCollected(gatherer_width + items.width[i])) {
+            mask |= uint64_t{1} << i;
+        }
+    }
+
+    return mask;
+}
+
 // В задании на разработку тестов реализовывать следующую функцию не нужно -
 // она будет линковаться извне.
 std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
@@ -31,24 +238,83 @@ std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provide
         return p1.x == p2.x && p1.y == p2.y;
     };
 
-    for (size_t g = 0; g < provider.GatherersCount(); ++g) {
-        Gatherer gatherer = provider.GetGatherer(g);
+    const size_t items_count = provider.ItemsCount();
+    std::vector<double> items_x;
+    std::vector<double> items_y;
+    std::vector<double> items_width;
+
+    // Если провайдер не отдаёт предметы массивами, упаковываем их сами
+    auto items = provider.GetItemArrays();
+    if (!items) {
+        items_x.resize(items_count);
+        items_y.resize(items_count);
+        items_width.resize(items_count);
+        for (size_t i = 0; i < items_count; ++i) {
+            const Item item = provider.GetItem(i);
+            items_x[i] = item.position.x;
+            items_y[i] = item.position.y;
+            items_width[i] = item.width;
+        }
+        items = ItemArrays{items_x.data(), items_y.data(), items_width.data()};
+    }
+
+    double max_item_width = 0.0;
+    for (size_t i = 0; i < items_count; ++i) {
+        max_item_width = std::max(max_item_width, items->width[i]);
+    }
+
+    std::vector<Gatherer> gatherers(provider.GatherersCount());
+    double max_gatherer_width = 0.0;
+    for (size_t g = 0; g < gatherers.size(); ++g) {
+        gatherers[g] = provider.GetGatherer(g);
+        max_gatherer_width = std::max(max_gatherer_width, gatherers[g].width);
+    }
+
+    const ItemGrid grid(*items, items_count, max_gatherer_width + max_item_width);
+    std::vector<ItemGrid::Range> ranges;
+    std::vector<GatheringEvent> gatherer_events;
+    double sq_distance[MAX_BATCH_SIZE];
+    double proj_ratio[MAX_BATCH_SIZE];
+
+    for (size_t g = 0; g < gatherers.size(); ++g) {
+        const Gatherer& gatherer = gatherers[g];
         if (eq_pt(gatherer.start_pos, gatherer.end_pos)) {
             continue;
         }
-        for (size_t i = 0; i < provider.ItemsCount(); ++i) {
-            Item item = provider.GetItem(i);
-            auto collect_result
-                = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.position);
-
-            if (collect_result.IsCollected(gatherer.width + item.width)) {
-                GatheringEvent evt{.item_id = i,
-                                   .gatherer_id = g,
-                                   .sq_distance = collect_result.sq_distance,
-                                   .time = collect_result.proj_ratio};
-                detected_events.push_back(evt);
+
+        // Подобрать можно только предметы в пределах радиуса захвата от отрезка движения
+        const double reach = gatherer.width + max_item_width;
+        const geom::Point2D min{std::min(gatherer.start_pos.x, gatherer.end_pos.x) - reach,
+                                std::min(gatherer.start_pos.y, gatherer.end_pos.y) - reach};
+        const geom::Point2D max{std::max(gatherer.start_pos.x, gatherer.end_pos.x) + reach,
+                                std::max(gatherer.start_pos.y, gatherer.end_pos.y) + reach};
+
+        ranges.clear();
+        gatherer_events.clear();
+        grid.Query(min, max, ranges);
+
+        for (auto [begin, end] : ranges) {
+            for (size_t offset = begin; offset < end; offset += MAX_BATCH_SIZE) {
+                const size_t count = std::min(MAX_BATCH_SIZE, end - offset);
+                uint64_t mask = TryCollectPoints(gatherer.start_pos, gatherer.end_pos, gatherer.width,
+                                                 grid.GetPacked(offset), count, sq_distance, proj_ratio);
+
+                for (; mask != 0; mask &= mask - 1) {
+                    const size_t lane = static_cast<size_t>(__builtin_ctzll(mask));
+                    gatherer_events.push_back({.item_id = grid.GetItemId(offset + lane),
+                                               .gatherer_id = g,
+                                               .sq_distance = sq_distance[lane],
+                                               .time = proj_ratio[lane]});
+                }
             }
         }
+
+        // Порядок событий как при полном переборе - от него зависит итоговая сортировка
+        std::sort(gatherer_events.begin(), gatherer_events.end(),
+                  [](const GatheringEvent& e_l, const GatheringEvent& e_r) {
+                      return e_l.item_id < e_r.item_id;
+                  });
+        detected_events.insert(detected_events.end(), gatherer_events.begin(), gatherer_events.end());
     }
 
     std::sort(detected_events.begin(), detected_events.end(),
@@ -3,6 +3,8 @@
 #include "geom.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <optional>
 #include <vector>
 
 namespace collision_detector {
@@ -23,6 +25,23 @@ struct CollectionResult {
 // Эта функция реализована в уроке.
 CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D c);
 
+// Предметы в виде параллельных массивов координат и ширин
+struct ItemArrays {
+    const double* x;
+    const double* y;
+    const double* width;
+};
+
+// Максимальное число предметов, проверяемых одним вызовом TryCollectPoints
+inline constexpr size_t MAX_BATCH_SIZE = 64;
+
+// Пакетный вариант TryCollectPoint: проверяет count (не больше MAX_BATCH_SIZE) предметов сразу,
+// используя векторные инструкции, если они доступны. Результаты по каждому предмету пишутся
+// в sq_distance и proj_ratio, а возвращается битовая маска подобранных предметов.
+// Результаты совпадают с TryCollectPoint бит в бит.
+uint64_t TryCollectPoints(geom::Point2D a, geom::Point2D b, double gatherer_width, const ItemArrays& items,
+                          size_t count, double* sq_distance, double* proj_ratio);
+
 struct Item {
     geom::Point2D position;
     double width;
@@ -43,6 +62,11 @@ public:
     virtual Item GetItem(size_t idx) const = 0;
     virtual size_t GatherersCount() const = 0;
     virtual Gatherer GetGatherer(size_t idx) const = 0;
+
+    // Провайдер может отдать предметы массивами, чтобы не собирать их по одному через GetItem
+    virtual std::optional<ItemArrays> GetItemArrays() const {
+        return std::nullopt;
+    }
 };
 
 struct GatheringEvent {
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Хеш-таблица с открытой адресацией по схеме Robin Hood.
+ *  Пары ключ-значение лежат подряд в векторе, а таблица корзин хранит только
+ *  индекс пары, расстояние от домашней корзины и 8 бит хеша. Поэтому поиск
+ *  почти всегда укладывается в одну-две кеш-линии, а обход идёт по непрерывной памяти.
+ *  При удалении на место пары переносится последняя, так что удаление
+ *  делает недействительными итераторы и ссылки на последнюю пару.
+ *  Интерфейс повторяет нужную нам часть std::unordered_map.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using size_type = size_t;
+    using Values = std::vector<value_type>;
+    using iterator = typename Values::iterator;
+    using const_iterator = typename Values::const_iterator;
+
+    FlatHashMap() = default;
+
+    iterator begin() noexcept {
+        return values_.begin();
+    }
+
+    iterator end() noexcept {
+        return values_.end();
+    }
+
+    const_iterator begin() const noexcept {
+        return values_.begin();
+    }
+
+    const_iterator end() const noexcept {
+        return values_.end();
+    }
+
+    size_t size() const noexcept {
+        return values_.size();
+    }
+
+    bool empty() const noexcept {
+        return values_.empty();
+    }
+
+    void clear() noexcept {
+        values_.clear();
+        buckets_.assign(buckets_.size(), Bucket{});
+    }
+
+    void reserve(size_t count) {
+        values_.reserve(count);
+        if (count > Capacity()) {
+            Rehash(BucketsFor(count));
+        }
+    }
+
+    iterator find(const Key& key) {
+        const size_t bucket = FindBucket(key);
+        return bucket == NOT_FOUND ? end() : begin() + buckets_[bucket].value_index;
+    }
+
+    const_iterator find(const Key& key) const {
+        const size_t bucket = FindBucket(key);
+        return bucket == NOT_FOUND ? end() : begin() + buckets_[bucket].value_index;
+    }
+
+    bool contains(const Key& key) const {
+        return FindBucket(key) != NOT_FOUND;
+    }
+
+    Value& at(const Key& key) {
+        auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("FlatHashMap::at");
+        }
+        return it->second;
+    }
+
+    const Value& at(const Key& key) const {
+        auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("FlatHashMap::at");
+        }
+        return it->second;
+    }
+
+    Value& operator[](const Key& key) {
+        return try_emplace(key).first->second;
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+        if (values_.size() + 1 > Capacity()) {
+            Rehash(buckets_.empty() ? MIN_BUCKETS : buckets_.size() * 2);
+        }
+
+        const size_t hash = Mix(key);
+        uint32_t dist_and_fingerprint = DistAndFingerprint(hash);
+        size_t bucket = HomeBucket(hash);
+
+        // Пока встречаются корзины не беднее нашей, ключ ещё может найтись
+        while (dist_and_fingerprint <= buckets_[bucket].dist_and_fingerprint) {
+            const auto& current = buckets_[bucket];
+            if (current.dist_and_fingerprint == dist_and_fingerprint
+                && equal_(values_[current.value_index].first, key)) {
+                return {begin() + current.value_index, false};
+            }
+            dist_and_fingerprint += DIST_INC;
+            bucket = NextBucket(bucket);
+        }
+
+        const auto value_index = static_cast<uint32_t>(values_.size());
+        values_.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
+        PlaceAndShiftUp(Bucket{dist_and_fingerprint, value_index}, bucket);
+        return {begin() + value_index, true};
+    }
+
+    template <typename K, typename V>
+    std::pair<iterator, bool> emplace(K&& key, V&& value) {
+        return try_emplace(Key(std::forward<K>(key)), std::forward<V>(value));
+    }
+
+    std::pair<iterator, bool> insert(value_type value) {
+        return try_emplace(value.first, std::move(value.second));
+    }
+
+    size_t erase(const Key& key) {
+        const size_t bucket = FindBucket(key);
+        if (bucket == NOT_FOUND) {
+            return 0;
+        }
+        EraseBucket(bucket);
+        return 1;
+    }
+
+    // Возвращает итератор на пару, занявшую место удалённой
+    iterator erase(const_iterator pos) {
+        const auto value_index = static_cast<size_t>(pos - values_.cbegin());
+        EraseBucket(FindBucketOfValue(value_index));
+        return begin() + value_index;
+    }
+
+private:
+    struct Bucket {
+        // Старшие 24 бита - расстояние от домашней корзины плюс один, младшие 8 - часть хеша.
+        // Ноль означает пустую корзину
+        uint32_t dist_and_fingerprint = 0;
+        uint32_t value_index = 0;
+    };
+
+    static constexpr uint32_t DIST_INC = 1u << 8;
+    static constexpr uint32_t FINGERPRINT_MASK = DIST_INC - 1;
+    static constexpr size_t MIN_BUCKETS = 8;
+    static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+    // Максимальная заполненность таблицы корзин - 4/5
+    static constexpr size_t LOAD_NUM = 4;
+    static constexpr size_t LOAD_DEN = 5;
+
+    // std::hash для целых в libstdc++ тождественен, поэтому хеш перемешивается
+    size_t Mix(const Key& key) const {
+        uint64_t h = static_cast<uint64_t>(hash_(key));
+        h *= 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+
+    static uint32_t DistAndFingerprint(size_t hash) noexcept {
+        return DIST_INC | static_cast<uint32_t>(hash & FINGERPRINT_MASK);
+    }
+
+    size_t HomeBucket(size_t hash) const noexcept {
+        return (hash >> 8) & (buckets_.size() - 1);
+    }
+
+    size_t NextBucket(size_t bucket) const noexcept {
+        return (bucket + 1) & (buckets_.size() - 1);
+    }
+
+    size_t Capacity() const noexcept {
+        return buckets_.size() * LOAD_NUM / LOAD_DEN;
+    }
+
+    static size_t BucketsFor(size_t count) noexcept {
+        size_t buckets = MIN_BUCKETS;
+        while (buckets * LOAD_NUM / LOAD_DEN < count) {
+            buckets *= 2;
+        }
+        return buckets;
+    }
+
+    size_t FindBucket(const Key& key) const {
+        if (values_.empty()) {
+            return NOT_FOUND;
+        }
+
+        const size_t hash = Mix(key);
+        uint32_t dist_and_fingerprint = DistAndFingerprint(hash);
+        size_t bucket = HomeBucket(hash);
+
+        while (true) {
+            const auto& current = buckets_[bucket];
+            if (current.dist_and_fingerprint == dist_and_fingerprint
+                && equal_(values_[current.value_index].first, key)) {
+                return bucket;
+            }
+            // Ключ стоял бы не дальше корзины, более "бедной", чем он
+            if (current.dist_and_fingerprint < dist_and_fingerprint) {
+                return NOT_FOUND;
+            }
+            dist_and_fingerprint += DIST_INC;
+            bucket = NextBucket(bucket);
+        }
+    }
+
+    size_t FindBucketOfValue(size_t value_index) const {
+        size_t bucket = HomeBucket(Mix(values_[value_index].first));
+        while (buckets_[bucket].value_index != value_index || buckets_[bucket].dist_and_fingerprint == 0) {
+            bucket = NextBucket(bucket);
+        }
+        return bucket;
+    }
+
+    void PlaceAndShiftUp(Bucket bucket, size_t index) noexcept {
+        while (buckets_[index].dist_and_fingerprint != 0) {
+            std::swap(bucket, buckets_[index]);
+            bucket.dist_and_fingerprint += DIST_INC;
+            index = NextBucket(index);
+        }
+        buckets_[index] = bucket;
+    }
+
+    void EraseBucket(size_t bucket) {
+        const size_t value_index = buckets_[bucket].value_index;
+
+        // Сдвигаем назад хвост цепочки, пока корзины стоят не на своих местах
+        size_t next = NextBucket(bucket);
+        while (buckets_[next].dist_and_fingerprint >= DIST_INC * 2) {
+            buckets_[bucket] = {buckets_[next].dist_and_fingerprint - DIST_INC, buckets_[next].value_index};
+            bucket = next;
+            next = NextBucket(next);
+        }
+        buckets_[bucket] = Bucket{};
+
+        // Последняя пара переезжает на освободившееся место
+        const size_t last = values_.size() - 1;
+        if (value_index != last) {
+            buckets_[FindBucketOfValue(last)].value_index = static_cast<uint32_t>(value_index);
+            values_[value_index] = std::move(values_[last]);
+        }
+        values_.pop_back();
+    }
+
+    void Rehash(size_t bucket_count) {
+        buckets_.assign(bucket_count, Bucket{});
+        for (size_t i = 0; i < values_.size(); ++i) {
+            const size_t hash = Mix(values_[i].first);
+            uint32_t dist_and_fingerprint = DistAndFingerprint(hash);
+            size_t bucket = HomeBucket(hash);
+            while (dist_and_fingerprint <= buckets_[bucket].dist_and_fingerprint) {
+                dist_and_fingerprint += DIST_INC;
+                bucket = NextBucket(bucket);
+            }
+            PlaceAndShiftUp(Bucket{dist_and_fingerprint, static_cast<uint32_t>(i)}, bucket);
+        }
+    }
+
+    Values values_;
+    std::vector<Bucket> buckets_;
+    [[no_unique_address]] Hash hash_;
+    [[no_unique_address]] KeyEqual equal_;
+};
+
+}  // namespace util
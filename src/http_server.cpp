@@ -53,6 +53,9 @@ void SessionBase::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t byte
     if (ec) {
         return ReportError(ec, "read"sv);
     }
+    if (websocket::is_upgrade(request_)) {
+        return HandleUpgrade(std::move(request_));
+    }
     HandleRequest(std::move(request_));
 }
 
@@ -60,4 +63,147 @@ void SessionBase::Close() {
     stream_.socket().shutdown(tcp::socket::shutdown_send);
 }
 
+beast::tcp_stream SessionBase::ReleaseStream() {
+    return std::move(stream_);
+}
+
+
+WebSocketSession::WebSocketSession(beast::tcp_stream&& stream)
+    : ws_(std::move(stream)) {
+}
+
+void WebSocketSession::Accept(HttpRequest request, std::string protocol, AcceptHandler on_accept,
+                              MessageHandler on_message, CloseHandler on_close) {
+    on_accept_ = std::move(on_accept);
+    on_message_ = std::move(on_message);
+    on_close_ = std::move(on_close);
+
+    // У WebSocket свои таймауты, таймаут HTTP-сессии больше не нужен
+    beast::get_lowest_layer(ws_).expires_never();
+    ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+    if (!protocol.empty()) {
+        ws_.set_option(websocket::stream_base::decorator([protocol](websocket::response_type& res) {
+            res.set(http::field::sec_websocket_protocol, protocol);
+        }));
+    }
+
+    auto req = std::make_shared<HttpRequest>(std::move(request));
+    ws_.async_accept(*req, [req, self = shared_from_this()](beast::error_code ec) {
+        self->OnAccept(ec);
+    });
+}
+
+void WebSocketSession::Reject(HttpRequest request, std::string reason) {
+    beast::get_lowest_layer(ws_).expires_after(30s);
+
+    auto req = std::make_shared<HttpRequest>(std::move(request));
+    ws_.async_accept(*req, [req, reason = std::move(reason), self = shared_from_this()](beast::error_code ec) {
+        if (ec) {
+            return ReportError(ec, "websocket accept"sv);
+        }
+        websocket::close_reason close_reason{websocket::close_code::policy_error, reason};
+        self->ws_.async_close(close_reason, [self](beast::error_code ec) {
+            if (ec) {
+                ReportError(ec, "websocket close"sv);
+            }
+        });
+    });
+}
+
+void WebSocketSession::Send(Message message) {
+    net::post(ws_.get_executor(), [self = shared_from_this(), message = std::move(message)]() mutable {
+        auto& queue = self->queue_;
+        if (queue.size() >= MAX_QUEUE_SIZE) {
+            // Отправляемое сейчас сообщение трогать нельзя
+            queue.erase(queue.begin() + (self->writing_ ? 1 : 0));
+        }
+        queue.push_back(std::move(message));
+
+        // До завершения рукопожатия писать в поток нельзя, очередь отправит OnAccept
+        if (self->accepted_ && !self->writing_) {
+            self->DoWrite();
+        }
+    });
+}
+
+void WebSocketSession::Close() {
+    net::post(ws_.get_executor(), [self = shared_from_this()] {
+        if (!self->ws_.is_open()) {
+            return;
+        }
+        self->ws_.async_close(websocket::close_code::normal, [self](beast::error_code ec) {
+            if (ec) {
+                ReportError(ec, "websocket close"sv);
+            }
+        });
+    });
+}
+
+void WebSocketSession::OnAccept(beast::error_code ec) {
+    if (ec) {
+        ReportError(ec, "websocket accept"sv);
+        queue_.clear();
+        return OnClose();
+    }
+
+    accepted_ = true;
+    if (auto on_accept = std::move(on_accept_)) {
+        on_accept_ = nullptr;
+        on_accept();
+    }
+    if (!queue_.empty() && !writing_) {
+        DoWrite();
+    }
+    Read();
+}
+
+void WebSocketSession::Read() {
+    ws_.async_read(buffer_, beast::bind_front_handler(&WebSocketSession::OnRead, shared_from_this()));
+}
+
+void WebSocketSession::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+    if (ec) {
+        if (ec != websocket::error::closed) {
+            ReportError(ec, "websocket read"sv);
+        }
+        return OnClose();
+    }
+
+    std::string message = beast::buffers_to_string(buffer_.data());
+    buffer_.consume(buffer_.size());
+
+    if (on_message_) {
+        on_message_(std::move(message));
+    }
+    Read();
+}
+
+void WebSocketSession::DoWrite() {
+    writing_ = true;
+    ws_.text(true);
+    ws_.async_write(net::buffer(*queue_.front()),
+                    beast::bind_front_handler(&WebSocketSession::OnWrite, shared_from_this()));
+}
+
+void WebSocketSession::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    writing_ = false;
+    queue_.pop_front();
+
+    if (ec) {
+        queue_.clear();
+        return ReportError(ec, "websocket write"sv);
+    }
+
+    if (!queue_.empty()) {
+        DoWrite();
+    }
+}
+
+void WebSocketSession::OnClose() {
+    if (auto on_close = std::move(on_close_)) {
+        on_close_ = nullptr;
+        on_close();
+    }
+}
+
 }  // namespace http_server
@@ -7,9 +7,13 @@
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
 #include <boost/asio/dispatch.hpp>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <filesystem>
+#include <memory>
 
 // Ядро асинхронного HTTP-сервера будет располагаться в пространстве имён http_server
 namespace http_server {
@@ -18,12 +22,66 @@ namespace net = boost::asio;
 namespace sys = boost::system;
 namespace beast = boost::beast;
 namespace http = beast::http;
+namespace websocket = beast::websocket;
 using tcp = net::ip::tcp;
 
 using namespace std::literals;
 
 void ReportError(beast::error_code ec, std::string_view what);
 
+// WebSocket-соединение, в которое переключилась HTTP-сессия
+class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
+public:
+    using HttpRequest = http::request<http::string_body>;
+    using Message = std::shared_ptr<const std::string>;
+    using AcceptHandler = std::function<void()>;
+    using MessageHandler = std::function<void(std::string message)>;
+    using CloseHandler = std::function<void()>;
+
+    // Сколько сообщений может ждать отправки. Медленному клиенту отбрасываются
+    // самые старые из ожидающих, чтобы он получал свежие данные
+    static constexpr size_t MAX_QUEUE_SIZE = 8;
+
+    explicit WebSocketSession(beast::tcp_stream&& stream);
+
+    // Завершает рукопожатие, вызывает on_accept и начинает читать сообщения клиента.
+    // Непустой protocol возвращается клиенту как выбранный подпротокол
+    void Accept(HttpRequest request, std::string protocol, AcceptHandler on_accept,
+                MessageHandler on_message, CloseHandler on_close);
+    // Завершает рукопожатие и сразу закрывает соединение, сообщая причину
+    void Reject(HttpRequest request, std::string reason);
+
+    // Send и Close можно вызывать из любого потока. Сообщения, отправленные до
+    // завершения рукопожатия, ждут в очереди
+    void Send(Message message);
+    void Close();
+
+private:
+    void OnAccept(beast::error_code ec);
+    void Read();
+    void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read);
+    void DoWrite();
+    void OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
+    void OnClose();
+
+    websocket::stream<beast::tcp_stream> ws_;
+    beast::flat_buffer buffer_;
+    // Первое сообщение очереди может быть в процессе отправки
+    std::deque<Message> queue_;
+    bool writing_ = false;
+    bool accepted_ = false;
+    AcceptHandler on_accept_;
+    MessageHandler on_message_;
+    CloseHandler on_close_;
+};
+
+// Обработчик переключения на WebSocket по умолчанию: такие соединения не поддерживаются
+struct RejectUpgrade {
+    void operator()(std::shared_ptr<WebSocketSession> ws, http::request<http::string_body>&& request) const {
+        ws->Reject(std::move(request), "WebSocket is not supported");
+    }
+};
+
 class SessionBase {
 public:
     // Запрещаем копирование и присваивание объектов SessionBase и его наследников
@@ -48,6 +106,9 @@ protected:
     using HttpRequest = http::request<http::string_body>;
     ~SessionBase() = default;
 
+    // Забирает поток у сессии при переключении на WebSocket
+    beast::tcp_stream ReleaseStream();
+
 private:
     void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
     void Read();
@@ -56,6 +117,7 @@ private:
 
     // Обработку запроса делегируем подклассу
     virtual void HandleRequest(HttpRequest&& request) = 0;
+    virtual void HandleUpgrade(HttpRequest&& request) = 0;
 
     virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
 
@@ -67,13 +129,14 @@ private:
 
 
 
-template <typename RequestHandler>
-class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler>> {
+template <typename RequestHandler, typename UpgradeHandler = RejectUpgrade>
+class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler, UpgradeHandler>> {
 public:
-    template <typename Handler>
-    Session(tcp::socket&& socket, Handler&& request_handler)
+    template <typename Handler, typename Upgrade>
+    Session(tcp::socket&& socket, Handler&& request_handler, Upgrade&& upgrade_handler)
         : SessionBase(std::move(socket))
-        , request_handler_(std::forward<Handler>(request_handler)) {
+        , request_handler_(std::forward<Handler>(request_handler))
+        , upgrade_handler_(std::forward<Upgrade>(upgrade_handler)) {
     }
 private:
     void HandleRequest(HttpRequest&& request) override {
@@ -85,24 +148,32 @@ private:
         });
     }
 
+    void HandleUpgrade(HttpRequest&& request) override {
+        // Дальше соединением владеет WebSocketSession, HTTP-сессия завершается
+        auto ws = std::make_shared<WebSocketSession>(ReleaseStream());
+        upgrade_handler_(std::move(ws), std::move(request));
+    }
+
     std::shared_ptr<SessionBase> GetSharedThis() override {
         return this->shared_from_this();
     } 
 
     RequestHandler request_handler_;
+    UpgradeHandler upgrade_handler_;
 };
 
 
 
-template <typename RequestHandler>
-class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
+template <typename RequestHandler, typename UpgradeHandler = RejectUpgrade>
+class Listener : public std::enable_shared_from_this<Listener<RequestHandler, UpgradeHandler>> {
 public:
-    template <typename Handler>
-    Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler)
+    template <typename Handler, typename Upgrade>
+    Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler, Upgrade&& upgrade_handler)
         : ioc_(ioc)
         // Обработчики асинхронных операций acceptor_ будут вызываться в своём strand
         , acceptor_(net::make_strand(ioc))
-        , request_handler_(std::forward<Handler>(request_handler)) {
+        , request_handler_(std::forward<Handler>(request_handler))
+        , upgrade_handler_(std::forward<Upgrade>(upgrade_handler)) {
         // Открываем acceptor, используя протокол (IPv4 или IPv6), указанный в endpoint
         acceptor_.open(endpoint.protocol());
 
@@ -125,7 +196,7 @@ public:
 private:
 
     void AsyncRunSession(tcp::socket&& socket) {
-        std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_)->Run();
+        std::make_shared<Session<RequestHandler, UpgradeHandler>>(std::move(socket), request_handler_, upgrade_handler_)->Run();
     }
 
     void DoAccept() {
@@ -162,17 +233,20 @@ private:
     net::io_context& ioc_;
     tcp::acceptor acceptor_;
     RequestHandler request_handler_;
+    UpgradeHandler upgrade_handler_;
 };
 
 
 
-template <typename RequestHandler>
-void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
+template <typename RequestHandler, typename UpgradeHandler = RejectUpgrade>
+void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler,
+               UpgradeHandler&& upgrade_handler = {}) {
     // При помощи decay_t исключим ссылки из типа RequestHandler,
     // чтобы Listener хранил RequestHandler по значению
-    using MyListener = Listener<std::decay_t<RequestHandler>>;
+    using MyListener = Listener<std::decay_t<RequestHandler>, std::decay_t<UpgradeHandler>>;
 
-    std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
+    std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler),
+                                 std::forward<UpgradeHandler>(upgrade_handler))->Run();
 }
 
 }  // namespace http_server
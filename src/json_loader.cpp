@@ -159,6 +159,11 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
         game.SetDefBagCapacity(static_cast<size_t>(def_speed));
     }
 
+    if (json_data.as_object().contains(root_fields::DEFAULT_SESSION_CAPACITY)) {
+        auto session_capacity = json_data.at(root_fields::DEFAULT_SESSION_CAPACITY).get_int64();
+        game.SetDefSessionCapacity(static_cast<size_t>(session_capacity));
+    }
+
     auto json_maps = json_data.at(root_fields::MAPS).as_array();
 
     for(const auto& json_map : json_maps) {
@@ -225,6 +230,14 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
             map.SetBagCapacity(bag_capacity);
         }
 
+        if (map_obj.contains(map_fields::SESSION_CAPACITY)) {
+            auto session_capacity = map_obj.at(map_fields::SESSION_CAPACITY).get_int64();
+            map.SetSessionCapacity(static_cast<size_t>(session_capacity));
+        }
+        else {
+            map.SetSessionCapacity(game.GetDefSessionCapacity());
+        }
+
         map.BuildRoadIndexes();
         game.AddMap(std::move(map));
     }
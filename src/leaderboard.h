@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Первые capacity элементов таблицы рекордов в памяти, упорядоченные по Less.
+ *  Заполняется из базы при запуске (Reset) и дополняется по мере записи новых
+ *  элементов (Add). Окно [offset, offset + count) отдаётся из памяти, если оно
+ *  целиком попадает в хранимую часть или если в памяти вся таблица. Иначе Find
+ *  возвращает nullopt, и страницу нужно читать из базы. FindAfter делает то же
+ *  для окна, которое начинается сразу после ключа key.
+ *  Читать и дополнять можно из разных потоков.
+ */
+template <typename T, typename Less>
+class Leaderboard {
+public:
+    explicit Leaderboard(size_t capacity, Less less = Less{})
+        : capacity_{capacity}
+        , less_{std::move(less)} {
+    }
+
+    // items - первые элементы таблицы в порядке Less, не больше capacity
+    void Reset(std::vector<T> items) {
+        std::lock_guard lock{mutex_};
+        items_ = std::move(items);
+        // Меньше capacity строк - значит, в таблице больше ничего нет
+        complete_ = items_.size() < capacity_;
+        if (items_.size() > capacity_) {
+            items_.erase(items_.begin() + capacity_, items_.end());
+        }
+    }
+
+    void Add(std::vector<T> items) {
+        std::lock_guard lock{mutex_};
+        for (auto& item : items) {
+            const auto pos = std::upper_bound(items_.begin(), items_.end(), item, less_);
+            if (pos == items_.end() && items_.size() >= capacity_) {
+                // Ниже хранимой части, в памяти теперь не вся таблица
+                complete_ = false;
+                continue;
+            }
+            items_.insert(pos, std::move(item));
+            if (items_.size() > capacity_) {
+                items_.pop_back();
+                complete_ = false;
+            }
+        }
+    }
+
+    std::optional<std::vector<T>> Find(size_t offset, size_t count) const {
+        std::shared_lock lock{mutex_};
+        return Slice(offset, count);
+    }
+
+    // Less должен уметь сравнивать Key с T
+    template <typename Key>
+    std::optional<std::vector<T>> FindAfter(const Key& key, size_t count) const {
+        std::shared_lock lock{mutex_};
+        const auto first = std::upper_bound(items_.begin(), items_.end(), key, less_);
+        return Slice(static_cast<size_t>(first - items_.begin()), count);
+    }
+
+    size_t GetCapacity() const noexcept {
+        return capacity_;
+    }
+
+private:
+    std::optional<std::vector<T>> Slice(size_t offset, size_t count) const {
+        if (offset + count > items_.size() && !complete_) {
+            return std::nullopt;
+        }
+        const size_t first = std::min(offset, items_.size());
+        const size_t last = std::min(offset + count, items_.size());
+        return std::vector<T>(items_.begin() + first, items_.begin() + last);
+    }
+
+    const size_t capacity_;
+    Less less_;
+
+    mutable std::shared_mutex mutex_;
+    std::vector<T> items_;
+    bool complete_ = true;
+};
+
+}  // namespace util
@@ -61,4 +61,20 @@ void LogServerError(const sys::error_code& ec, std::string where) {
     BOOST_LOG_TRIVIAL(info) << boost::log::add_value(data_attr, exception_info) << "error";
 }
 
+void LogSimulationError(const std::exception& ex) {
+    json::value exception_info = json::object{
+        { "exception", ex.what() },
+        { "where", "simulation" }
+    };
+    BOOST_LOG_TRIVIAL(info) << boost::log::add_value(data_attr, exception_info) << "error";
+}
+
+void LogDatabaseWriteError(const std::exception& ex) {
+    json::value exception_info = json::object{
+        { "exception", ex.what() },
+        { "where", "database write" }
+    };
+    BOOST_LOG_TRIVIAL(info) << boost::log::add_value(data_attr, exception_info) << "error";
+}
+
 }
\ No newline at end of file
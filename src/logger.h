@@ -44,6 +44,8 @@ void LogServerStart(unsigned short port, net::ip::address address);
 void LogServerStop();
 void LogServerStopEx(const std::exception& ex, int code);
 void LogServerError(const sys::error_code& ec, std::string where);
+void LogSimulationError(const std::exception& ex);
+void LogDatabaseWriteError(const std::exception& ex);
 
 template<class SomeRequestHandler>
 class LoggingRequestHandler {
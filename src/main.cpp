@@ -13,7 +13,11 @@
 #include "json_loader.h"
 #include "request_handler.h"
 #include "logger.h"
+#include "metrics.h"
 #include "postgres.h"
+#include "replay.h"
+#include "simulation_thread.h"
+#include "state_push.h"
 #include "ticker.h"
 
 using namespace std::literals;
@@ -29,7 +33,10 @@ struct CommandLineArgs {
     std::string static_dir;
     std::string state_file;
     int tick_period;
+    Ticker::CatchUpPolicy tick_catch_up = Ticker::CatchUpPolicy::SUB_STEP;
     int save_state_period;
+    std::string input_journal;
+    std::optional<uint64_t> random_seed;
     bool randomize = false;
     bool state_file_exist = false;
 };
@@ -38,14 +45,18 @@ std::optional<CommandLineArgs> ParseCommandLine(int argc, const char* argv[]) {
     po::options_description desc("Allowed options");
 
     CommandLineArgs args;
+    std::string tick_catch_up;
     desc.add_options()
         ("help,h", "produced help message")
         ("config-file,c", po::value(&args.config_file)->value_name("file"s), "set config path")
         ("www-root,w", po::value(&args.static_dir)->value_name("dir"s), "set static file root")
         ("state-file,f", po::value(&args.state_file)->value_name("file"s), "set state file")
         ("tick-period,t", po::value(&args.tick_period)->value_name("milliseconds"s), "set tick period")
+        ("tick-catch-up", po::value(&tick_catch_up)->value_name("policy"s), "late tick handling: skip, sub-step (default) or clamp")
         ("save-state-period,s", po::value(&args.save_state_period)->value_name("milliseconds"s), "set save state period")
-        ("randomize-spawn-dogs", "spawn dogs at random positions");
+        ("randomize-spawn-dogs", "spawn dogs at random positions")
+        ("input-journal", po::value(&args.input_journal)->value_name("file"s), "record joins, actions and ticks for replay")
+        ("random-seed", po::value<uint64_t>()->value_name("seed"s), "set seed of the game random generators");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -67,12 +78,26 @@ std::optional<CommandLineArgs> ParseCommandLine(int argc, const char* argv[]) {
     if(!vm.contains("tick-period")) {
         args.tick_period = -1;
     }
+    if(vm.contains("tick-catch-up")) {
+        if (tick_catch_up == "skip"s) {
+            args.tick_catch_up = Ticker::CatchUpPolicy::SKIP;
+        } else if (tick_catch_up == "sub-step"s) {
+            args.tick_catch_up = Ticker::CatchUpPolicy::SUB_STEP;
+        } else if (tick_catch_up == "clamp"s) {
+            args.tick_catch_up = Ticker::CatchUpPolicy::CLAMP;
+        } else {
+            throw std::runtime_error("Unknown tick catch-up policy"s);
+        }
+    }
     if(!vm.contains("save-state-period")) {
         args.save_state_period = -1;
     } 
     if(vm.contains("randomize-spawn-points")) {
         args.randomize = true;
     }
+    if(vm.contains("random-seed")) {
+        args.random_seed = vm["random-seed"s].as<uint64_t>();
+    }
     return args;
 }
 
@@ -103,6 +128,9 @@ int main(int argc, const char* argv[]) {
 
         // 1. Загружаем карту из файла и построить модель игры
         model::Game game = json_loader::LoadGame(args->config_file);
+        if (args->random_seed) {
+            game.SetRandomSeed(*args->random_seed);
+        }
 
         // 2. Инициализируем io_context
         const unsigned num_threads = std::thread::hardware_concurrency();
@@ -125,41 +153,58 @@ int main(int argc, const char* argv[]) {
         std::filesystem::path static_path = args->static_dir;
 
         app::Players players;
-        app::Application application(game, players, postgres_database::GetConfigFromEnv());
+        auto db_config = postgres_database::GetConfigFromEnv();
+        db_config.write_error_handler = [](const std::exception& ex) {
+            logger::LogDatabaseWriteError(ex);
+        };
+        app::Application application(game, players, std::move(db_config));
 
         if (args->state_file_exist) {
             if (args->save_state_period != -1) {
                 auto ser_list_ptr = std::make_unique<infrastructure::SerializingListener>(application, std::chrono::milliseconds(args->save_state_period));
                 ser_list_ptr->SetSerializeFile(args->state_file);
-                application.SetApplicationListener(std::move(ser_list_ptr));
+                application.AddApplicationListener(std::move(ser_list_ptr));
             }
             serialization::AppDeserialization(args->state_file, application);
         }
 
-        net::strand<net::io_context::executor_type> api_strand{net::make_strand(ioc)};
-
         if (args->randomize) {
             application.SetGenerateRandPos(true);
         }
+
+        if (!args->input_journal.empty()) {
+            application.SetInputJournal(std::make_shared<replay::JournalWriter>(args->input_journal, game.GetRandomSeed()));
+        }
         
-        http_handler::RequestHandler handler{ game, static_path, application, api_strand };
+        // Игрой владеет поток симуляции, остальные потоки передают ему команды
+        util::SimulationThread simulation;
+        simulation.SetErrorHandler([](const std::exception& ex) {
+            logger::LogSimulationError(ex);
+        });
+
+        http_handler::RequestHandler handler{ game, static_path, application, simulation };
         logger::LoggingRequestHandler log_handler(handler, endpoint);
 
+        // Клиенты, подключённые по WebSocket, получают состояние после каждого тика
+        auto push_channel = std::make_shared<http_handler::StatePushChannel>(application, simulation);
+        application.AddApplicationListener(push_channel);
+
         // 5. Если указан tick-period, создаем автоматический тикер
-        std::shared_ptr<Ticker> ticker;
         if (args->tick_period != -1) {
             auto period = std::chrono::milliseconds(args->tick_period);
-            ticker = std::make_shared<Ticker>(api_strand, period, 
+            simulation.StartTicker(period,
                 [&application](std::chrono::milliseconds delta) {
                     application.Tick(delta);
-                });
+                }, args->tick_catch_up, Ticker::RegisterMetrics(metrics::GetRegistry()));
             application.SetAutoTickEnabled(true);
-            ticker->Start();
         }
+        simulation.Start();
 
         // 6. Запустить обработчик HTTP-запросов
         http_server::ServeHttp(ioc, endpoint, [&log_handler](auto&& req, auto&& send) {
             log_handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
+        }, [push_channel](auto&& ws, auto&& req) {
+            push_channel->Connect(std::forward<decltype(ws)>(ws), std::forward<decltype(req)>(req));
         });
 
         logger::LogServerStart(port, address);
@@ -168,6 +213,7 @@ int main(int argc, const char* argv[]) {
         RunWorkers(std::max(1u, num_threads), [&ioc] {
             ioc.run();
         });
+        simulation.Stop();
 
         if (args->state_file_exist) {
             serialization::AppSerialization(args->state_file, application);
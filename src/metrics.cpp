@@ -0,0 +1,243 @@
+#include "metrics.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace metrics {
+
+    using namespace std::literals;
+
+    namespace {
+
+    // Маршруты API; остальные запросы к /api/ и к статике собираются в общие группы
+    constexpr std::string_view API_ROUTES[] = {
+        "/api/v1/maps"sv,
+        "/api/v1/game/join"sv,
+        "/api/v1/game/players"sv,
+        "/api/v1/game/state"sv,
+        "/api/v1/game/player/action"sv,
+        "/api/v1/game/tick"sv,
+        "/api/v1/game/records"sv,
+        "/metrics"sv
+    };
+    constexpr std::string_view MAP_BY_ID_PREFIX = "/api/v1/maps/"sv;
+    constexpr std::string_view MAP_BY_ID_ROUTE = "/api/v1/maps/{id}"sv;
+    constexpr std::string_view API_PREFIX = "/api/"sv;
+    constexpr std::string_view OTHER_API_ROUTE = "/api/other"sv;
+    constexpr std::string_view STATIC_ROUTE = "static"sv;
+
+    constexpr size_t MAP_BY_ID_INDEX = std::size(API_ROUTES);
+    constexpr size_t OTHER_API_INDEX = MAP_BY_ID_INDEX + 1;
+    constexpr size_t STATIC_INDEX = OTHER_API_INDEX + 1;
+
+    void WriteLabels(std::ostream& out, const Labels& labels, std::string_view le = {}) {
+        if (labels.empty() && le.empty()) {
+            return;
+        }
+        out << '{';
+        bool first = true;
+        for (const auto& [name, value] : labels) {
+            out << (first ? "" : ",") << name << "=\"" << value << '"';
+            first = false;
+        }
+        if (!le.empty()) {
+            out << (first ? "" : ",") << "le=\"" << le << '"';
+        }
+        out << '}';
+    }
+
+    std::string SecondsString(uint64_t micros) {
+        std::ostringstream out;
+        out << std::setprecision(9) << static_cast<double>(micros) / 1e6;
+        return out.str();
+    }
+
+    void WriteHistogram(std::ostream& out, const std::string& name, const Labels& labels, const Histogram& histogram) {
+        // Корзина, оканчивающаяся на 2^k - 1 мкс, закрывает степень двойки целиком,
+        // поэтому кумулятивные значения на этих границах точные
+        uint64_t cumulative = 0;
+        uint64_t next_bound = 1;
+        for (size_t index = 0; index < Histogram::BUCKET_COUNT; ++index) {
+            cumulative += histogram.GetBucketCount(index);
+            const uint64_t upper = Histogram::BucketUpperBound(index);
+            if (upper + 1 == next_bound) {
+                out << name << "_bucket";
+                WriteLabels(out, labels, SecondsString(upper));
+                out << ' ' << cumulative << '\n';
+                next_bound *= 2;
+            }
+        }
+        out << name << "_bucket";
+        WriteLabels(out, labels, "+Inf"sv);
+        out << ' ' << cumulative << '\n';
+
+        out << name << "_sum";
+        WriteLabels(out, labels);
+        out << ' ' << SecondsString(histogram.GetSum()) << '\n';
+        out << name << "_count";
+        WriteLabels(out, labels);
+        out << ' ' << cumulative << '\n';
+    }
+
+    }  // namespace
+
+    uint64_t Histogram::GetCount() const noexcept {
+        uint64_t count = 0;
+        for (const auto& bucket : buckets_) {
+            count += bucket.load(std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    uint64_t Histogram::GetSum() const noexcept {
+        return sum_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t Histogram::Percentile(double p) const noexcept {
+        const uint64_t count = GetCount();
+        if (count == 0) {
+            return 0;
+        }
+        const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * static_cast<double>(count) + 0.5));
+        uint64_t seen = 0;
+        for (size_t index = 0; index < BUCKET_COUNT; ++index) {
+            seen += GetBucketCount(index);
+            if (seen >= rank) {
+                return BucketUpperBound(index);
+            }
+        }
+        return BucketUpperBound(BUCKET_COUNT - 1);
+    }
+
+    template <typename T>
+    T& Registry::Add(std::string_view name, std::string_view help, Labels labels) {
+        std::lock_guard lock(mutex_);
+        auto it = std::find_if(families_.begin(), families_.end(), [name](const Family& family) {
+            return family.name == name;
+        });
+        if (it == families_.end()) {
+            it = families_.insert(families_.end(), Family{std::string(name), std::string(help), {}});
+        }
+
+        auto metric = std::make_unique<T>();
+        T& result = *metric;
+        it->series.push_back(Series{std::move(labels), std::move(metric)});
+        return result;
+    }
+
+    Counter& Registry::AddCounter(std::string_view name, std::string_view help, Labels labels) {
+        return Add<Counter>(name, help, std::move(labels));
+    }
+
+    Gauge& Registry::AddGauge(std::string_view name, std::string_view help, Labels labels) {
+        return Add<Gauge>(name, help, std::move(labels));
+    }
+
+    Histogram& Registry::AddHistogram(std::string_view name, std::string_view help, Labels labels) {
+        return Add<Histogram>(name, help, std::move(labels));
+    }
+
+    void Registry::WritePrometheus(std::ostream& out) const {
+        std::lock_guard lock(mutex_);
+        for (const auto& family : families_) {
+            if (family.series.empty()) {
+                continue;
+            }
+            out << "# HELP " << family.name << ' ' << family.help << '\n';
+
+            std::visit([&](const auto& metric) {
+                using T = typename std::decay_t<decltype(metric)>::element_type;
+                if constexpr (std::is_same_v<T, Counter>) {
+                    out << "# TYPE " << family.name << " counter\n";
+                } else if constexpr (std::is_same_v<T, Gauge>) {
+                    out << "# TYPE " << family.name << " gauge\n";
+                } else {
+                    out << "# TYPE " << family.name << " histogram\n";
+                }
+            }, family.series.front().metric);
+
+            for (const auto& series : family.series) {
+                std::visit([&](const auto& metric) {
+                    using T = typename std::decay_t<decltype(metric)>::element_type;
+                    if constexpr (std::is_same_v<T, Histogram>) {
+                        WriteHistogram(out, family.name, series.labels, *metric);
+                    } else {
+                        out << family.name;
+                        WriteLabels(out, series.labels);
+                        out << ' ' << metric->Get() << '\n';
+                    }
+                }, series.metric);
+            }
+        }
+    }
+
+    std::string Registry::SerializePrometheus() const {
+        std::ostringstream out;
+        WritePrometheus(out);
+        return out.str();
+    }
+
+    ServerMetrics::ServerMetrics(Registry& registry)
+        : simulation_queue_wait(registry.AddHistogram("simulation_queue_wait_seconds"sv,
+            "Time API requests spend queued for the simulation thread"sv))
+        , tick_duration(registry.AddHistogram("game_tick_duration_seconds"sv, "Game tick duration"sv))
+        , tick_sessions(registry.AddHistogram("game_tick_phase_duration_seconds"sv, "Game tick phase duration"sv,
+            {{"phase"s, "sessions"s}}))
+        , tick_retirement(registry.AddHistogram("game_tick_phase_duration_seconds"sv, {}, {{"phase"s, "retirement"s}}))
+        , tick_listeners(registry.AddHistogram("game_tick_phase_duration_seconds"sv, {}, {{"phase"s, "listeners"s}}))
+        , session_loot_generation(registry.AddHistogram("game_session_phase_duration_seconds"sv,
+            "Duration of the session update phases"sv, {{"phase"s, "loot_generation"s}}))
+        , session_movement(registry.AddHistogram("game_session_phase_duration_seconds"sv, {}, {{"phase"s, "movement"s}}))
+        , session_collection(registry.AddHistogram("game_session_phase_duration_seconds"sv, {}, {{"phase"s, "collection"s}}))
+        , session_publish(registry.AddHistogram("game_session_phase_duration_seconds"sv, {}, {{"phase"s, "publish"s}}))
+        , sessions(registry.AddGauge("game_sessions"sv, "Number of game sessions"sv))
+        , dogs(registry.AddGauge("game_dogs"sv, "Number of dogs in all sessions"sv))
+        , loots(registry.AddGauge("game_loots"sv, "Number of lost objects in all sessions"sv))
+        , db_pool_wait(registry.AddHistogram("db_pool_wait_seconds"sv, "Time spent waiting for a database connection"sv))
+        , records_cache_hits(registry.AddCounter("records_cache_requests_total"sv, "Records pages served by the in-memory leaderboard"sv,
+            {{"result"s, "hit"s}}))
+        , records_cache_misses(registry.AddCounter("records_cache_requests_total"sv, {}, {{"result"s, "miss"s}})) {
+
+        auto add_route = [&](std::string_view route) {
+            const Labels labels{{"route"s, std::string(route)}};
+            routes_.push_back({
+                registry.AddHistogram("http_request_duration_seconds"sv,
+                    "HTTP request latency including the simulation queue"sv, labels),
+                registry.AddCounter("http_request_errors_total"sv, "HTTP responses with status 4xx or 5xx"sv, labels)
+            });
+        };
+        for (auto route : API_ROUTES) {
+            add_route(route);
+        }
+        add_route(MAP_BY_ID_ROUTE);
+        add_route(OTHER_API_ROUTE);
+        add_route(STATIC_ROUTE);
+    }
+
+    ServerMetrics::RouteMetrics& ServerMetrics::GetRoute(std::string_view target) noexcept {
+        target = target.substr(0, target.find('?'));
+        for (size_t index = 0; index < std::size(API_ROUTES); ++index) {
+            if (target == API_ROUTES[index]) {
+                return routes_[index];
+            }
+        }
+        if (target.starts_with(MAP_BY_ID_PREFIX)) {
+            return routes_[MAP_BY_ID_INDEX];
+        }
+        if (target.starts_with(API_PREFIX)) {
+            return routes_[OTHER_API_INDEX];
+        }
+        return routes_[STATIC_INDEX];
+    }
+
+    Registry& GetRegistry() {
+        static Registry registry;
+        return registry;
+    }
+
+    ServerMetrics& GetServerMetrics() {
+        static ServerMetrics server_metrics{GetRegistry()};
+        return server_metrics;
+    }
+
+}  // namespace metrics
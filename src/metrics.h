@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace metrics {
+
+using Clock = std::chrono::steady_clock;
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+// Монотонно растущий счётчик
+class Counter {
+public:
+    void Add(uint64_t value = 1) noexcept {
+        value_.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t Get() const noexcept {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> value_ = 0;
+};
+
+// Текущее значение величины
+class Gauge {
+public:
+    void Set(int64_t value) noexcept {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    int64_t Get() const noexcept {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> value_ = 0;
+};
+
+/*
+ *  Гистограмма длительностей в микросекундах с логарифмически-линейными корзинами, как в HdrHistogram.
+ *  Каждая степень двойки делится на SUB_BUCKETS равных корзин, поэтому относительная
+ *  погрешность не превышает 1/SUB_BUCKETS на всём диапазоне, а памяти нужно несколько килобайт.
+ *  Запись - два атомарных сложения без блокировок, так что её можно оставлять включённой всегда.
+ *  Значения больше MaxValue() попадают в последнюю корзину.
+ */
+class Histogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 3;
+    static constexpr uint64_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    // Значения до 2^40 мкс, то есть примерно до 12 суток
+    static constexpr unsigned MAX_VALUE_BITS = 40;
+    static constexpr size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    void Record(uint64_t micros) noexcept {
+        buckets_[BucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(micros, std::memory_order_relaxed);
+    }
+
+    template <typename Rep, typename Period>
+    void Record(std::chrono::duration<Rep, Period> duration) noexcept {
+        const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        Record(static_cast<uint64_t>(std::max<decltype(micros)>(micros, 0)));
+    }
+
+    uint64_t GetCount() const noexcept;
+    uint64_t GetSum() const noexcept;
+    uint64_t GetBucketCount(size_t index) const noexcept {
+        return buckets_[index].load(std::memory_order_relaxed);
+    }
+
+    // Верхняя граница корзины, в которую попадает доля p записанных значений
+    uint64_t Percentile(double p) const noexcept;
+
+    static size_t BucketIndex(uint64_t value) noexcept {
+        if (value < SUB_BUCKETS) {
+            return static_cast<size_t>(value);
+        }
+        const unsigned width = std::bit_width(value);
+        if (width > MAX_VALUE_BITS) {
+            return BUCKET_COUNT - 1;
+        }
+        const unsigned shift = width - SUB_BUCKET_BITS - 1;
+        return (shift + 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) - SUB_BUCKETS);
+    }
+
+    // Наибольшее значение, попадающее в корзину index
+    static uint64_t BucketUpperBound(size_t index) noexcept {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        const uint64_t shift = index / SUB_BUCKETS - 1;
+        const uint64_t sub_bucket = index % SUB_BUCKETS + SUB_BUCKETS;
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+    static constexpr uint64_t MaxValue() noexcept {
+        return (uint64_t{1} << MAX_VALUE_BITS) - 1;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> sum_ = 0;
+};
+
+/*
+ *  Набор метрик, который выводится в текстовом формате Prometheus.
+ *  Регистрация берёт мьютекс и выполняется при старте, а возвращённые ссылки
+ *  действительны всё время жизни реестра и используются без блокировок.
+ *  Гистограммы выводятся в секундах с границами корзин на степенях двойки микросекунд.
+ */
+class Registry {
+public:
+    Counter& AddCounter(std::string_view name, std::string_view help, Labels labels = {});
+    Gauge& AddGauge(std::string_view name, std::string_view help, Labels labels = {});
+    Histogram& AddHistogram(std::string_view name, std::string_view help, Labels labels = {});
+
+    void WritePrometheus(std::ostream& out) const;
+    std::string SerializePrometheus() const;
+
+private:
+    using Metric = std::variant<std::unique_ptr<Counter>, std::unique_ptr<Gauge>, std::unique_ptr<Histogram>>;
+
+    struct Series {
+        Labels labels;
+        Metric metric;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        std::vector<Series> series;
+    };
+
+    template <typename T>
+    T& Add(std::string_view name, std::string_view help, Labels labels);
+
+    mutable std::mutex mutex_;
+    std::vector<Family> families_;
+};
+
+/*
+ *  Метрики сервера. Маршруты API перечислены заранее, поэтому запись
+ *  задержки запроса не ищет ничего в хеш-таблицах и не берёт блокировок.
+ */
+class ServerMetrics {
+public:
+    struct RouteMetrics {
+        Histogram& latency;
+        Counter& errors;
+
+        // Задержка от получения запроса до отправки ответа
+        void Record(Clock::time_point received, unsigned status) noexcept {
+            latency.Record(Clock::now() - received);
+            if (status >= 400) {
+                errors.Add();
+            }
+        }
+    };
+
+    explicit ServerMetrics(Registry& registry);
+
+    RouteMetrics& GetRoute(std::string_view target) noexcept;
+
+    Histogram& simulation_queue_wait;
+    Histogram& tick_duration;
+    Histogram& tick_sessions;
+    Histogram& tick_retirement;
+    Histogram& tick_listeners;
+    Histogram& session_loot_generation;
+    Histogram& session_movement;
+    Histogram& session_collection;
+    Histogram& session_publish;
+    Gauge& sessions;
+    Gauge& dogs;
+    Gauge& loots;
+    Histogram& db_pool_wait;
+    // Страницы рекордов, отданные из памяти и прочитанные из базы
+    Counter& records_cache_hits;
+    Counter& records_cache_misses;
+
+private:
+    std::vector<RouteMetrics> routes_;
+};
+
+// Реестр процесса, который отдаёт /metrics
+Registry& GetRegistry();
+ServerMetrics& GetServerMetrics();
+
+}  // namespace metrics
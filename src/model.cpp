@@ -47,25 +47,16 @@ std::string DirectionToString(Direction dir) {
     }
 
     bool Road::IsPointOnRoad(const Position& pos) const noexcept {
-        RoadCoord coord = GetRoadCoord();
+        return GetRoadCoord().Contains(pos);
+    }
 
-        if (IsHorizontal()) {        
-            if (pos.y < coord.min_y - EPSILON || pos.y > coord.max_y + EPSILON) {
-                return false;
-            }
-            
-            if (pos.x < coord.min_x - EPSILON || pos.x > coord.max_x + EPSILON) {
-                return false;
-            }
-        } 
-        else { 
-            if (pos.x < coord.min_x - EPSILON || pos.x > coord.max_x + EPSILON) {
-                return false;
-            }
+    bool Road::RoadCoord::Contains(const Position& pos) const noexcept {
+        if (pos.x < min_x - EPSILON || pos.x > max_x + EPSILON) {
+            return false;
+        }
 
-            if (pos.y < coord.min_y - EPSILON || pos.y > coord.max_y + EPSILON) {
-                return false;
-            }
+        if (pos.y < min_y - EPSILON || pos.y > max_y + EPSILON) {
+            return false;
         }
         return true;
     }
@@ -90,6 +81,53 @@ std::string DirectionToString(Direction dir) {
     }
 
 
+    RoadGraph::RoadGraph(std::vector<Point> nodes, std::vector<Edge> edges)
+        : nodes_(std::move(nodes))
+        , edges_(std::move(edges)) {
+
+        // Списки смежности хранятся подряд: рёбра узла n лежат в
+        // node_edges_[node_edges_begin_[n], node_edges_begin_[n + 1])
+        node_edges_begin_.assign(nodes_.size() + 1, 0);
+        for (const auto& edge : edges_) {
+            ++node_edges_begin_[edge.from + 1];
+            ++node_edges_begin_[edge.to + 1];
+        }
+        for (size_t i = 1; i < node_edges_begin_.size(); ++i) {
+            node_edges_begin_[i] += node_edges_begin_[i - 1];
+        }
+
+        std::vector<size_t> fill(node_edges_begin_.begin(), node_edges_begin_.end() - 1);
+        node_edges_.resize(edges_.size() * 2);
+        for (size_t i = 0; i < edges_.size(); ++i) {
+            node_edges_[fill[edges_[i].from]++] = i;
+            node_edges_[fill[edges_[i].to]++] = i;
+        }
+    }
+
+    const std::vector<Point>& RoadGraph::GetNodes() const noexcept {
+        return nodes_;
+    }
+
+    const std::vector<RoadGraph::Edge>& RoadGraph::GetEdges() const noexcept {
+        return edges_;
+    }
+
+    std::span<const size_t> RoadGraph::GetNodeEdges(size_t node) const noexcept {
+        return {node_edges_.data() + node_edges_begin_[node], node_edges_.data() + node_edges_begin_[node + 1]};
+    }
+
+    std::optional<size_t> RoadGraph::FindNode(Point point) const noexcept {
+        // Узлы упорядочены по (x, y)
+        auto it = std::lower_bound(nodes_.begin(), nodes_.end(), point, [](const Point& a, const Point& b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+        if (it != nodes_.end() && it->x == point.x && it->y == point.y) {
+            return static_cast<size_t>(it - nodes_.begin());
+        }
+        return std::nullopt;
+    }
+
+
     Building::Building(Rectangle bounds) noexcept
         : bounds_{bounds} {
     }
@@ -139,6 +177,14 @@ std::string DirectionToString(Direction dir) {
         return roads_;
     }
 
+    const Map::Roads& Map::GetRoadNetwork() const noexcept {
+        return road_network_;
+    }
+
+    const RoadGraph& Map::GetRoadGraph() const noexcept {
+        return road_graph_;
+    }
+
     const Map::Offices& Map::GetOffices() const noexcept {
         return offices_;
     }
@@ -176,23 +222,144 @@ std::string DirectionToString(Direction dir) {
         dog_speed_ = speed;
     }
 
+    void Map::NormalizeRoads() {
+        struct Span {
+            Coord line;
+            Coord begin;
+            Coord end;
+        };
+
+        std::vector<Span> horizontal;
+        std::vector<Span> vertical;
+
+        for (const auto& road : roads_) {
+            auto start = road.GetStart();
+            auto end = road.GetEnd();
+
+            if (road.IsHorizontal()) {
+                horizontal.push_back({start.y, std::min(start.x, end.x), std::max(start.x, end.x)});
+            }
+            else {
+                vertical.push_back({start.x, std::min(start.y, end.y), std::max(start.y, end.y)});
+            }
+        }
+
+        // Сливаем участки на одной линии, которые перекрываются или касаются концами
+        auto merge = [](std::vector<Span>& spans) {
+            std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) {
+                return a.line < b.line || (a.line == b.line && a.begin < b.begin);
+            });
+
+            std::vector<Span> merged;
+            for (const auto& span : spans) {
+                if (!merged.empty() && merged.back().line == span.line && span.begin <= merged.back().end) {
+                    merged.back().end = std::max(merged.back().end, span.end);
+                }
+                else {
+                    merged.push_back(span);
+                }
+            }
+            return merged;
+        };
+
+        road_network_.clear();
+        for (const auto& span : merge(horizontal)) {
+            road_network_.emplace_back(Road::HORIZONTAL, Point{span.begin, span.line}, span.end);
+        }
+        for (const auto& span : merge(vertical)) {
+            road_network_.emplace_back(Road::VERTICAL, Point{span.line, span.begin}, span.end);
+        }
+    }
+
+    void Map::BuildRoadGraph() {
+        // Точки каждой дороги, в которых нужны узлы: концы и пересечения с другими дорогами
+        std::vector<std::vector<Point>> road_points(road_network_.size());
+
+        for (size_t i = 0; i < road_network_.size(); ++i) {
+            road_points[i].push_back(road_network_[i].GetStart());
+            road_points[i].push_back(road_network_[i].GetEnd());
+        }
+
+        for (const auto& horizontal : horizontal_roads_by_y_) {
+            const Road& h_road = road_network_[horizontal.road_idx];
+            const Coord y = h_road.GetStart().y;
+            const Coord min_x = std::min(h_road.GetStart().x, h_road.GetEnd().x);
+            const Coord max_x = std::max(h_road.GetStart().x, h_road.GetEnd().x);
+
+            auto it = std::lower_bound(vertical_roads_by_x_.begin(), vertical_roads_by_x_.end(), min_x, 
+                [](const RoadIndex& road, double value) { return road.coord < value; });
+
+            for (; it != vertical_roads_by_x_.end() && it->coord <= max_x; ++it) {
+                const Road& v_road = road_network_[it->road_idx];
+                const Coord x = v_road.GetStart().x;
+
+                if (y >= std::min(v_road.GetStart().y, v_road.GetEnd().y) 
+                    && y <= std::max(v_road.GetStart().y, v_road.GetEnd().y)) {
+                    road_points[horizontal.road_idx].push_back({x, y});
+                    road_points[it->road_idx].push_back({x, y});
+                }
+            }
+        }
+
+        auto less = [](const Point& a, const Point& b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        };
+        auto equal = [](const Point& a, const Point& b) {
+            return a.x == b.x && a.y == b.y;
+        };
+
+        std::vector<Point> nodes;
+        for (auto& points : road_points) {
+            // На горизонтальной дороге это порядок по x, на вертикальной - по y
+            std::sort(points.begin(), points.end(), less);
+            points.erase(std::unique(points.begin(), points.end(), equal), points.end());
+            nodes.insert(nodes.end(), points.begin(), points.end());
+        }
+        std::sort(nodes.begin(), nodes.end(), less);
+        nodes.erase(std::unique(nodes.begin(), nodes.end(), equal), nodes.end());
+
+        auto node_id = [&nodes, &less](const Point& point) {
+            return static_cast<size_t>(std::lower_bound(nodes.begin(), nodes.end(), point, less) - nodes.begin());
+        };
+
+        std::vector<RoadGraph::Edge> edges;
+        for (size_t i = 0; i < road_points.size(); ++i) {
+            const auto& points = road_points[i];
+            for (size_t j = 1; j < points.size(); ++j) {
+                const Dimension length = std::abs(points[j].x - points[j - 1].x) + std::abs(points[j].y - points[j - 1].y);
+                edges.push_back({node_id(points[j - 1]), node_id(points[j]), i, length});
+            }
+        }
+
+        road_graph_ = RoadGraph{std::move(nodes), std::move(edges)};
+    }
+
     void Map::BuildRoadIndexes() {
-        for (size_t i = 0; i < roads_.size(); ++i) {
-            const Road& road = roads_[i];
+        NormalizeRoads();
+
+        horizontal_roads_by_y_.clear();
+        vertical_roads_by_x_.clear();
+
+        for (size_t i = 0; i < road_network_.size(); ++i) {
+            const Road& road = road_network_[i];
 
             if (road.IsHorizontal()) {
-                horizontal_roads_by_y_.push_back({i, static_cast<double>(road.GetStart().y)});
+                const Road::RoadCoord bounds = road.GetRoadCoord();
+                horizontal_roads_by_y_.push_back({i, static_cast<double>(road.GetStart().y), bounds.min_x, bounds});
             } 
             else { 
-                vertical_roads_by_x_.push_back({i, static_cast<double>(road.GetStart().x)});
+                const Road::RoadCoord bounds = road.GetRoadCoord();
+                vertical_roads_by_x_.push_back({i, static_cast<double>(road.GetStart().x), bounds.min_y, bounds});
             }
         }
         
-        std::sort(horizontal_roads_by_y_.begin(), horizontal_roads_by_y_.end(), 
-            [](const RoadIndex& a, const RoadIndex& b) { return a.coord < b.coord; });
-        
-        std::sort(vertical_roads_by_x_.begin(), vertical_roads_by_x_.end(), 
-            [](const RoadIndex& a, const RoadIndex& b) { return a.coord < b.coord; });
+        auto by_line = [](const RoadIndex& a, const RoadIndex& b) { 
+            return a.coord < b.coord || (a.coord == b.coord && a.begin < b.begin); 
+        };
+        std::sort(horizontal_roads_by_y_.begin(), horizontal_roads_by_y_.end(), by_line);
+        std::sort(vertical_roads_by_x_.begin(), vertical_roads_by_x_.end(), by_line);
+
+        BuildRoadGraph();
     }
 
     const std::vector<Map::RoadIndex>& Map::GetHorizontalRoadsByY() const noexcept { 
@@ -203,6 +370,35 @@ std::string DirectionToString(Direction dir) {
         return vertical_roads_by_x_; 
     }
 
+    namespace {
+
+    // Линии дорог лежат в целых координатах, а полоса дороги уже половины клетки, поэтому
+    // точку across может содержать только линия std::round(across). Последняя дорога этой
+    // линии, которая начинается не дальше along, - единственная, что может содержать точку
+    const Map::RoadIndex* FindRoadOnLine(const std::vector<Map::RoadIndex>& index, double across, double along, 
+                                         const Position& pos) noexcept {
+        const double line = std::round(across);
+        auto it = std::upper_bound(index.begin(), index.end(), std::pair{line, along + EPSILON}, 
+            [](const std::pair<double, double>& key, const Map::RoadIndex& road) {
+                return key.first < road.coord || (key.first == road.coord && key.second < road.begin);
+            });
+        if (it == index.begin()) {
+            return nullptr;
+        }
+        --it;
+        return it->coord == line && it->bounds.Contains(pos) ? &*it : nullptr;
+    }
+
+    }  // namespace
+
+    const Map::RoadIndex* Map::FindHorizontalRoad(const Position& pos) const noexcept {
+        return FindRoadOnLine(horizontal_roads_by_y_, pos.y, pos.x, pos);
+    }
+
+    const Map::RoadIndex* Map::FindVerticalRoad(const Position& pos) const noexcept {
+        return FindRoadOnLine(vertical_roads_by_x_, pos.x, pos.y, pos);
+    }
+
     const extra_data::ExtraData& Map::GetExtraData() const noexcept {
         return extra_data_;
     }
@@ -219,6 +415,14 @@ std::string DirectionToString(Direction dir) {
         bag_capacity_ = bag_capacity;
     }
 
+    size_t Map::GetSessionCapacity() const noexcept {
+        return session_capacity_;
+    }
+
+    void Map::SetSessionCapacity(size_t session_capacity) {
+        session_capacity_ = session_capacity;
+    }
+
     size_t Map::GetPointsByType(size_t type) const noexcept {
         return extra_data_.GetValue(type);
     }
@@ -255,51 +459,67 @@ std::string DirectionToString(Direction dir) {
 
 
     Dog::Dog(Id id, std::string name, Position position, size_t bag_capacity) 
-        : id_(id), name_(std::move(name)), position_(position), bag_capacity_(bag_capacity), bag_(bag_capacity) {}
+        : store_(std::make_shared<DogStore>()), id_(id) {
+        slot_ = store_->Add(id, std::move(name), position, bag_capacity);
+        generation_ = store_->GetGeneration();
+    }
+
+    Dog::Dog(std::shared_ptr<DogStore> store, Id id)
+        : store_(std::move(store)), id_(id) {
+        slot_ = store_->GetSlot(id_);
+        generation_ = store_->GetGeneration();
+    }
+
+    size_t Dog::GetSlot() const {
+        // Пока из хранилища никого не удаляли, слот не сдвигался и поиск по id не нужен
+        if (generation_ != store_->GetGeneration()) {
+            slot_ = store_->GetSlot(id_);
+            generation_ = store_->GetGeneration();
+        }
+        return slot_;
+    }
 
     const Dog::Id& Dog::GetId() const noexcept { 
         return id_; 
     }
 
-    const std::string& Dog::GetName() const noexcept { 
-        return name_; 
+    const std::string& Dog::GetName() const { 
+        return store_->names[GetSlot()]; 
     }
 
-    const Position Dog::GetPosition() const noexcept { 
-        return position_; 
+    const Position Dog::GetPosition() const { 
+        return store_->positions[GetSlot()]; 
     }
 
-    const Speed Dog::GetSpeed() const noexcept {
-        return speed_;
+    const Speed Dog::GetSpeed() const {
+        return store_->speeds[GetSlot()];
     }
 
-    const Direction Dog::GetDirection() const noexcept {
-        return direction_;
+    const Direction Dog::GetDirection() const {
+        return store_->directions[GetSlot()];
     }
 
     void Dog::SetDefaultSpeed(double speed) {
-        default_speed_ = speed;
+        store_->default_speeds[GetSlot()] = speed;
     }
 
     void Dog::SetSpeed(Speed speed) {
-        speed_ = speed;
+        store_->speeds[GetSlot()] = speed;
     }
 
     void Dog::SetPosition(Position position) {
-        position_ = position;
+        store_->positions[GetSlot()] = position;
     }
 
     void Dog::SetDirection(Direction direction) {
-        direction_ = direction;
+        store_->directions[GetSlot()] = direction;
     }
 
-    void Dog::Stop() noexcept {
-        speed_ = {0.0, 0.0};
+    void Dog::Stop() {
+        store_->speeds[GetSlot()] = {0.0, 0.0};
     }
 
-    void Dog::MoveOnHorRoad(Position& clamped_pos, const Position& next_pos, const Road& road) {
-        auto coord = road.GetRoadCoord();
-
+    void Dog::MoveOnHorRoad(Position& clamped_pos, const Position& next_pos, const Road::RoadCoord& coord) {
         if (clamped_pos.y != next_pos.y) {
             if (next_pos.y > coord.max_y + EPSILON) {
                 clamped_pos.y = coord.max_y;
@@ -325,9 +545,7 @@ std::string DirectionToString(Direction dir) {
         }
     }
 
-    void Dog::MoveOnVertRoad(Position& clamped_pos, const Position& next_pos, const Road& road) {
-        auto coord = road.GetRoadCoord();
-
+    void Dog::MoveOnVertRoad(Position& clamped_pos, const Position& next_pos, const Road::RoadCoord& coord) {
         if (clamped_pos.x != next_pos.x) {
             if (next_pos.x > coord.max_x + EPSILON) {
                 clamped_pos.x = coord.max_x;
@@ -354,93 +572,85 @@ std::string DirectionToString(Direction dir) {
     }
 
     Position Dog::Move(double delta_time, const Map& map) {
-        Position next_pos;
-        Position clamped_pos = position_;
-
-        next_pos.x = position_.x + speed_.x * delta_time;
-        next_pos.y = position_.y + speed_.y * delta_time;
+        const size_t slot = GetSlot();
+        return MoveAlongRoads(store_->positions[slot], store_->speeds[slot], delta_time, map);
+    }
 
-        const auto& roads = map.GetRoads();
+    Position Dog::MoveAlongRoads(Position& position, Speed& speed, double delta_time, const Map& map) {
+        Position next_pos;
+        Position clamped_pos = position;
 
-        for (const auto& road : map.GetHorizontalRoadsByY()) {
-            if (clamped_pos.x == next_pos.x && clamped_pos.y == next_pos.y) {
-                break;
-            }
+        next_pos.x = position.x + speed.x * delta_time;
+        next_pos.y = position.y + speed.y * delta_time;
 
-            auto road_to_move = roads.at(road.road_idx);
+        auto reached = [&clamped_pos, &next_pos] {
+            return clamped_pos.x == next_pos.x && clamped_pos.y == next_pos.y;
+        };
 
-            if (road_to_move.IsPointOnRoad(clamped_pos)) {
-                if (road_to_move.IsHorizontal()) {
-                    MoveOnHorRoad(clamped_pos, next_pos, road_to_move);
-                }
-                else {
-                    MoveOnVertRoad(clamped_pos, next_pos, road_to_move);
-                }
-            }
+        // Сначала точку ведёт горизонтальная дорога, на которой она стоит, затем вертикальная.
+        // Сдвиг по горизонтальной дороге не выводит точку из её полосы, поэтому другие
+        // горизонтальные дороги её уже не содержат
+        if (const Map::RoadIndex* road = map.FindHorizontalRoad(clamped_pos)) {
+            MoveOnHorRoad(clamped_pos, next_pos, road->bounds);
         }
 
-        for (const auto& road : map.GetVerticalRoadsByX()) {
-            if (clamped_pos.x == next_pos.x && clamped_pos.y == next_pos.y) {
-                break;
-            }
-
-            auto road_to_move = roads.at(road.road_idx);
-
-            if (road_to_move.IsPointOnRoad(clamped_pos)) {
-                if (road_to_move.IsHorizontal()) {
-                    MoveOnHorRoad(clamped_pos, next_pos, road_to_move);
-                }
-                else {
-                    MoveOnVertRoad(clamped_pos, next_pos, road_to_move);
-                }
+        if (!reached()) {
+            if (const Map::RoadIndex* road = map.FindVerticalRoad(clamped_pos)) {
+                MoveOnVertRoad(clamped_pos, next_pos, road->bounds);
             }
         }
 
         if (clamped_pos.x != next_pos.x || clamped_pos.y != next_pos.y) {
-            Stop();
+            speed = {0.0, 0.0};
         }
 
-        position_.x = clamped_pos.x;
-        position_.y = clamped_pos.y;
+        position.x = clamped_pos.x;
+        position.y = clamped_pos.y;
 
         return clamped_pos;
     }
 
     bool Dog::AddItemToBag(Loot::Id id, size_t type) {
-        return bag_.AddItem(id, type);
+        return store_->bags[GetSlot()].AddItem(id, type);
     }
 
     void Dog::ClearBag() {
-        bag_.Clear();
+        store_->bags[GetSlot()].Clear();
     }
 
     const std::vector<LootItem>& Dog::GetItemsFromBag() const {
-        return bag_.GetItems();
+        return store_->bags[GetSlot()].GetItems();
     }
 
     void Dog::IncreaseScore(size_t points) {
-        score_ += points;
+        store_->scores[GetSlot()] += points;
     }
 
-    const size_t Dog::GetScore() const noexcept {
-        return score_;
+    const size_t Dog::GetScore() const {
+        return store_->scores[GetSlot()];
     }
 
-    size_t Dog::GetBagCapacity() const noexcept {
-        return bag_capacity_;
+    size_t Dog::GetBagCapacity() const {
+        return store_->bags[GetSlot()].GetCapacity();
     }
 
     bool Dog::IsLeave(std::chrono::milliseconds time, std::chrono::milliseconds max_retired) {
-        in_game_ += time;
+        const size_t slot = GetSlot();
+        return UpdateActivity(store_->speeds[slot], time, max_retired, store_->in_game_times[slot], store_->retired_times[slot]);
+    }
+
+    bool Dog::UpdateActivity(const Speed& speed, std::chrono::milliseconds time, std::chrono::milliseconds max_retired,
+        std::chrono::milliseconds& in_game, std::chrono::milliseconds& retired) {
+        in_game += time;
 
-        if (speed_.x == 0.0 && speed_.y == 0.0) {
-            retired_ += time;
+        if (speed.x == 0.0 && speed.y == 0.0) {
+            retired += time;
         }
         else {
-            retired_ = 0ms;
+            retired = 0ms;
         }
 
-        if (retired_ >= max_retired) {
+        if (retired >= max_retired) {
             return false;
         }
 
@@ -448,7 +658,99 @@ std::string DirectionToString(Direction dir) {
     }
 
     int Dog::GetLeaveTime() const {
-        return in_game_.count();
+        return store_->in_game_times[GetSlot()].count();
+    }
+
+
+    size_t DogStore::Add(Dog::Id id, std::string name, Position position, size_t bag_capacity) {
+        if (slots_.contains(id)) {
+            throw std::invalid_argument("Duplicate dog id");
+        }
+
+        const size_t slot = ids.size();
+        ids.push_back(id);
+        positions.push_back(position);
+        speeds.push_back({0.0, 0.0});
+        directions.push_back(Direction::NORTH);
+        default_speeds.push_back(1.0);
+        retired_times.push_back(0ms);
+        in_game_times.push_back(0ms);
+        scores.push_back(0);
+        names.push_back(std::move(name));
+        bags.emplace_back(bag_capacity);
+        slots_.emplace(id, slot);
+        return slot;
+    }
+
+    size_t DogStore::Add(const DogStore& other, size_t other_slot) {
+        const size_t slot = Add(other.ids[other_slot], other.names[other_slot], other.positions[other_slot], 
+            other.bags[other_slot].GetCapacity());
+        speeds[slot] = other.speeds[other_slot];
+        directions[slot] = other.directions[other_slot];
+        default_speeds[slot] = other.default_speeds[other_slot];
+        retired_times[slot] = other.retired_times[other_slot];
+        in_game_times[slot] = other.in_game_times[other_slot];
+        scores[slot] = other.scores[other_slot];
+        bags[slot] = other.bags[other_slot];
+        return slot;
+    }
+
+    void DogStore::Remove(Dog::Id id) {
+        auto it = slots_.find(id);
+        if (it == slots_.end()) {
+            return;
+        }
+
+        // Переносим последнюю запись на место удаляемой, чтобы массивы оставались плотными
+        const size_t slot = it->second;
+        const size_t last = ids.size() - 1;
+        slots_.erase(it);
+        ++generation_;
+
+        if (slot != last) {
+            ids[slot] = ids[last];
+            positions[slot] = positions[last];
+            speeds[slot] = speeds[last];
+            directions[slot] = directions[last];
+            default_speeds[slot] = default_speeds[last];
+            retired_times[slot] = retired_times[last];
+            in_game_times[slot] = in_game_times[last];
+            scores[slot] = scores[last];
+            names[slot] = std::move(names[last]);
+            bags[slot] = std::move(bags[last]);
+            slots_[ids[slot]] = slot;
+        }
+
+        ids.pop_back();
+        positions.pop_back();
+        speeds.pop_back();
+        directions.pop_back();
+        default_speeds.pop_back();
+        retired_times.pop_back();
+        in_game_times.pop_back();
+        scores.pop_back();
+        names.pop_back();
+        bags.pop_back();
+    }
+
+    size_t DogStore::GetSlot(Dog::Id id) const {
+        auto it = slots_.find(id);
+        if (it == slots_.end()) {
+            throw std::out_of_range("Dog " + std::to_string(*id) + " is not in the store");
+        }
+        return it->second;
+    }
+
+    bool DogStore::Contains(Dog::Id id) const noexcept {
+        return slots_.contains(id);
+    }
+
+    size_t DogStore::Size() const noexcept {
+        return ids.size();
+    }
+
+    uint64_t DogStore::GetGeneration() const noexcept {
+        return generation_;
     }
 
 
@@ -474,13 +776,14 @@ std::string DirectionToString(Direction dir) {
             : loots_(loots), offices_(offices), movements_(movements) {
 
             // Добавляем весь лут
-            for (const auto& [id, loot] : loots_) {
-                auto pos = loot->GetPosition();
+            const auto& loot_values = loots_.GetValues();
+            for (size_t i = 0; i < loot_values.size(); ++i) {
+                auto pos = loot_values[i].GetPosition();
                 objects_.push_back({
                     Type::LOOT,
                     geom::Point2D{pos.x, pos.y},
                     LOOT_WIDTH,
-                    id,
+                    loots_.GetHandle(i),
                     Office::Id{""}
                 });
             }
@@ -492,10 +795,19 @@ std::string DirectionToString(Direction dir) {
                     Type::OFFICE,
                     geom::Point2D{static_cast<double>(pos.x), static_cast<double>(pos.y)},
                     OFFICE_WIDTH,
-                    Loot::Id{0},
+                    Loots::Handle{},
                     office.GetId()
                 });
             }
+
+            objects_x_.reserve(objects_.size());
+            objects_y_.reserve(objects_.size());
+            objects_width_.reserve(objects_.size());
+            for (const auto& obj : objects_) {
+                objects_x_.push_back(obj.position.x);
+                objects_y_.push_back(obj.position.y);
+                objects_width_.push_back(obj.width);
+            }
     }
 
     size_t ItemGathererProviderImpl::ItemsCount() const {
@@ -524,6 +836,10 @@ std::string DirectionToString(Direction dir) {
         };
     }
 
+    std::optional<collision_detector::ItemArrays> ItemGathererProviderImpl::GetItemArrays() const {
+        return collision_detector::ItemArrays{objects_x_.data(), objects_y_.data(), objects_width_.data()};
+    }
+
     const ItemGathererProviderImpl::ObjectInfo& ItemGathererProviderImpl::GetObjectInfo(size_t idx) const {
         return objects_.at(idx);
     }
@@ -531,12 +847,13 @@ std::string DirectionToString(Direction dir) {
 
     ItemCollector::ItemCollector(const Map& map) : map_(map) {}
 
-    std::vector<Loot::Id> ItemCollector::CollectItems(GameSession& session ,std::vector<ItemGathererProviderImpl::Movement> movements) {
+    const std::vector<ItemGathererProviderImpl::Loots::Handle>& ItemCollector::CollectItems(GameSession& session, const std::vector<ItemGathererProviderImpl::Movement>& movements) {
         all_events_.clear();
         collect_items_.clear();
 
         const auto& loots = session.GetLoot();
         const auto& offices = map_.GetOffices();
+        consumed_loot_.assign(loots.SlotCount(), false);
         
         if (movements.empty()) {
             return collect_items_;
@@ -545,7 +862,7 @@ std::string DirectionToString(Direction dir) {
         ItemGathererProviderImpl provider(movements, loots, offices);
 
         // 1. Собираем ВСЕ события сбора и возврата
-        ProcessGatherEvents(session, movements, provider);
+        ProcessGatherEvents(movements, provider);
         
         // 2. Обрабатываем события в хронологическом порядке
         ProcessSequentialEvents(session);
@@ -553,21 +870,18 @@ std::string DirectionToString(Direction dir) {
         return collect_items_;
     }
 
-    void ItemCollector::ProcessGatherEvents(GameSession& session, const std::vector<ItemGathererProviderImpl::Movement>& movements, const ItemGathererProviderImpl& provider) {
-        auto loots = session.GetLoot();
-
+    void ItemCollector::ProcessGatherEvents(const std::vector<ItemGathererProviderImpl::Movement>& movements, const ItemGathererProviderImpl& provider) {
         auto gather_events = collision_detector::FindGatherEvents(provider);
 
         for (const auto& event : gather_events) {
             const auto& object_info = provider.GetObjectInfo(event.item_id);
             const auto& movement = movements.at(event.gatherer_id);
-            auto& dog = movement.dog;
 
             if (object_info.type == ItemGathererProviderImpl::Type::LOOT) {
                 all_events_.push_back({
                     EventType::COLLECT,
-                    dog->GetId(),
-                    object_info.loot_id,
+                    movement.dog_slot,
+                    object_info.loot,
                     Office::Id{""},
                     event.time
                 });
@@ -575,8 +889,8 @@ std::string DirectionToString(Direction dir) {
             else if (object_info.type == ItemGathererProviderImpl::Type::OFFICE) {
                 all_events_.push_back({
                     EventType::RETURN,
-                    dog->GetId(),
-                    Loot::Id{0},
+                    movement.dog_slot,
+                    ItemGathererProviderImpl::Loots::Handle{},
                     object_info.office_id,
                     event.time
                 });
@@ -587,32 +901,31 @@ std::string DirectionToString(Direction dir) {
     void ItemCollector::ProcessSequentialEvents(GameSession& session) {
         std::sort(all_events_.begin(), all_events_.end());
 
-        auto loots = session.GetLoot();
+        const auto& loots = session.GetLoot();
+        auto& dogs = session.GetDogStore();
 
         for (const auto& event : all_events_) {
-            auto dog_it = session.GetDogs().find(event.dog_id);
-            auto& dog = dog_it->second;
+            auto& bag = dogs.bags[event.dog_slot];
 
             if (event.type == EventType::COLLECT) {         
                 // Проверяем, что предмет еще существует (не собран ранее)
-                if (!loots.count(event.loot_id)) {
+                const Loot* loot = loots.Find(event.loot);
+                if (!loot || consumed_loot_[event.loot.index]) {
                     continue;
                 }
-                
-                const auto& loot = loots.at(event.loot_id);
 
-                if (dog->AddItemToBag(event.loot_id, loot->GetType())) {
-                    loots.erase(event.loot_id);
-                    collect_items_.push_back(event.loot_id);
+                if (bag.AddItem(loot->GetId(), loot->GetType())) {
+                    consumed_loot_[event.loot.index] = true;
+                    collect_items_.push_back(event.loot);
                 }
                 
             } else if (event.type == EventType::RETURN) {
-                if (!dog->GetItemsFromBag().empty()) {
-                    for (const auto& item : dog->GetItemsFromBag()) {
-                        dog->IncreaseScore(session.GetMap().GetPointsByType(item.type));
+                if (!bag.GetItems().empty()) {
+                    for (const auto& item : bag.GetItems()) {
+                        dogs.scores[event.dog_slot] += session.GetMap().GetPointsByType(item.type);
                     }
 
-                    dog->ClearBag();
+                    bag.Clear();
                 }
             }
 
@@ -624,15 +937,27 @@ std::string DirectionToString(Direction dir) {
         id_(std::move(id)), 
         map_(map), 
         loot_generator_(std::chrono::milliseconds(static_cast<int64_t>(config.period)), 
-        config.probability), item_collector_(map),
+        config.probability), random_(std::hash<std::string>{}(*id_)), item_collector_(map),
         retirement_time_(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>(retirement_time))) {}
 
+    const GameSession::Id& GameSession::GetId() const noexcept {
+        return id_;
+    }
+
     const Map& GameSession::GetMap() const noexcept {
         return map_;
     }
 
     const GameSession::Dogs& GameSession::GetDogs() const noexcept {
-        return dogs_;;
+        return dogs_;
+    }
+
+    DogStore& GameSession::GetDogStore() noexcept {
+        return *dog_store_;
+    }
+
+    const DogStore& GameSession::GetDogStore() const noexcept {
+        return *dog_store_;
     }
 
     GameSession::DogPtr GameSession::AddDog(std::string name, bool random_spavn) {
@@ -643,56 +968,245 @@ std::string DirectionToString(Direction dir) {
             pos = GenerateRandomPosition();
         }
 
-        DogPtr dog = std::make_shared<Dog>(dog_id, std::move(name), pos, map_.GetBagCapacity());
+        dog_store_->Add(dog_id, std::move(name), pos, map_.GetBagCapacity());
+        DogPtr dog = std::make_shared<Dog>(dog_store_, dog_id);
         dogs_.emplace(dog_id, dog);
         return dog;
     }
 
+    GameSession::DogPtr GameSession::AttachDog(const Dog& dog) {
+        dog_store_->Add(*dog.store_, dog.GetSlot());
+        DogPtr dog_ptr = std::make_shared<Dog>(dog_store_, dog.GetId());
+        dogs_.emplace(dog.GetId(), dog_ptr);
+        return dog_ptr;
+    }
+
     std::vector<GameSession::DogPtr> GameSession::UpdateState(std::chrono::milliseconds time) {
+        auto inactive_dogs = Simulate(time);
+        PublishState();
+        return inactive_dogs;
+    }
+
+    std::vector<GameSession::DogPtr> GameSession::Simulate(std::chrono::milliseconds time) {
+        using Clock = std::chrono::steady_clock;
         std::vector<DogPtr> inactive_dogs;
+        ++tick_;
 
+        auto phase_start = Clock::now();
         GenerateLoot(time);
+        auto phase_end = Clock::now();
+        tick_timings_.loot_generation = phase_end - phase_start;
+
+        phase_start = phase_end;
         const double delta_time = static_cast<double>(time.count()) / 1000.0;
         std::vector<ItemGathererProviderImpl::Movement> dog_moves;
-        
-        for (const auto& [id, dog_ptr] : dogs_) {
-            
-            if (!dog_ptr->IsLeave(time, retirement_time_)) {
-                inactive_dogs.push_back(dog_ptr);
-            }
+        dog_moves.reserve(dog_store_->Size());
 
-            Position start = dog_ptr->GetPosition();
-            Position stop = dog_ptr->Move(delta_time, map_);
+        auto& dogs = *dog_store_;
+        for (size_t slot = 0; slot < dogs.Size(); ++slot) {
+            if (!Dog::UpdateActivity(dogs.speeds[slot], time, retirement_time_, dogs.in_game_times[slot], dogs.retired_times[slot])) {
+                inactive_dogs.push_back(dogs_.at(dogs.ids[slot]));
+            }
 
-            size_t bag_capacity = map_.GetBagCapacity();
-            dog_moves.emplace_back(ItemGathererProviderImpl::Movement{start, stop, dog_ptr});
+            Position start = dogs.positions[slot];
+            Position stop = Dog::MoveAlongRoads(dogs.positions[slot], dogs.speeds[slot], delta_time, map_);
+            dog_moves.push_back({start, stop, slot});
         }
+        phase_end = Clock::now();
+        tick_timings_.movement = phase_end - phase_start;
 
-        auto collect_items = item_collector_.CollectItems(*this, dog_moves);
+        phase_start = phase_end;
+        const auto& collect_items = item_collector_.CollectItems(*this, dog_moves);
 
-        for (const auto& item_id : collect_items) {
-            loots_.erase(item_id);
+        for (const auto& loot : collect_items) {
+            loots_.Remove(loot);
         }
-
+        phase_end = Clock::now();
+        tick_timings_.collection = phase_end - phase_start;
         return inactive_dogs;
     }
 
-    GameSession::GameStateData GameSession::GetGameState() const noexcept {
-        return {loots_, dogs_};
+    const GameSession::TickTimings& GameSession::GetLastTickTimings() const noexcept {
+        return tick_timings_;
+    }
+
+    GameSession::GameStatePtr GameSession::GetGameState() const noexcept {
+        return state_.load(std::memory_order_acquire);
+    }
+
+    void GameSession::PublishState() {
+        const auto publish_start = std::chrono::steady_clock::now();
+        auto state = std::make_shared<GameStateData>();
+        state->tick = tick_;
+        state->session_id = id_;
+        state->version = ++version_;
+
+        const auto& dogs = *dog_store_;
+        state->dogs.reserve(dogs.Size());
+        for (size_t slot = 0; slot < dogs.Size(); ++slot) {
+            state->dogs.push_back({dogs.ids[slot], dogs.names[slot], dogs.positions[slot], dogs.speeds[slot],
+                                   dogs.directions[slot], dogs.bags[slot].GetItems(), dogs.scores[slot]});
+        }
+
+        state->loots.reserve(loots_.Size());
+        for (const auto& loot : loots_) {
+            state->loots.push_back({loot.GetId(), loot.GetType(), loot.GetPosition()});
+        }
+
+        // Упорядоченные снимки сравниваются слиянием
+        std::sort(state->dogs.begin(), state->dogs.end(), [](const DogState& lhs, const DogState& rhs) {
+            return lhs.id < rhs.id;
+        });
+        std::sort(state->loots.begin(), state->loots.end(), [](const LootState& lhs, const LootState& rhs) {
+            return lhs.id < rhs.id;
+        });
+
+        // Изменения записываются, только если предыдущий снимок непосредственно предшествует
+        // этому. После восстановления предыдущего снимка в памяти нет, и клиенты со старым
+        // номером получат всё состояние
+        const GameStatePtr previous = GetGameState();
+        std::optional<StateChanges> changes;
+        if (previous->version + 1 == state->version) {
+            changes = Diff(*previous, *state);
+        }
+
+        GameStatePtr published = std::move(state);
+        {
+            std::lock_guard lock(journal_mutex_);
+            if (changes) {
+                journal_.push_back(std::move(*changes));
+                if (journal_.size() > STATE_JOURNAL_SIZE) {
+                    journal_.pop_front();
+                }
+            }
+            else {
+                journal_.clear();
+            }
+        }
+        state_.store(std::move(published), std::memory_order_release);
+        tick_timings_.publish = std::chrono::steady_clock::now() - publish_start;
+    }
+
+    GameSession::StateChanges GameSession::Diff(const GameStateData& from, const GameStateData& to) {
+        // Общий проход по двум упорядоченным спискам: новые и изменённые элементы
+        // попадают в out, исчезнувшие - в removed
+        auto diff = [](const auto& from, const auto& to, auto& out, auto& removed, auto equal) {
+            auto from_it = from.begin();
+            auto to_it = to.begin();
+            while (from_it != from.end() || to_it != to.end()) {
+                if (to_it == to.end() || (from_it != from.end() && from_it->id < to_it->id)) {
+                    removed.push_back(from_it->id);
+                    ++from_it;
+                }
+                else if (from_it == from.end() || to_it->id < from_it->id) {
+                    out.push_back(*to_it);
+                    ++to_it;
+                }
+                else {
+                    if (!equal(*from_it, *to_it)) {
+                        out.push_back(*to_it);
+                    }
+                    ++from_it;
+                    ++to_it;
+                }
+            }
+        };
+
+        StateChanges changes;
+        changes.version = to.version;
+        diff(from.dogs, to.dogs, changes.dogs, changes.removed_dogs, [](const DogState& lhs, const DogState& rhs) {
+            return lhs.position.x == rhs.position.x && lhs.position.y == rhs.position.y
+                && lhs.speed.x == rhs.speed.x && lhs.speed.y == rhs.speed.y && lhs.direction == rhs.direction
+                && lhs.score == rhs.score && lhs.bag.size() == rhs.bag.size()
+                && std::equal(lhs.bag.begin(), lhs.bag.end(), rhs.bag.begin(), [](const LootItem& l, const LootItem& r) {
+                       return l.id == r.id && l.type == r.type;
+                   });
+        });
+        diff(from.loots, to.loots, changes.loots, changes.removed_loots, [](const LootState& lhs, const LootState& rhs) {
+            return lhs.type == rhs.type && lhs.position.x == rhs.position.x && lhs.position.y == rhs.position.y;
+        });
+        return changes;
+    }
+
+    GameSession::GameStateDelta GameSession::GetGameStateDelta(uint64_t since) const {
+        const GameStatePtr current = GetGameState();
+
+        GameStateDelta delta;
+        delta.session_id = current->session_id;
+        delta.since = since;
+        delta.version = current->version;
+        delta.tick = current->tick;
+
+        if (since == current->version) {
+            return delta;
+        }
+
+        // Склеиваем изменения публикаций since + 1 ... current->version. Журнал дописывается
+        // раньше, чем публикуется снимок, поэтому более новые записи отбрасываем
+        bool covered = false;
+        {
+            std::lock_guard lock(journal_mutex_);
+            if (since < current->version && !journal_.empty() && journal_.front().version <= since + 1) {
+                covered = true;
+                for (const auto& changes : journal_) {
+                    if (changes.version <= since || changes.version > current->version) {
+                        continue;
+                    }
+                    delta.dogs.insert(delta.dogs.end(), changes.dogs.begin(), changes.dogs.end());
+                    delta.loots.insert(delta.loots.end(), changes.loots.begin(), changes.loots.end());
+                    delta.removed_dogs.insert(delta.removed_dogs.end(), changes.removed_dogs.begin(), changes.removed_dogs.end());
+                    delta.removed_loots.insert(delta.removed_loots.end(), changes.removed_loots.begin(), changes.removed_loots.end());
+                }
+            }
+        }
+
+        if (!covered) {
+            delta.full = true;
+            delta.dogs = current->dogs;
+            delta.loots = current->loots;
+            return delta;
+        }
+
+        // От каждого элемента остаётся последнее изменение, а удалённые не изменяются.
+        // Идентификаторы не переиспользуются, поэтому удалённый элемент не может вернуться
+        auto squash = [](auto& items, auto& removed) {
+            std::sort(removed.begin(), removed.end());
+            removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+
+            std::stable_sort(items.begin(), items.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.id < rhs.id;
+            });
+            auto out = items.begin();
+            for (auto it = items.begin(); it != items.end(); ++it) {
+                const auto next = std::next(it);
+                if (next != items.end() && next->id == it->id) {
+                    continue;
+                }
+                if (std::binary_search(removed.begin(), removed.end(), it->id)) {
+                    continue;
+                }
+                if (out != it) {
+                    *out = std::move(*it);
+                }
+                ++out;
+            }
+            items.erase(out, items.end());
+        };
+        squash(delta.dogs, delta.removed_dogs);
+        squash(delta.loots, delta.removed_loots);
+
+        return delta;
     }
 
     Position GameSession::GenerateRandomPosition() {
-        const auto& roads = map_.GetRoads();
+        const auto& roads = map_.GetRoadNetwork();
 
         if (roads.empty()) {
             return {0.0, 0.0};
         }
 
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-
         std::uniform_int_distribution<size_t> road_index(0, roads.size() - 1);
-        const Road& random_road = roads.at(road_index(gen));
+        const Road& random_road = roads.at(road_index(random_));
 
         auto start_road = random_road.GetStart();
         auto end_road = random_road.GetEnd();
@@ -706,49 +1220,50 @@ std::string DirectionToString(Direction dir) {
         if (random_road.IsHorizontal()) {
             std::uniform_real_distribution<double> coord_x(coord.min_x, coord.max_x);
             std::uniform_real_distribution<double> coord_y(coord.min_y, coord.max_y);
-            random_pos = {coord_x(gen), coord_y(gen)};
+            random_pos = {coord_x(random_), coord_y(random_)};
         }
         else {
             std::uniform_real_distribution<double> coord_x(coord.min_x, coord.max_x);
             std::uniform_real_distribution<double> coord_y(coord.min_y, coord.max_y);
-            random_pos = {coord_x(gen), coord_y(gen)};
+            random_pos = {coord_x(random_), coord_y(random_)};
         }
 
         return random_pos;
     }
 
     int GameSession::GenerateRandomNumber(int num) {
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        
         std::uniform_int_distribution<int> dist(0, num);
-        return dist(gen);
+        return dist(random_);
     }
 
     void GameSession::GenerateLoot(std::chrono::milliseconds time_interval) {
-        auto count = loot_generator_.Generate(time_interval, loots_.size(), dogs_.size());
+        auto count = loot_generator_.Generate(time_interval, loots_.Size(), dogs_.size());
 
         for (auto i(0); i < count; ++i) {
             int type = GenerateRandomNumber(map_.GetCountTypes() - 1);
             Position pos = GenerateRandomPosition();
             Loot::Id id{next_loot_id_++};
-            LootPtr loot = std::make_shared<Loot>(pos, id, static_cast<size_t>(type));
-            loots_.emplace(id, loot);
+            loots_.Insert(Loot{pos, id, static_cast<size_t>(type)});
         }
     }
 
-    void GameSession::AddLoot(GameSession::LootPtr loot) {
-        loots_.emplace(loot->GetId(), std::move(loot));
+    GameSession::LootHandle GameSession::AddLoot(Loot loot) {
+        return loots_.Insert(std::move(loot));
     }
 
-    GameSession::Loots GameSession::GetLoot() const noexcept {
+    const GameSession::Loots& GameSession::GetLoot() const noexcept {
         return loots_;
     }
 
     void GameSession::DeletePlayer(DogPtr dog) {
+        dog_store_->Remove(dog->GetId());
         dogs_.erase(dog->GetId());
     }
 
+    void GameSession::SetRandomSeed(uint64_t seed) noexcept {
+        random_.Seed(seed);
+    }
+
 
     const Game::Maps& Game::GetMaps() const noexcept {
         return maps_;
@@ -785,21 +1300,55 @@ std::string DirectionToString(Direction dir) {
         return default_speed_;
     }
 
-    Game::SessionPtr Game::FindOrAddGameSession(const Map::Id& map_id) {
-        auto it = sessions_.find(map_id);
-        if (it != sessions_.end()) {
+    Game::SessionPtr Game::FindGameSession(const GameSession::Id& id) const noexcept {
+        if (auto it = sessions_.find(id); it != sessions_.end()) {
             return it->second;
         }
+        return nullptr;
+    }
+
+    Game::SessionPtr Game::FindOrAddGameSession(const Map::Id& map_id) {
+        const model::Map* map = FindMap(map_id);
+        if (!map) {
+            return nullptr;
+        }
 
-        if (const model::Map* map = FindMap(map_id)) {
-            // ID сессии берется из ID карты
-            GameSession::Id session_id{*map_id}; 
-            SessionPtr session = std::make_shared<GameSession>(session_id, *map, loot_gen_config_, retirement_time_);
-            sessions_.emplace(map_id, session);
-            return session;
+        const size_t capacity = map->GetSessionCapacity();
+        auto& instances = map_sessions_[map_id];
+
+        SessionPtr least_loaded;
+        for (const auto& session : instances) {
+            if (!least_loaded || session->GetDogs().size() < least_loaded->GetDogs().size()) {
+                least_loaded = session;
+            }
+        }
+        if (least_loaded && (capacity == 0 || least_loaded->GetDogs().size() < capacity)) {
+            return least_loaded;
         }
 
-        return nullptr;
+        // ID экземпляра - ID карты и его номер на карте
+        size_t instance = instances.size();
+        GameSession::Id session_id{*map_id + "#"s + std::to_string(instance)};
+        while (sessions_.contains(session_id)) {
+            session_id = GameSession::Id{*map_id + "#"s + std::to_string(++instance)};
+        }
+
+        SessionPtr session = std::make_shared<GameSession>(session_id, *map, loot_gen_config_, retirement_time_);
+        session->SetRandomSeed(GetSessionSeed(session_id));
+        AddGameSession(session);
+        return session;
+    }
+
+    uint64_t Game::GetSessionSeed(const GameSession::Id& session_id) const noexcept {
+        uint64_t seed = random_seed_ ^ std::hash<std::string>{}(*session_id);
+        return util::Xoshiro256::SplitMix64(seed);
+    }
+
+    void Game::AddGameSession(SessionPtr session) {
+        if (auto [it, inserted] = sessions_.emplace(session->GetId(), session); !inserted) {
+            throw std::invalid_argument("Session with id "s + *session->GetId() + " already exists"s);
+        }
+        map_sessions_[session->GetMap().GetId()].push_back(std::move(session));
     }
 
     const Game::Sessions& Game::GetSessions() const noexcept {
@@ -818,6 +1367,14 @@ std::string DirectionToString(Direction dir) {
         return def_bag_capacity_;
     }
 
+    void Game::SetDefSessionCapacity(size_t def_session_capacity) {
+        def_session_capacity_ = def_session_capacity;
+    }
+
+    size_t Game::GetDefSessionCapacity() const noexcept {
+        return def_session_capacity_;
+    }
+
     void Game::SetRetirementTime(double time) {
         retirement_time_ = time;
     }
@@ -826,4 +1383,12 @@ std::string DirectionToString(Direction dir) {
         return retirement_time_;
     }
 
+    void Game::SetRandomSeed(uint64_t seed) noexcept {
+        random_seed_ = seed;
+    }
+
+    uint64_t Game::GetRandomSeed() const noexcept {
+        return random_seed_;
+    }
+
 }  // namespace model
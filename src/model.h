@@ -1,7 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -9,7 +14,10 @@
 
 #include "collision_detector.h"
 #include "extra_data.h"
+#include "flat_hash_map.h"
 #include "loot_generator.h"
+#include "prng.h"
+#include "slot_map.h"
 #include "tagged.h"
 
 
@@ -47,6 +55,7 @@ namespace map_fields {
     constexpr const char* SPEED = "dogSpeed";
     constexpr const char* LOOT_TYPES = "lootTypes";
     constexpr const char* BAG_CAPACITY = "bagCapacity";
+    constexpr const char* SESSION_CAPACITY = "sessionCapacity";
 }
 
 namespace root_fields {
@@ -55,6 +64,7 @@ namespace root_fields {
     constexpr const char* LOOT_GENERATOR = "lootGeneratorConfig";
     constexpr const char* DEFAULT_BAG_CAPACITY = "defaultBagCapacity";
     constexpr const char* DOG_RETIREMENT_TIME = "dogRetirementTime";
+    constexpr const char* DEFAULT_SESSION_CAPACITY = "defaultSessionCapacity";
 }
 
 namespace loot_gen_fields {
@@ -156,14 +166,16 @@ class Road {
         explicit VerticalTag() = default;
     };
 
+public:
     struct RoadCoord {
         double min_x;
         double max_x;        
         double min_y;
         double max_y;
+
+        bool Contains(const Position& pos) const noexcept;
     };
 
-public:
     constexpr static HorizontalTag HORIZONTAL{};
     constexpr static VerticalTag VERTICAL{};
 
@@ -183,6 +195,33 @@ private:
 };
 
 
+// Граф перекрёстков дорожной сети: узлы - концы дорог и их пересечения,
+// рёбра - участки дорог между соседними узлами
+class RoadGraph {
+public:
+    struct Edge {
+        size_t from;
+        size_t to;
+        size_t road_idx;
+        Dimension length;
+    };
+
+    RoadGraph() = default;
+    RoadGraph(std::vector<Point> nodes, std::vector<Edge> edges);
+
+    const std::vector<Point>& GetNodes() const noexcept;
+    const std::vector<Edge>& GetEdges() const noexcept;
+    std::span<const size_t> GetNodeEdges(size_t node) const noexcept;
+    std::optional<size_t> FindNode(Point point) const noexcept;
+
+private:
+    std::vector<Point> nodes_;
+    std::vector<Edge> edges_;
+    std::vector<size_t> node_edges_begin_;
+    std::vector<size_t> node_edges_;
+};
+
+
 class Building {
 public:
     explicit Building(Rectangle bounds) noexcept;
@@ -215,9 +254,14 @@ public:
     using Buildings = std::vector<Building>;
     using Offices = std::vector<Office>;
 
+    // Дорога в индексе, отсортированном по линии дороги (y для горизонтальных, x для вертикальных),
+    // а на одной линии - по началу дороги вдоль неё. Границы дороги посчитаны заранее,
+    // чтобы не пересчитывать их на каждом тике
     struct RoadIndex {
         size_t road_idx;
         double coord;
+        double begin;
+        Road::RoadCoord bounds;
     };
 
     Map(Id id, std::string name, const extra_data::ExtraData& parse_extra_data) noexcept;
@@ -226,20 +270,32 @@ public:
     const std::string& GetName() const noexcept;
     const Buildings& GetBuildings() const noexcept;
     const Roads& GetRoads() const noexcept;
+    // Дорожная сеть без перекрывающихся и соприкасающихся коллинеарных участков
+    const Roads& GetRoadNetwork() const noexcept;
+    const RoadGraph& GetRoadGraph() const noexcept;
     const Offices& GetOffices() const noexcept;
     double GetDogSpeed() const noexcept;
     size_t GetBagCapacity() const noexcept;
+    // Сколько игроков помещается в один экземпляр сессии на карте; 0 - без ограничения
+    size_t GetSessionCapacity() const noexcept;
     size_t GetPointsByType(size_t type) const noexcept;
 
     const std::vector<RoadIndex>& GetHorizontalRoadsByY() const noexcept;
     const std::vector<RoadIndex>& GetVerticalRoadsByX() const noexcept;
 
+    // Дорога, которая содержит точку, или nullptr. Коллинеарные участки дорожной сети
+    // не соприкасаются, поэтому таких дорог каждого направления не больше одной
+    const RoadIndex* FindHorizontalRoad(const Position& pos) const noexcept;
+    const RoadIndex* FindVerticalRoad(const Position& pos) const noexcept;
+
     void AddRoad(const Road& road);
     void AddBuilding(const Building& building);
     void AddOffice(Office office);
     void SetDogSpeed(double speed);
     void SetBagCapacity(size_t bag_capacity);
+    void SetSessionCapacity(size_t session_capacity);
 
+    // Нормализует дорожную сеть и строит по ней индексы и граф перекрёстков
     void BuildRoadIndexes();
 
     const extra_data::ExtraData& GetExtraData() const noexcept;
@@ -247,10 +303,15 @@ public:
     
 private:
     using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
+
+    void NormalizeRoads();
+    void BuildRoadGraph();
     
     Id id_;
     std::string name_;
     Roads roads_;
+    Roads road_network_;
+    RoadGraph road_graph_;
     Buildings buildings_;
 
     OfficeIdToIndex warehouse_id_to_index_;
@@ -261,6 +322,7 @@ private:
 
     double dog_speed_ = 0;
     size_t bag_capacity_ = 3;
+    size_t session_capacity_ = 0;
 
     extra_data::ExtraData extra_data_;
 };
@@ -308,13 +370,22 @@ private:
 };
 
 
+class DogStore;
+
+// Собака - лёгкое представление записи в хранилище DogStore.
+// Собака, созданная конструктором с данными, получает собственное хранилище на одну запись;
+// собаки игровой сессии ссылаются на общее хранилище сессии.
+// Слот записи запоминается и ищется заново, только если из хранилища кого-то удалили.
+// Обращение к данным собаки, удалённой из хранилища, бросает std::out_of_range
 class Dog {
 public:
     friend class serialization::DogRepr;
+    friend class GameSession;
 
     using Id = util::Tagged<std::uint64_t, Dog>;
 
     Dog(Id id, std::string name, Position position, size_t bag_capacity);
+    Dog(std::shared_ptr<DogStore> store, Id id);
 
     void SetDefaultSpeed(double speed);
     void SetSpeed(Speed speed);
@@ -323,15 +394,15 @@ public:
     void IncreaseScore(size_t points);
 
     const Id& GetId() const noexcept;
-    const std::string& GetName() const noexcept;
-    const Position GetPosition() const noexcept;
-    const Speed GetSpeed() const noexcept;
-    const Direction GetDirection() const noexcept;
-    const size_t GetScore() const noexcept;
-    size_t GetBagCapacity() const noexcept;
+    const std::string& GetName() const;
+    const Position GetPosition() const;
+    const Speed GetSpeed() const;
+    const Direction GetDirection() const;
+    const size_t GetScore() const;
+    size_t GetBagCapacity() const;
 
     Position Move(double delta_time, const Map& roads);
-    void Stop() noexcept;
+    void Stop();
 
     bool AddItemToBag(Loot::Id id, size_t type);
     void ClearBag();
@@ -340,23 +411,59 @@ public:
     bool IsLeave(std::chrono::milliseconds time, std::chrono::milliseconds max_retired);
     int GetLeaveTime() const;
 
+    // Перемещает точку по дорогам карты; при упоре в край дороги обнуляет скорость
+    static Position MoveAlongRoads(Position& position, Speed& speed, double delta_time, const Map& map);
+    // Учитывает время в игре и простоя; возвращает false, если собаке пора на покой
+    static bool UpdateActivity(const Speed& speed, std::chrono::milliseconds time, std::chrono::milliseconds max_retired,
+        std::chrono::milliseconds& in_game, std::chrono::milliseconds& retired);
+
 private:
+    size_t GetSlot() const;
 
-    void MoveOnHorRoad(Position& clamped_pos, const Position& next_pos, const Road& road);
-    void MoveOnVertRoad(Position& clamped_pos, const Position& next_pos, const Road& road);
+    static void MoveOnHorRoad(Position& clamped_pos, const Position& next_pos, const Road::RoadCoord& coord);
+    static void MoveOnVertRoad(Position& clamped_pos, const Position& next_pos, const Road::RoadCoord& coord);
 
+    std::shared_ptr<DogStore> store_;
     Id id_;
-    std::string name_;
-    Position position_;
-    double default_speed_ = 1.0;
-    Speed speed_ = {0.0, 0.0};
-    Direction direction_ = Direction::NORTH;
-    size_t bag_capacity_ = 3;
-    Bag bag_;
-    size_t score_ = 0;
+    // Слот в store_, найденный при поколении хранилища generation_
+    mutable size_t slot_ = 0;
+    mutable uint64_t generation_ = 0;
+};
 
-    std::chrono::milliseconds in_game_ = 0ms;
-    std::chrono::milliseconds retired_ = 0ms;
+
+// Хранилище собак в виде структуры массивов: данные, которые обходятся на каждом тике,
+// лежат в отдельных непрерывных массивах, а имена и рюкзаки - отдельно от них.
+// Слот собаки меняется при удалении других собак, стабилен только Dog::Id.
+// Поколение растёт при каждом удалении, по нему Dog узнаёт, что слот мог сместиться
+class DogStore {
+public:
+    size_t Add(Dog::Id id, std::string name, Position position, size_t bag_capacity);
+    size_t Add(const DogStore& other, size_t other_slot);
+    void Remove(Dog::Id id);
+
+    // Бросает std::out_of_range, если собаки нет в хранилище
+    size_t GetSlot(Dog::Id id) const;
+    bool Contains(Dog::Id id) const noexcept;
+    size_t Size() const noexcept;
+    uint64_t GetGeneration() const noexcept;
+
+    // Горячие данные
+    std::vector<Dog::Id> ids;
+    std::vector<Position> positions;
+    std::vector<Speed> speeds;
+    std::vector<Direction> directions;
+    std::vector<double> default_speeds;
+    std::vector<std::chrono::milliseconds> retired_times;
+    std::vector<std::chrono::milliseconds> in_game_times;
+    std::vector<size_t> scores;
+
+    // Холодные данные
+    std::vector<std::string> names;
+    std::vector<Bag> bags;
+
+private:
+    util::FlatHashMap<Dog::Id, size_t, util::TaggedHasher<Dog::Id>> slots_;
+    uint64_t generation_ = 0;
 };
 
 
@@ -366,14 +473,12 @@ class GameSession;
 class ItemGathererProviderImpl : public collision_detector::ItemGathererProvider {
 public:
 
-    using DogPtr = std::shared_ptr<Dog>;
-    using LootPtr = std::shared_ptr<Loot>;
-    using Loots = std::unordered_map<Loot::Id, LootPtr, util::TaggedHasher<Loot::Id>>;
+    using Loots = util::SlotMap<Loot>;
 
     struct Movement {
         Position start;
         Position stop;
-        DogPtr dog;
+        size_t dog_slot;
     };
 
     enum class Type { 
@@ -385,7 +490,7 @@ public:
         Type type;
         geom::Point2D position;
         double width;
-        Loot::Id loot_id;
+        Loots::Handle loot;
         Office::Id office_id;
     };
 
@@ -395,15 +500,21 @@ public:
     collision_detector::Item GetItem(size_t idx) const override;
     size_t GatherersCount() const override;
     collision_detector::Gatherer GetGatherer(size_t idx) const override;
+    std::optional<collision_detector::ItemArrays> GetItemArrays() const override;
 
     const ObjectInfo& GetObjectInfo(size_t idx) const;
 
 private:
-    std::vector<Movement> movements_;
+    const std::vector<Movement>& movements_;
     const Loots& loots_;
     const Map::Offices& offices_;
 
     std::vector<ObjectInfo> objects_;
+
+    // Координаты и ширины объектов подряд - для пакетной проверки сбора
+    std::vector<double> objects_x_;
+    std::vector<double> objects_y_;
+    std::vector<double> objects_width_;
 };
 
 
@@ -416,8 +527,8 @@ public:
 
     struct CollectionEvent {      
         EventType type;
-        Dog::Id dog_id;
-        Loot::Id loot_id;
+        size_t dog_slot;
+        ItemGathererProviderImpl::Loots::Handle loot;
         Office::Id office_id;
         double time;
         
@@ -429,16 +540,19 @@ public:
 
     ItemCollector(const Map& map);
 
-    std::vector<Loot::Id> CollectItems(GameSession& session ,std::vector<ItemGathererProviderImpl::Movement> movements);
+    // Возвращает предметы, подобранные за тик; сами предметы из сессии не удаляются
+    const std::vector<ItemGathererProviderImpl::Loots::Handle>& CollectItems(GameSession& session, const std::vector<ItemGathererProviderImpl::Movement>& movements);
 
 private:
 
-    void ProcessGatherEvents(GameSession& session, const std::vector<ItemGathererProviderImpl::Movement>& movements, const ItemGathererProviderImpl& provider);   
+    void ProcessGatherEvents(const std::vector<ItemGathererProviderImpl::Movement>& movements, const ItemGathererProviderImpl& provider);   
     void ProcessSequentialEvents(GameSession& session); 
 
     const Map& map_;
     std::vector<CollectionEvent> all_events_;
-    std::vector<Loot::Id> collect_items_;
+    std::vector<ItemGathererProviderImpl::Loots::Handle> collect_items_;
+    // Слоты предметов, уже подобранных на текущем тике
+    std::vector<bool> consumed_loot_;
 };
 
 
@@ -448,48 +562,165 @@ public:
 
     using Id = util::Tagged<std::string, GameSession>;
     using DogPtr = std::shared_ptr<Dog>;
-    using Dogs = std::unordered_map<Dog::Id, DogPtr, util::TaggedHasher<Dog::Id>>;
-    using LootPtr = std::shared_ptr<Loot>;
-    using Loots = std::unordered_map<Loot::Id, LootPtr, util::TaggedHasher<Loot::Id>>;
+    using Dogs = util::FlatHashMap<Dog::Id, DogPtr, util::TaggedHasher<Dog::Id>>;
+    // Предметы лежат подряд и адресуются дескрипторами с проверкой поколения
+    using Loots = util::SlotMap<Loot>;
+    using LootHandle = Loots::Handle;
+
+    struct DogState {
+        Dog::Id id;
+        std::string name;
+        Position position;
+        Speed speed;
+        Direction direction;
+        std::vector<LootItem> bag;
+        size_t score;
+    };
+
+    struct LootState {
+        Loot::Id id;
+        size_t type;
+        Position position;
+    };
 
+    // Неизменяемый снимок состояния сессии. Сессия публикует новый снимок в конце
+    // тика и после входа игрока между тиками, а читать его можно из любого потока.
+    // Собаки и предметы упорядочены по возрастанию идентификаторов
     struct GameStateData {
-        Loots loots;
-        Dogs dogs;
+        // Номер тика, в котором опубликован снимок
+        uint64_t tick = 0;
+        // Номер публикации, растёт с каждым снимком, в том числе внутри одного тика
+        uint64_t version = 0;
+        // Сессии тикают вместе, поэтому номера у разных сессий совпадают
+        Id session_id{std::string{}};
+        std::vector<DogState> dogs;
+        std::vector<LootState> loots;
+
+        enum class FrameFormat {
+            JSON,
+            BINARY
+        };
+
+        // Сериализованное для клиентов представление снимка. Строится при первом
+        // обращении и дальше разделяется всеми читателями
+        template <typename Render>
+        const std::string& GetFrame(FrameFormat format, Render&& render) const {
+            auto& frame = frames_[static_cast<size_t>(format)];
+            std::call_once(frame.once, [&] {
+                frame.data = render(*this);
+            });
+            return frame.data;
+        }
+
+    private:
+        struct Frame {
+            std::once_flag once;
+            std::string data;
+        };
+        mutable Frame frames_[2];
+    };
+    using GameStatePtr = std::shared_ptr<const GameStateData>;
+
+    // Изменения между публикациями since и version. Если публикация since уже вытеснена
+    // из журнала, full == true и в dogs и loots лежит всё состояние
+    struct GameStateDelta {
+        Id session_id{std::string{}};
+        uint64_t since = 0;
+        uint64_t version = 0;
+        uint64_t tick = 0;
+        bool full = false;
+        std::vector<DogState> dogs;
+        std::vector<LootState> loots;
+        std::vector<Dog::Id> removed_dogs;
+        std::vector<Loot::Id> removed_loots;
+    };
+
+    // Сколько последних публикаций хранится в журнале изменений
+    static constexpr size_t STATE_JOURNAL_SIZE = 64;
+
+    // Длительность фаз последнего UpdateState
+    struct TickTimings {
+        std::chrono::steady_clock::duration loot_generation{};
+        std::chrono::steady_clock::duration movement{};
+        std::chrono::steady_clock::duration collection{};
+        std::chrono::steady_clock::duration publish{};
     };
 
     explicit GameSession(Id id, const Map& map, lootGeneratorConfig config, double retirement_time);
 
+    const Id& GetId() const noexcept;
     const Map& GetMap() const noexcept;
     const Dogs& GetDogs() const noexcept;
+    DogStore& GetDogStore() noexcept;
+    const DogStore& GetDogStore() const noexcept;
 
     DogPtr AddDog(std::string name, bool random_spavn);
+    // Продвигает сессию на один тик и возвращает собак, которым пора на покой.
+    // Снимок не публикуется: сначала вызывающий удаляет ушедших игроков
+    std::vector<DogPtr> Simulate(std::chrono::milliseconds time);
+    // Simulate и PublishState для сессии, из которой никто не уходит в этом тике
     std::vector<DogPtr> UpdateState(std::chrono::milliseconds time);
+    const TickTimings& GetLastTickTimings() const noexcept;
 
-    void AddLoot(LootPtr loot); 
-    Loots GetLoot() const noexcept;
+    LootHandle AddLoot(Loot loot);
+    const Loots& GetLoot() const noexcept;
 
-    GameStateData GetGameState() const noexcept;
+    GameStatePtr GetGameState() const noexcept;
+    GameStateDelta GetGameStateDelta(uint64_t since) const;
+    // Публикует снимок текущего состояния с номером последнего тика и новым номером
+    // публикации. Вызывается в конце тика, после ухода игроков, и после входа игрока
+    // между тиками, чтобы новый игрок сразу видел себя в состоянии
+    void PublishState();
 
     void GenerateLoot(std::chrono::milliseconds time_interval);
 
     void DeletePlayer(DogPtr dog);
 
+    // Случайные позиции и типы предметов берутся из генератора сессии.
+    // По умолчанию он засеян хешем ID сессии
+    void SetRandomSeed(uint64_t seed) noexcept;
+
 private:
 
+    DogPtr AttachDog(const Dog& dog);
     Position GenerateRandomPosition();
     int GenerateRandomNumber(int num);
     
     Id id_;
     const Map& map_;
 
+    // Данные собак лежат в dog_store_, dogs_ хранит их представления для API
+    std::shared_ptr<DogStore> dog_store_ = std::make_shared<DogStore>();
     Dogs dogs_;
     uint64_t next_dog_id_ = 0;
 
     Loots loots_;
     uint64_t next_loot_id_ = 0;
     loot_gen::LootGenerator loot_generator_;
+    util::Xoshiro256 random_;
     ItemCollector item_collector_;
     std::chrono::milliseconds retirement_time_;
+
+    uint64_t tick_ = 0;
+    uint64_t version_ = 0;
+    TickTimings tick_timings_;
+    std::atomic<GameStatePtr> state_ = std::make_shared<const GameStateData>();
+
+    // Изменения, внесённые одной публикацией относительно предыдущей
+    struct StateChanges {
+        uint64_t version = 0;
+        std::vector<DogState> dogs;
+        std::vector<LootState> loots;
+        std::vector<Dog::Id> removed_dogs;
+        std::vector<Loot::Id> removed_loots;
+    };
+
+    static StateChanges Diff(const GameStateData& from, const GameStateData& to);
+
+    // Изменения последних публикаций по возрастанию version, без пропусков;
+    // читается из потоков ввода-вывода
+    mutable std::mutex journal_mutex_;
+    std::deque<StateChanges> journal_;
 };
 
 
@@ -498,7 +729,9 @@ public:
     using Maps = std::vector<Map>;
     using MapIdHasher = util::TaggedHasher<Map::Id>;
     using SessionPtr = std::shared_ptr<GameSession>;
-    using Sessions = std::unordered_map<Map::Id, SessionPtr, MapIdHasher>;
+    using Sessions = util::FlatHashMap<GameSession::Id, SessionPtr, util::TaggedHasher<GameSession::Id>>;
+    // Экземпляры сессий каждой карты в порядке создания
+    using MapSessions = util::FlatHashMap<Map::Id, std::vector<SessionPtr>, MapIdHasher>;
     using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
 
     
@@ -507,7 +740,12 @@ public:
     const Maps& GetMaps() const noexcept;
 
     const Sessions& GetSessions() const noexcept;
+    SessionPtr FindGameSession(const GameSession::Id& id) const noexcept;
+    // Возвращает наименее заполненный экземпляр сессии на карте, в котором есть место.
+    // Если все экземпляры заполнены, создаёт новый. Для неизвестной карты возвращает nullptr
     SessionPtr FindOrAddGameSession(const Map::Id& map_id);
+    // Регистрирует готовую сессию, например восстановленную из сохранения
+    void AddGameSession(SessionPtr session);
 
     void SetSpeed(double speed);
     double GetSpeed() const noexcept;
@@ -517,18 +755,34 @@ public:
     void SetDefBagCapacity(size_t def_bag_capacity);
     size_t GetDefBagCapacity() const noexcept;
 
+    void SetDefSessionCapacity(size_t def_session_capacity);
+    size_t GetDefSessionCapacity() const noexcept;
+
     void SetRetirementTime(double time);
     double GetRetirementTime() const;
 
+    // Из этого значения выводятся seed генераторов всех новых сессий,
+    // так что одинаковые входные данные дают одинаковый мир
+    void SetRandomSeed(uint64_t seed) noexcept;
+    uint64_t GetRandomSeed() const noexcept;
+    // Seed генератора сессии с этим id
+    uint64_t GetSessionSeed(const GameSession::Id& session_id) const noexcept;
+
 private:
 
     Maps maps_;
     Sessions sessions_;
+    MapSessions map_sessions_;
     MapIdToIndex map_id_to_index_;
     double default_speed_ = 1.0;
     lootGeneratorConfig loot_gen_config_;
     size_t def_bag_capacity_ = 3;
+    size_t def_session_capacity_ = 0;
     double retirement_time_ = 60.0;
+    uint64_t random_seed_ = [] {
+        std::random_device random_device;
+        return (static_cast<uint64_t>(random_device()) << 32) | random_device();
+    }();
 };
 
 }  // namespace model
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <boost/serialization/unordered_map.hpp>
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 
 #include "model.h"
 
@@ -52,15 +54,15 @@ public:
     DogRepr() = default;
 
     explicit DogRepr(const Dog& dog)
-        : id_(dog.id_)
-        , name_(dog.name_)
-        , pos_(dog.position_)
-        , bag_capacity_(dog.bag_capacity_)
-        , speed_(dog.speed_)
-        , direction_(dog.direction_)
-        , score_(dog.score_)
-        , in_game_(std::chrono::duration_cast<std::chrono::duration<double>>(dog.in_game_).count())
-        , retired_(std::chrono::duration_cast<std::chrono::duration<double>>(dog.retired_).count()) {
+        : id_(dog.GetId())
+        , name_(dog.GetName())
+        , pos_(dog.GetPosition())
+        , bag_capacity_(dog.GetBagCapacity())
+        , speed_(dog.GetSpeed())
+        , direction_(dog.GetDirection())
+        , score_(dog.GetScore())
+        , in_game_(std::chrono::duration_cast<std::chrono::duration<double>>(dog.store_->in_game_times[dog.GetSlot()]).count())
+        , retired_(std::chrono::duration_cast<std::chrono::duration<double>>(dog.store_->retired_times[dog.GetSlot()]).count()) {
         
         for (const auto& item : dog.GetItemsFromBag()) {
             bag_.push_back(item);
@@ -69,11 +71,13 @@ public:
 
     [[nodiscard]] Dog Restore() const {
         Dog dog{id_, name_, pos_, bag_capacity_};
-        dog.speed_ = speed_;
-        dog.direction_ = direction_;
-        dog.score_ = score_;
-        dog.in_game_ = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>(in_game_));
-        dog.retired_ = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>(retired_));
+        dog.SetSpeed(speed_);
+        dog.SetDirection(direction_);
+        dog.IncreaseScore(score_);
+
+        const size_t slot = dog.GetSlot();
+        dog.store_->in_game_times[slot] = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>(in_game_));
+        dog.store_->retired_times[slot] = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>(retired_));
         for (const auto& item : bag_) {
             if (!dog.AddItemToBag(item.id, item.type)) {
                 throw std::runtime_error("Failed to put bag content");
@@ -149,14 +153,18 @@ public:
         , map_id_(session.map_.GetId())
         , next_dog_id_(session.next_dog_id_)
         , next_loot_id_(session.next_loot_id_)
-        , retirement_time_(std::chrono::duration_cast<std::chrono::duration<double>>(session.retirement_time_).count()) {
+        , retirement_time_(std::chrono::duration_cast<std::chrono::duration<double>>(session.retirement_time_).count())
+        , random_state_(session.random_.GetState())
+        , has_random_state_(true)
+        , tick_(session.tick_)
+        , version_(session.version_) {
         
         for (const auto& [id, dog] : session.dogs_) {
             dogs_.emplace(*id, DogRepr{*dog});
         }
         
-        for (const auto& [id, loot] : session.loots_) {
-            loots_.emplace(*id, LootRepr{*loot});
+        for (const auto& loot : session.loots_) {
+            loots_.emplace(*loot.GetId(), LootRepr{loot});
         }
     }
 
@@ -171,24 +179,32 @@ public:
         
         session->next_dog_id_ = next_dog_id_;
         session->next_loot_id_ = next_loot_id_;
+        // Номера тиков продолжаются, иначе ETag и журнал снимков повторились бы после перезапуска
+        session->tick_ = tick_;
+        session->version_ = version_;
+        // Генератор продолжает с того же места, что и до сохранения. В старых файлах
+        // состояния его нет, тогда seed выводится так же, как для новой сессии
+        if (has_random_state_) {
+            session->random_.SetState(random_state_);
+        } else {
+            session->SetRandomSeed(game.GetSessionSeed(id_));
+        }
         
         for (const auto& [id, dog_repr] : dogs_) {
-            Dog dog = dog_repr.Restore();
-            auto dog_ptr = std::make_shared<Dog>(std::move(dog));
-            session->dogs_.emplace(dog_ptr->GetId(), dog_ptr);
+            session->AttachDog(dog_repr.Restore());
         }
         
+        session->loots_.Reserve(loots_.size());
         for (const auto& [id, loot_repr] : loots_) {
-            Loot loot = loot_repr.Restore();
-            auto loot_ptr = std::make_shared<Loot>(std::move(loot));
-            session->loots_.emplace(loot_ptr->GetId(), loot_ptr);
+            session->loots_.Insert(loot_repr.Restore());
         }
-        
+
+        session->PublishState();
         return session;
     }
 
     template <typename Archive>
-    void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
+    void serialize(Archive& ar, const unsigned version) {
         ar& *id_;
         ar& *map_id_;
         ar& next_dog_id_;
@@ -196,6 +212,14 @@ public:
         ar& dogs_;
         ar& loots_;
         ar& retirement_time_;
+        if (version >= 1) {
+            for (auto& word : random_state_) {
+                ar& word;
+            }
+            has_random_state_ = true;
+            ar& tick_;
+            ar& version_;
+        }
     }
 
 private:
@@ -206,6 +230,13 @@ private:
     std::unordered_map<uint64_t, DogRepr> dogs_; 
     std::unordered_map<uint64_t, LootRepr> loots_;
     double retirement_time_;
+    util::Xoshiro256::State random_state_{};
+    bool has_random_state_ = false;
+    uint64_t tick_ = 0;
+    uint64_t version_ = 0;
 };
 
 }  // namespace serialization
+
+// Версия 1: состояние генератора сессии, номера тика и публикации
+BOOST_CLASS_VERSION(::serialization::GameSessionRepr, 1)
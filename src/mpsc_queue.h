@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace util {
+
+/*
+ *  Неограниченная очередь без блокировок для многих производителей и одного потребителя
+ *  (схема Д. Вьюкова). Push из любого потока - один атомарный обмен указателя,
+ *  Pop вызывает только поток-потребитель.
+ *  Пока производитель находится между обменом головы и связыванием узла, Pop может
+ *  не увидеть этот и следующие элементы. Поэтому потребитель, получивший nullopt,
+ *  должен узнать о новых элементах от производителя, а не полагаться на повторный Pop.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue()
+        : head_{new Node}
+        , tail_{head_.load(std::memory_order_relaxed)} {
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        while (Pop()) {
+        }
+        delete tail_;
+    }
+
+    void Push(T value) {
+        Node* node = new Node;
+        node->value.emplace(std::move(value));
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    std::optional<T> Pop() {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return std::nullopt;
+        }
+
+        // next становится новой заглушкой, значение из неё забираем
+        std::optional<T> value = std::move(next->value);
+        next->value.reset();
+        tail_ = next;
+        delete tail;
+        return value;
+    }
+
+    // Только для потока-потребителя
+    bool Empty() const noexcept {
+        return tail_->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next = nullptr;
+        std::optional<T> value;
+    };
+
+    // Сюда добавляют производители
+    std::atomic<Node*> head_;
+    // Заглушка, за которой лежит первый непрочитанный элемент
+    Node* tail_;
+};
+
+}  // namespace util
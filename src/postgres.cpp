@@ -4,6 +4,54 @@ namespace postgres_database {
 
 using namespace std::literals;
 
+namespace {
+
+constexpr auto SAVE_PLAYER = "save_retired_player"_zv;
+constexpr auto LOAD_PAGE = "load_records_page"_zv;
+constexpr auto LOAD_AFTER = "load_records_after"_zv;
+
+std::vector<domain::RetiredPlayer> ReadPlayers(const pqxx::result& rows) {
+    std::vector<domain::RetiredPlayer> result;
+    result.reserve(rows.size());
+    for (const auto& row : rows) {
+        result.emplace_back(domain::RetiredPlayerId::FromString(row[0].as<std::string>()), row[1].as<std::string>(),
+            row[2].as<int>(), row[3].as<int>());
+    }
+    return result;
+}
+
+// Повтор поможет, только если ошибка не зависит от самих строк: соединение оборвалось,
+// транзакция откатилась из-за конфликта или серверу не хватило ресурсов
+bool IsTransientWriteError(const std::exception& ex) {
+    return dynamic_cast<const pqxx::broken_connection*>(&ex)
+        || dynamic_cast<const pqxx::in_doubt_error*>(&ex)
+        || dynamic_cast<const pqxx::transaction_rollback*>(&ex)
+        || dynamic_cast<const pqxx::insufficient_resources*>(&ex);
+}
+
+void CreateSchema(pqxx::connection& conn) {
+    pqxx::work work(conn);
+
+    // Длина имени совпадает с domain::MAX_NAME_LENGTH, длиннее вход в игру не пускает
+    work.exec(
+    R"(CREATE TABLE IF NOT EXISTS retired_players (
+        id UUID CONSTRAINT retired_player_id_constraint PRIMARY KEY,
+        name varchar(100) NOT NULL,
+        score integer,
+        play_time_ms integer
+    );)"_zv);
+
+    // Имена сравниваются побайтно, чтобы порядок не зависел от локали базы и совпадал
+    // с таблицей рекордов в памяти, а id делает порядок строгим
+    work.exec(R"(CREATE INDEX IF NOT EXISTS retired_players_records_order_idx
+        ON retired_players (score DESC, play_time_ms, name COLLATE "C", id);)"_zv);
+    work.exec(R"(DROP INDEX IF EXISTS retired_players_score_play_time_name_idx;)"_zv);
+
+    work.commit();
+}
+
+}  // namespace
+
 DataBaseConfig GetConfigFromEnv() {
     DataBaseConfig config;
     if (const auto* url = std::getenv(DB_URL_ENV_NAME)) {
@@ -19,54 +67,119 @@ DataBaseConfig GetConfigFromEnv() {
 
 RetiredPlayerRepositoryImpl::RetiredPlayerRepositoryImpl(ConnectionPool& conn_pool) : conn_pool_(conn_pool) {}
 
+void RetiredPlayerRepositoryImpl::PrepareStatements(pqxx::connection& conn) {
+    conn.prepare(SAVE_PLAYER, "INSERT INTO retired_players (id, name, score, play_time_ms) VALUES ($1, $2, $3, $4);"_zv);
+    conn.prepare(LOAD_PAGE,
+        R"(SELECT id, name, score, play_time_ms FROM retired_players
+        ORDER BY score DESC, play_time_ms, name COLLATE "C", id LIMIT $1 OFFSET $2;)"_zv);
+    // Условие score <= $1 начинает обход индекса с очков курсора, а отбрасываются только
+    // строки с теми же очками, что стоят до курсора
+    conn.prepare(LOAD_AFTER,
+        R"(SELECT id, name, score, play_time_ms FROM retired_players
+        WHERE score <= $1 AND (score < $1 OR (play_time_ms, name COLLATE "C", id) > ($2, $3, $4))
+        ORDER BY score DESC, play_time_ms, name COLLATE "C", id LIMIT $5;)"_zv);
+}
+
 void RetiredPlayerRepositoryImpl::Save(const domain::RetiredPlayer& player) {
     auto conn = conn_pool_.GetConnection();
     pqxx::work work(*conn);
-    std::string query_text = "INSERT INTO retired_players (id, name, score, play_time_ms) VALUES ($1, $2, $3, $4);";
-    work.exec_params(query_text, player.GetId().ToString(), player.GetName(), player.GetScore(), player.GetTimeMs());
+    work.exec_prepared(SAVE_PLAYER, player.GetId().ToString(), player.GetName(), player.GetScore(), player.GetTimeMs());
     work.commit();
 }
 
-std::vector<domain::RetiredPlayer> RetiredPlayerRepositoryImpl::LoadFromDB(int offset, int max_elem) const {
-    auto conn = conn_pool_.GetConnection();
-    pqxx::read_transaction read{*conn};
-    std::vector<domain::RetiredPlayer> result;
-    std::string query_text = "SELECT id, name, score, play_time_ms FROM retired_players ORDER BY score DESC, play_time_ms, name LIMIT " 
-        + std::to_string(max_elem) + " OFFSET " + std::to_string(offset) + ";";
-
-    for(const auto& [id, name, score, time] : read.query<std::string, std::string, int, int>(query_text)) {
-        result.emplace_back(domain::RetiredPlayerId::FromString(id), name, score, time);
+void RetiredPlayerRepositoryImpl::SaveBatch(const std::vector<domain::RetiredPlayer>& players) {
+    if (players.empty()) {
+        return;
     }
 
-    return result;
-}
-
-DataBase::DataBase(const DataBaseConfig& config)
-    : conn_pool_(config.pool_capacity, [&db_url = config.db_url] { return std::make_shared<pqxx::connection>(db_url); })
-    , players_rep_(conn_pool_) {
+    std::string query_text = "INSERT INTO retired_players (id, name, score, play_time_ms) VALUES ";
+    pqxx::params params;
+    params.reserve(players.size() * 4);
+    for (size_t idx = 0; idx < players.size(); ++idx) {
+        const auto& player = players[idx];
+        const size_t first = idx * 4 + 1;
+        query_text += (idx == 0 ? "("s : ", ("s) + "$" + std::to_string(first) + ", $" + std::to_string(first + 1)
+            + ", $" + std::to_string(first + 2) + ", $" + std::to_string(first + 3) + ")";
+        params.append(player.GetId().ToString());
+        params.append(player.GetName());
+        params.append(player.GetScore());
+        params.append(player.GetTimeMs());
+    }
+    query_text += ";";
 
     auto conn = conn_pool_.GetConnection();
     pqxx::work work(*conn);
+    work.exec_params(query_text, params);
+    work.commit();
+}
 
-    work.exec(
-    R"(CREATE TABLE IF NOT EXISTS retired_players (
-        id UUID CONSTRAINT retired_player_id_constraint PRIMARY KEY,
-        name varchar(100) NOT NULL,
-        score integer,
-        play_time_ms integer
-    );)"_zv);
+std::vector<domain::RetiredPlayer> RetiredPlayerRepositoryImpl::LoadFromDB(int offset, int max_elem) const {
+    auto conn = conn_pool_.GetConnection();
+    pqxx::read_transaction read{*conn};
+    return ReadPlayers(read.exec_prepared(LOAD_PAGE, max_elem, offset));
+}
 
-    work.exec(R"(CREATE INDEX IF NOT EXISTS retired_players_score_play_time_name_idx ON retired_players (score DESC, play_time_ms, name);)"_zv);
+std::vector<domain::RetiredPlayer> RetiredPlayerRepositoryImpl::LoadAfter(const domain::RecordsKey& after, int max_elem) const {
+    auto conn = conn_pool_.GetConnection();
+    pqxx::read_transaction read{*conn};
+    return ReadPlayers(read.exec_prepared(LOAD_AFTER, after.score, after.play_time_ms, after.name, after.id.ToString(), max_elem));
+}
 
-    work.commit();
+DataBase::DataBase(const DataBaseConfig& config)
+    : conn_pool_(config.pool_capacity, [&db_url = config.db_url, schema_created = false]() mutable {
+        auto conn = std::make_shared<pqxx::connection>(db_url);
+        // Запросы готовятся один раз на соединение, а для этого нужна таблица
+        if (!schema_created) {
+            CreateSchema(*conn);
+            schema_created = true;
+        }
+        RetiredPlayerRepositoryImpl::PrepareStatements(*conn);
+        return conn;
+    })
+    , players_rep_(conn_pool_)
+    , leaderboard_(config.leaderboard_capacity)
+    , retired_writer_(config.write_queue,
+        [this](const std::vector<domain::RetiredPlayer>& players) {
+            players_rep_.SaveBatch(players);
+            leaderboard_.Add(players);
+        },
+        [handler = config.write_error_handler](const std::exception& ex) {
+            if (handler) {
+                handler(ex);
+            }
+        },
+        util::BatchWriter<domain::RetiredPlayer>::RegisterMetrics(metrics::GetRegistry(), "retired_players_writer"s),
+        IsTransientWriteError) {
+
+    leaderboard_.Reset(players_rep_.LoadFromDB(0, static_cast<int>(leaderboard_.GetCapacity())));
 }
 
 void DataBase::SaveRetiredPlayer(const model::RetiredPlayersInfo& player) {
-    players_rep_.Save(domain::RetiredPlayer{domain::RetiredPlayerId::New(), player.name, player.score, player.play_time});
+    retired_writer_.Add(domain::RetiredPlayer{domain::RetiredPlayerId::New(), player.name, player.score, player.play_time});
+}
+
+size_t DataBase::GetWriteQueueDepth() const {
+    return retired_writer_.GetQueueDepth();
 }
 
 const std::vector<domain::RetiredPlayer> DataBase::GetRetiredPlayers(int offset, int max_elem) const {
+    auto& server_metrics = metrics::GetServerMetrics();
+    if (auto records = leaderboard_.Find(offset, max_elem)) {
+        server_metrics.records_cache_hits.Add();
+        return std::move(*records);
+    }
+    server_metrics.records_cache_misses.Add();
     return players_rep_.LoadFromDB(offset, max_elem);
 }
 
+const std::vector<domain::RetiredPlayer> DataBase::GetRetiredPlayersAfter(const domain::RecordsKey& after, int max_elem) const {
+    auto& server_metrics = metrics::GetServerMetrics();
+    if (auto records = leaderboard_.FindAfter(after, max_elem)) {
+        server_metrics.records_cache_hits.Add();
+        return std::move(*records);
+    }
+    server_metrics.records_cache_misses.Add();
+    return players_rep_.LoadAfter(after, max_elem);
+}
+
 }
\ No newline at end of file
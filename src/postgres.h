@@ -1,5 +1,8 @@
 #pragma once
 
+#include "batch_writer.h"
+#include "leaderboard.h"
+#include "metrics.h"
 #include "model.h"
 #include "retired_player.h"
 
@@ -17,8 +20,15 @@ using pqxx::operator"" _zv;
 constexpr const char DB_URL_ENV_NAME[]{"GAME_DB_URL"};
 
 struct DataBaseConfig {
+    using WriteErrorHandler = std::function<void(const std::exception& ex)>;
+
     std::string db_url;
     size_t pool_capacity = 4;
+    // Ушедшие игроки записываются в фоне пачками
+    util::BatchWriter<domain::RetiredPlayer>::Config write_queue;
+    WriteErrorHandler write_error_handler;
+    // Столько первых мест таблицы рекордов отдаётся из памяти без запроса к базе
+    size_t leaderboard_capacity = 1000;
 };
 
 DataBaseConfig GetConfigFromEnv();
@@ -71,6 +81,7 @@ public:
     }
 
     ConnectionWrapper GetConnection() {
+        const auto wait_start = metrics::Clock::now();
         std::unique_lock lock{mutex_};
         // Блокируем текущий поток и ждём, пока cond_var_ не получит уведомление и не освободится
         // хотя бы одно соединение
@@ -78,6 +89,7 @@ public:
             return used_connections_ < pool_.size();
         });
         // После выхода из цикла ожидания мьютекс остаётся захваченным
+        metrics::GetServerMetrics().db_pool_wait.Record(metrics::Clock::now() - wait_start);
 
         return {std::move(pool_[used_connections_++]), *this};
     }
@@ -107,7 +119,14 @@ public:
     explicit RetiredPlayerRepositoryImpl(ConnectionPool& conn_pool);
 
     void Save(const domain::RetiredPlayer& player) override;
+    // Одна транзакция и один многострочный INSERT на всю пачку
+    void SaveBatch(const std::vector<domain::RetiredPlayer>& players) override;
     std::vector<domain::RetiredPlayer> LoadFromDB(int offset, int max_elem) const override;
+    // Страница сразу после after: стоимость не зависит от того, насколько глубоко она лежит
+    std::vector<domain::RetiredPlayer> LoadAfter(const domain::RecordsKey& after, int max_elem) const override;
+
+    // Готовит запросы репозитория на соединении, таблица уже должна существовать
+    static void PrepareStatements(pqxx::connection& conn);
 
 private:
     ConnectionPool& conn_pool_;
@@ -119,12 +138,20 @@ class DataBase {
 public:
     explicit DataBase(const DataBaseConfig& config);
 
+    // Не обращается к базе: игрок ставится в очередь фоновой записи
     void SaveRetiredPlayer(const model::RetiredPlayersInfo& player);
+    // Страницы в пределах leaderboard_capacity читаются из памяти, более глубокие - из базы
     const std::vector<domain::RetiredPlayer> GetRetiredPlayers(int offset, int max_elem) const;
+    const std::vector<domain::RetiredPlayer> GetRetiredPlayersAfter(const domain::RecordsKey& after, int max_elem) const;
+    size_t GetWriteQueueDepth() const;
     
 private:
     ConnectionPool conn_pool_;
     RetiredPlayerRepositoryImpl players_rep_;
+    // Попадают только записанные в базу игроки
+    util::Leaderboard<domain::RetiredPlayer, domain::RecordsOrder> leaderboard_;
+    // Объявлен последним, чтобы при разрушении дописать очередь, пока репозиторий жив
+    util::BatchWriter<domain::RetiredPlayer> retired_writer_;
 };
 
 
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace util {
+
+/*
+ *  Быстрый генератор псевдослучайных чисел xoshiro256**.
+ *  Удовлетворяет требованиям UniformRandomBitGenerator, поэтому работает со
+ *  стандартными распределениями. При одинаковом seed и одной и той же
+ *  стандартной библиотеке последовательность значений воспроизводится точно.
+ */
+class Xoshiro256 {
+public:
+    using result_type = uint64_t;
+    // Полное состояние генератора; после SetState последовательность продолжается с того же места
+    using State = std::array<uint64_t, 4>;
+
+    explicit Xoshiro256(uint64_t seed = 0) noexcept {
+        Seed(seed);
+    }
+
+    // Состояние заполняется через SplitMix64, так что подходит любой seed, включая 0
+    void Seed(uint64_t seed) noexcept {
+        for (auto& word : state_) {
+            word = SplitMix64(seed);
+        }
+    }
+
+    result_type operator()() noexcept {
+        const uint64_t result = RotateLeft(state_[1] * 5, 7) * 9;
+        const uint64_t t = state_[1] << 17;
+
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = RotateLeft(state_[3], 45);
+
+        return result;
+    }
+
+    const State& GetState() const noexcept {
+        return state_;
+    }
+
+    void SetState(const State& state) noexcept {
+        state_ = state;
+    }
+
+    static constexpr result_type min() noexcept {
+        return 0;
+    }
+
+    static constexpr result_type max() noexcept {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    // Перемешивает value; подходит для получения seed из других значений
+    static uint64_t SplitMix64(uint64_t& value) noexcept {
+        uint64_t z = (value += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+private:
+    static uint64_t RotateLeft(uint64_t x, int k) noexcept {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    State state_;
+};
+
+}  // namespace util
@@ -0,0 +1,267 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+#include <istream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace replay {
+
+using namespace std::literals;
+
+namespace {
+
+// FNV-1a
+class Checksum {
+public:
+    void Add(uint64_t value) noexcept {
+        for (int i = 0; i < 8; ++i) {
+            hash_ ^= (value >> (8 * i)) & 0xFF;
+            hash_ *= 0x100000001B3ull;
+        }
+    }
+
+    void Add(double value) noexcept {
+        Add(std::bit_cast<uint64_t>(value));
+    }
+
+    void Add(std::string_view value) noexcept {
+        Add(static_cast<uint64_t>(value.size()));
+        for (char c : value) {
+            hash_ ^= static_cast<unsigned char>(c);
+            hash_ *= 0x100000001B3ull;
+        }
+    }
+
+    uint64_t Get() const noexcept {
+        return hash_;
+    }
+
+private:
+    uint64_t hash_ = 0xCBF29CE484222325ull;
+};
+
+std::vector<model::Game::SessionPtr> SessionsInTickOrder(const model::Game& game) {
+    std::vector<model::Game::SessionPtr> sessions;
+    sessions.reserve(game.GetSessions().size());
+    for (const auto& [id, session] : game.GetSessions()) {
+        sessions.push_back(session);
+    }
+    std::sort(sessions.begin(), sessions.end(), [](const auto& lhs, const auto& rhs) {
+        return *lhs->GetId() < *rhs->GetId();
+    });
+    return sessions;
+}
+
+}  // namespace
+
+    JournalWriter::JournalWriter(const std::filesystem::path& path, uint64_t seed)
+        : file_(path, std::ios::trunc), out_(file_) {
+        if (!file_.is_open()) {
+            throw std::runtime_error("Failed to open input journal "s + path.string());
+        }
+        WriteHeader(seed);
+    }
+
+    JournalWriter::JournalWriter(std::ostream& out, uint64_t seed) : out_(out) {
+        WriteHeader(seed);
+    }
+
+    void JournalWriter::WriteHeader(uint64_t seed) {
+        // Скорости должны читаться обратно без потери точности
+        out_ << std::setprecision(std::numeric_limits<double>::max_digits10);
+        out_ << "journal "sv << JOURNAL_VERSION << ' ' << seed << '\n';
+    }
+
+    void JournalWriter::RecordJoin(const model::Map::Id& map_id, std::string_view name, bool random_spawn) {
+        std::lock_guard lock(mutex_);
+        out_ << "join "sv << random_spawn << ' ' << std::quoted(*map_id) << ' ' << std::quoted(name) << '\n';
+    }
+
+    void JournalWriter::RecordAction(const model::GameSession::Id& session_id, model::Dog::Id dog_id,
+                                     model::Speed speed, model::Direction direction) {
+        std::lock_guard lock(mutex_);
+        out_ << "action "sv << std::quoted(*session_id) << ' ' << *dog_id << ' ' << static_cast<int>(direction)
+             << ' ' << speed.x << ' ' << speed.y << '\n';
+    }
+
+    void JournalWriter::RecordTick(std::chrono::milliseconds delta) {
+        std::lock_guard lock(mutex_);
+        out_ << "tick "sv << delta.count() << '\n';
+        out_.flush();
+    }
+
+
+    Journal ReadJournal(std::istream& in) {
+        Journal journal;
+
+        std::string line;
+        if (!std::getline(in, line)) {
+            throw std::runtime_error("Input journal is empty"s);
+        }
+        {
+            std::istringstream header(line);
+            std::string tag;
+            int version = 0;
+            if (!(header >> tag >> version >> journal.seed) || tag != "journal"sv || version != JOURNAL_VERSION) {
+                throw std::runtime_error("Unsupported input journal header: "s + line);
+            }
+        }
+
+        while (std::getline(in, line)) {
+            if (line.empty()) {
+                continue;
+            }
+
+            std::istringstream event(line);
+            std::string tag;
+            event >> tag;
+            bool ok = false;
+
+            if (tag == "join"sv) {
+                JoinEvent join;
+                std::string map_id;
+                ok = static_cast<bool>(event >> join.random_spawn >> std::quoted(map_id) >> std::quoted(join.name));
+                join.map_id = model::Map::Id{std::move(map_id)};
+                journal.events.emplace_back(std::move(join));
+            }
+            else if (tag == "action"sv) {
+                ActionEvent action;
+                std::string session_id;
+                uint64_t dog_id = 0;
+                int direction = 0;
+                ok = static_cast<bool>(event >> std::quoted(session_id) >> dog_id >> direction
+                                             >> action.speed.x >> action.speed.y)
+                    && direction >= static_cast<int>(model::Direction::NORTH)
+                    && direction <= static_cast<int>(model::Direction::NONE);
+                action.session_id = model::GameSession::Id{std::move(session_id)};
+                action.dog_id = model::Dog::Id{dog_id};
+                action.direction = static_cast<model::Direction>(direction);
+                journal.events.emplace_back(std::move(action));
+            }
+            else if (tag == "tick"sv) {
+                int64_t delta = 0;
+                ok = static_cast<bool>(event >> delta) && delta >= 0;
+                journal.events.emplace_back(TickEvent{std::chrono::milliseconds{delta}});
+            }
+
+            if (!ok) {
+                throw std::runtime_error("Malformed input journal line: "s + line);
+            }
+        }
+        return journal;
+    }
+
+    Journal ReadJournal(const std::filesystem::path& path) {
+        std::ifstream in(path);
+        if (!in.is_open()) {
+            throw std::runtime_error("Failed to open input journal "s + path.string());
+        }
+        return ReadJournal(in);
+    }
+
+
+    ReplayDriver::ReplayDriver(model::Game& game) : game_(game) {}
+
+    void ReplayDriver::Run(const Journal& journal) {
+        game_.SetRandomSeed(journal.seed);
+        for (const auto& event : journal.events) {
+            Apply(event);
+        }
+    }
+
+    void ReplayDriver::Apply(const Event& event) {
+        if (const auto* join = std::get_if<JoinEvent>(&event)) {
+            ApplyJoin(*join);
+        } else if (const auto* action = std::get_if<ActionEvent>(&event)) {
+            ApplyAction(*action);
+        } else {
+            ApplyTick(std::get<TickEvent>(event));
+        }
+    }
+
+    const std::vector<std::chrono::nanoseconds>& ReplayDriver::GetTickTimes() const noexcept {
+        return tick_times_;
+    }
+
+    void ReplayDriver::ApplyJoin(const JoinEvent& event) {
+        auto session = game_.FindOrAddGameSession(event.map_id);
+        if (!session) {
+            throw std::runtime_error("Replay: map "s + *event.map_id + " not found"s);
+        }
+        session->AddDog(event.name, event.random_spawn);
+        // Как и сервер, публикует снимок сразу после входа
+        session->PublishState();
+    }
+
+    void ReplayDriver::ApplyAction(const ActionEvent& event) {
+        auto session = game_.FindGameSession(event.session_id);
+        if (!session) {
+            throw std::runtime_error("Replay: session "s + *event.session_id + " not found"s);
+        }
+
+        const auto& dogs = session->GetDogs();
+        auto dog = dogs.find(event.dog_id);
+        if (dog == dogs.end()) {
+            throw std::runtime_error("Replay: dog "s + std::to_string(*event.dog_id) + " not found in session "s + *event.session_id);
+        }
+
+        dog->second->SetDefaultSpeed(session->GetMap().GetDogSpeed());
+        dog->second->SetSpeed(event.speed);
+        dog->second->SetDirection(event.direction);
+    }
+
+    void ReplayDriver::ApplyTick(const TickEvent& event) {
+        // Тот же порядок, что и у сервера: сначала обновляются все сессии, затем уходят игроки
+        // и публикуются снимки
+        const auto sessions = SessionsInTickOrder(game_);
+
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<model::GameSession::DogPtr>> inactive_dogs(sessions.size());
+        for (size_t idx = 0; idx < sessions.size(); ++idx) {
+            inactive_dogs[idx] = sessions[idx]->Simulate(event.delta);
+        }
+        for (size_t idx = 0; idx < sessions.size(); ++idx) {
+            for (const auto& dog : inactive_dogs[idx]) {
+                sessions[idx]->DeletePlayer(dog);
+            }
+            sessions[idx]->PublishState();
+        }
+        tick_times_.push_back(std::chrono::steady_clock::now() - start);
+    }
+
+
+    uint64_t StateChecksum(const model::Game& game) {
+        Checksum checksum;
+        for (const auto& session : SessionsInTickOrder(game)) {
+            checksum.Add(*session->GetId());
+
+            const auto state = session->GetGameState();
+            for (const auto& dog : state->dogs) {
+                checksum.Add(*dog.id);
+                checksum.Add(dog.name);
+                checksum.Add(dog.position.x);
+                checksum.Add(dog.position.y);
+                checksum.Add(dog.speed.x);
+                checksum.Add(dog.speed.y);
+                checksum.Add(static_cast<uint64_t>(dog.direction));
+                checksum.Add(static_cast<uint64_t>(dog.score));
+                for (const auto& item : dog.bag) {
+                    checksum.Add(*item.id);
+                    checksum.Add(static_cast<uint64_t>(item.type));
+                }
+            }
+            for (const auto& loot : state->loots) {
+                checksum.Add(*loot.id);
+                checksum.Add(static_cast<uint64_t>(loot.type));
+                checksum.Add(loot.position.x);
+                checksum.Add(loot.position.y);
+            }
+        }
+        return checksum.Get();
+    }
+
+}  // namespace replay
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "model.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace replay {
+
+/*
+ *  Журнал входных данных игры и его воспроизведение.
+ *
+ *  Журнал текстовый, одно событие в строке:
+ *      journal <версия> <seed игры>
+ *      join <случайная позиция 0|1> "<ID карты>" "<имя>"
+ *      action "<ID сессии>" <ID собаки> <направление> <скорость x> <скорость y>
+ *      tick <миллисекунды>
+ *
+ *  Всё остальное в мире выводится из seed игры, поэтому повтор событий журнала
+ *  на том же конфиге и той же сборке воспроизводит мир точно.
+ *  Журнал имеет смысл писать с запуска без восстановленного состояния.
+ */
+constexpr int JOURNAL_VERSION = 1;
+
+struct JoinEvent {
+    model::Map::Id map_id{""};
+    std::string name;
+    bool random_spawn = false;
+};
+
+struct ActionEvent {
+    model::GameSession::Id session_id{""};
+    model::Dog::Id dog_id{0};
+    model::Speed speed{0.0, 0.0};
+    model::Direction direction = model::Direction::NONE;
+};
+
+struct TickEvent {
+    std::chrono::milliseconds delta{0};
+};
+
+using Event = std::variant<JoinEvent, ActionEvent, TickEvent>;
+
+struct Journal {
+    uint64_t seed = 0;
+    std::vector<Event> events;
+};
+
+// Записывает события по мере их поступления. Можно вызывать из разных потоков
+class JournalWriter {
+public:
+    JournalWriter(const std::filesystem::path& path, uint64_t seed);
+    JournalWriter(std::ostream& out, uint64_t seed);
+
+    void RecordJoin(const model::Map::Id& map_id, std::string_view name, bool random_spawn);
+    void RecordAction(const model::GameSession::Id& session_id, model::Dog::Id dog_id,
+                      model::Speed speed, model::Direction direction);
+    // Тик завершает группу событий, поэтому после него журнал сбрасывается на диск
+    void RecordTick(std::chrono::milliseconds delta);
+
+private:
+    void WriteHeader(uint64_t seed);
+
+    std::mutex mutex_;
+    std::ofstream file_;
+    std::ostream& out_;
+};
+
+// Бросает std::runtime_error, если журнал повреждён или его версия неизвестна
+Journal ReadJournal(std::istream& in);
+Journal ReadJournal(const std::filesystem::path& path);
+
+/*
+ *  Выполняет события журнала над игрой так же, как это делает сервер.
+ *  Игра должна быть загружена из того же конфига и ещё не иметь сессий.
+ */
+class ReplayDriver {
+public:
+    explicit ReplayDriver(model::Game& game);
+
+    // Задаёт seed игры и выполняет все события журнала
+    void Run(const Journal& journal);
+    // Бросает std::runtime_error, если событие не применимо к текущему миру
+    void Apply(const Event& event);
+
+    // Время выполнения каждого тика
+    const std::vector<std::chrono::nanoseconds>& GetTickTimes() const noexcept;
+
+private:
+    void ApplyJoin(const JoinEvent& event);
+    void ApplyAction(const ActionEvent& event);
+    void ApplyTick(const TickEvent& event);
+
+    model::Game& game_;
+    std::vector<std::chrono::nanoseconds> tick_times_;
+};
+
+// Контрольная сумма состояния всех сессий, чтобы сравнивать миры после воспроизведения
+uint64_t StateChecksum(const model::Game& game);
+
+}  // namespace replay
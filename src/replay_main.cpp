@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <boost/json.hpp>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "json_loader.h"
+#include "replay.h"
+
+using namespace std::literals;
+namespace json = boost::json;
+namespace po = boost::program_options;
+
+namespace {
+
+struct CommandLineArgs {
+    std::string config_file;
+    std::string journal_file;
+};
+
+std::optional<CommandLineArgs> ParseCommandLine(int argc, const char* argv[]) {
+    po::options_description desc("Allowed options");
+
+    CommandLineArgs args;
+    desc.add_options()
+        ("help,h", "produced help message")
+        ("config-file,c", po::value(&args.config_file)->value_name("file"s), "set config path")
+        ("journal,j", po::value(&args.journal_file)->value_name("file"s), "set input journal to replay");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.contains("help"s)) {
+        std::cout << desc;
+        return std::nullopt;
+    }
+    if (!vm.contains("config-file"s)) {
+        throw std::runtime_error("Config file have not been specified"s);
+    }
+    if (!vm.contains("journal"s)) {
+        throw std::runtime_error("Input journal have not been specified"s);
+    }
+    return args;
+}
+
+double ToMicroseconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}  // namespace
+
+// Воспроизводит журнал входных данных сервера и печатает время тиков
+// и контрольную сумму мира одной JSON-строкой
+int main(int argc, const char* argv[]) {
+    try {
+        auto args = ParseCommandLine(argc, argv);
+        if (!args) {
+            return EXIT_FAILURE;
+        }
+
+        model::Game game = json_loader::LoadGame(args->config_file);
+        const replay::Journal journal = replay::ReadJournal(args->journal_file);
+
+        replay::ReplayDriver driver(game);
+        driver.Run(journal);
+
+        auto tick_times = driver.GetTickTimes();
+        std::chrono::nanoseconds total{0};
+        for (auto time : tick_times) {
+            total += time;
+        }
+        std::sort(tick_times.begin(), tick_times.end());
+        const auto percentile = [&tick_times](double p) {
+            if (tick_times.empty()) {
+                return 0.0;
+            }
+            const auto idx = static_cast<size_t>(p * static_cast<double>(tick_times.size() - 1));
+            return ToMicroseconds(tick_times[idx]);
+        };
+
+        json::object result{
+            {"events", journal.events.size()},
+            {"ticks", tick_times.size()},
+            {"sessions", game.GetSessions().size()},
+            {"totalTickUs", ToMicroseconds(total)},
+            {"p50TickUs", percentile(0.5)},
+            {"p99TickUs", percentile(0.99)},
+            {"maxTickUs", percentile(1.0)},
+            {"checksum", std::to_string(replay::StateChecksum(game))}
+        };
+        std::cout << json::serialize(result) << std::endl;
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -11,10 +11,24 @@ namespace http_handler {
     using namespace json_fields;
 
     RequestHandler::RequestHandler(model::Game& game, std::filesystem::path static_path, 
-        app::Application& application, net::strand<net::io_context::executor_type> api_strand)
+        app::Application& application, util::SimulationThread& simulation)
         : game_{game}, static_path_(static_path), 
-        api_handler_(application),
-        api_strand_(api_strand) {}
+        api_handler_(application, simulation),
+        simulation_(simulation) {}
+
+    RequestHandler::StringResponse RequestHandler::MetricsResponse(const StringRequest& req) {
+            if (req.method() != http::verb::get && req.method() != http::verb::head) {
+                return ErrorResponseFile(http::status::method_not_allowed, "text/plain", "Invalid method");
+            }
+
+            StringResponse response;
+            response.result(http::status::ok);
+            response.set(http::field::content_type, "text/plain; version=0.0.4");
+            response.set(http::field::cache_control, "no-cache");
+            response.body() = metrics::GetRegistry().SerializePrometheus();
+            response.prepare_payload();
+            return response;
+    }
 
     RequestHandler::StringResponse RequestHandler::MapsResponseJSON() {
             json::array maps_array;
@@ -3,6 +3,7 @@
 #include "api_handler.h"
 #include "app.h"
 #include "http_server.h"
+#include "metrics.h"
 #include "model.h"
 
 #include <boost/json.hpp>
@@ -55,7 +56,7 @@ class RequestHandler {
 
 public:
     explicit RequestHandler(model::Game& game, std::filesystem::path static_path, 
-        app::Application& application, net::strand<net::io_context::executor_type> api_strand);
+        app::Application& application, util::SimulationThread& simulation);
 
     RequestHandler(const RequestHandler&) = delete;
     RequestHandler& operator=(const RequestHandler&) = delete;
@@ -65,20 +66,40 @@ public:
         // Обработать запрос request и отправить ответ, используя send
         auto target = std::string(req.target());
 
-        if(target.find("/api/") == 0) {           
-            net::dispatch(api_strand_, 
-                [this, req, send] () {
+        // Задержка считается до отправки ответа, включая ожидание в очереди потока симуляции
+        auto& route = metrics::GetServerMetrics().GetRoute(target);
+        const auto received = metrics::Clock::now();
+        auto measured_send = [&route, received, send](auto&& response) {
+            route.Record(received, response.result_int());
+            send(std::move(response));
+        };
+
+        if (target == METRICS_TARGET) {
+            measured_send(MetricsResponse(req));
+        }
+        else if (target.find("/api/") == 0 && ApiHandler::RunsOnSimulation(req)) {
+            simulation_.Post([this, req, measured_send, received] () {
+                metrics::GetServerMetrics().simulation_queue_wait.Record(metrics::Clock::now() - received);
                 auto response = api_handler_.HandleRequest(req);
-                send(std::move(response));
+                std::visit([&measured_send](auto&& resp) { measured_send(std::move(resp)); }, response);
             });
         }
+        else if(target.find("/api/") == 0) {
+            // Снимки сессий и карты неизменяемы, читаем их прямо в потоке ввода-вывода
+            auto response = api_handler_.HandleRequest(req);
+            std::visit([&measured_send](auto&& resp) { measured_send(std::move(resp)); }, response);
+        }
         else {
             auto response = HandleRequestFile(req);
-            std::visit([&send](auto&& resp) { send(std::move(resp)); }, response);
+            std::visit([&measured_send](auto&& resp) { measured_send(std::move(resp)); }, response);
         }
     }
 
 private:
+    static constexpr std::string_view METRICS_TARGET = "/metrics";
+
+    // Метрики в текстовом формате Prometheus
+    StringResponse MetricsResponse(const StringRequest& req);
 
     StringResponse MapsResponseJSON();
     StringResponse MapIdInfoResponseJSON(const model::Map* map);
@@ -95,7 +116,7 @@ private:
     ApiHandler api_handler_;
     model::Game& game_;
     std::filesystem::path static_path_;
-    net::strand<net::io_context::executor_type> api_strand_;
+    util::SimulationThread& simulation_;
 };
 
 };  // namespace http_handler
\ No newline at end of file
@@ -21,4 +21,34 @@ const int RetiredPlayer::GetTimeMs() const noexcept {
     return play_time_ms_;
 }
 
+RecordsKey RetiredPlayer::GetRecordsKey() const {
+    return RecordsKey{score_, play_time_ms_, name_, id_};
+}
+
+namespace {
+
+bool Precedes(int lhs_score, int lhs_time, const std::string& lhs_name, const RetiredPlayerId& lhs_id, const RetiredPlayer& rhs) {
+    if (lhs_score != rhs.GetScore()) {
+        return lhs_score > rhs.GetScore();
+    }
+    if (lhs_time != rhs.GetTimeMs()) {
+        return lhs_time < rhs.GetTimeMs();
+    }
+    const std::string rhs_name = rhs.GetName();
+    if (lhs_name != rhs_name) {
+        return lhs_name < rhs_name;
+    }
+    return *lhs_id < *rhs.GetId();
+}
+
+}  // namespace
+
+bool RecordsOrder::operator()(const RetiredPlayer& lhs, const RetiredPlayer& rhs) const {
+    return Precedes(lhs.GetScore(), lhs.GetTimeMs(), lhs.GetName(), lhs.GetId(), rhs);
+}
+
+bool RecordsOrder::operator()(const RecordsKey& lhs, const RetiredPlayer& rhs) const {
+    return Precedes(lhs.score, lhs.play_time_ms, lhs.name, lhs.id, rhs);
+}
+
 }
\ No newline at end of file
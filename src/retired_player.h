@@ -11,6 +11,18 @@ struct RetiredPlayerTag {};
 
 using RetiredPlayerId = util::TaggedUUID<detail::RetiredPlayerTag>;
 
+// Самое длинное имя игрока в символах: столько вмещает столбец name таблицы рекордов
+constexpr size_t MAX_NAME_LENGTH = 100;
+
+// Позиция в таблице рекордов, после которой продолжается постраничное чтение.
+// Очки, время и имя могут повторяться, поэтому в ключ входит id
+struct RecordsKey {
+    int score;
+    int play_time_ms;
+    std::string name;
+    RetiredPlayerId id;
+};
+
 class RetiredPlayer {
 public:
     RetiredPlayer(RetiredPlayerId id, std::string name, int score, int play_time_ms);
@@ -19,6 +31,7 @@ public:
     const std::string GetName() const noexcept;
     const int GetScore() const noexcept;
     const int GetTimeMs() const noexcept;
+    RecordsKey GetRecordsKey() const;
 
 private:
     RetiredPlayerId id_;
@@ -27,10 +40,19 @@ private:
     int play_time_ms_;
 };
 
+// Порядок таблицы рекордов: очки по убыванию, затем время игры, имя и id по возрастанию.
+// Имена сравниваются побайтно, как в базе с COLLATE "C"
+struct RecordsOrder {
+    bool operator()(const RetiredPlayer& lhs, const RetiredPlayer& rhs) const;
+    bool operator()(const RecordsKey& lhs, const RetiredPlayer& rhs) const;
+};
+
 class RetiredPlayerRepository {
 public:
     virtual void Save(const RetiredPlayer& player) = 0;
+    virtual void SaveBatch(const std::vector<RetiredPlayer>& players) = 0;
     virtual std::vector<RetiredPlayer> LoadFromDB(int offset, int max_elem) const = 0;
+    virtual std::vector<RetiredPlayer> LoadAfter(const RecordsKey& after, int max_elem) const = 0;
 protected:
     ~RetiredPlayerRepository() = default;
 };
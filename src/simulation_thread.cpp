@@ -0,0 +1,84 @@
+#include "simulation_thread.h"
+
+namespace util {
+
+    SimulationThread::SimulationThread() = default;
+
+    SimulationThread::~SimulationThread() {
+        Stop();
+    }
+
+    void SimulationThread::Post(Command command) {
+        commands_.Push(std::move(command));
+        ScheduleDrain();
+    }
+
+    void SimulationThread::StartTicker(std::chrono::milliseconds period, Ticker::Handler handler,
+                                       Ticker::CatchUpPolicy policy, Ticker::Metrics metrics) {
+        ticker_ = std::make_shared<Ticker>(strand_, period, [this, handler = std::move(handler)](std::chrono::milliseconds delta) {
+            // Команды, пришедшие с прошлого тика, применяются до обновления мира
+            DrainCommands();
+            handler(delta);
+        }, policy, metrics);
+        if (error_handler_) {
+            ticker_->SetErrorHandler(error_handler_);
+        }
+        ticker_->Start();
+    }
+
+    void SimulationThread::SetErrorHandler(ErrorHandler error_handler) {
+        error_handler_ = std::move(error_handler);
+        if (ticker_) {
+            ticker_->SetErrorHandler(error_handler_);
+        }
+    }
+
+    void SimulationThread::Start() {
+        thread_ = std::thread([this] {
+            ioc_.run();
+        });
+    }
+
+    void SimulationThread::Stop() {
+        if (!thread_.joinable()) {
+            return;
+        }
+
+        net::post(strand_, [this] {
+            if (ticker_) {
+                ticker_->Stop();
+            }
+            DrainCommands();
+            work_.reset();
+        });
+        thread_.join();
+    }
+
+    void SimulationThread::ScheduleDrain() {
+        // Одного запланированного выполнения хватает на все команды, пришедшие до его начала
+        if (!drain_scheduled_.exchange(true)) {
+            net::post(strand_, [this] {
+                DrainCommands();
+            });
+        }
+    }
+
+    void SimulationThread::DrainCommands() {
+        // Флаг сбрасывается до чтения очереди: производитель, не заставший флаг,
+        // успел связать свой узел и запланирует ещё одно выполнение
+        drain_scheduled_.store(false);
+
+        while (auto command = commands_.Pop()) {
+            try {
+                (*command)();
+            }
+            catch (const std::exception& ex) {
+                if (!error_handler_) {
+                    throw;
+                }
+                error_handler_(ex);
+            }
+        }
+    }
+
+}  // namespace util
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include <boost/asio.hpp>
+
+#include "mpsc_queue.h"
+#include "ticker.h"
+
+namespace util {
+
+namespace net = boost::asio;
+
+/*
+ *  Отдельный поток симуляции, которому принадлежит состояние игры.
+ *  Другие потоки не меняют игру сами, а кладут команды в очередь без блокировок.
+ *  Команды выполняются по порядку в начале каждого тика, а между тиками - сразу
+ *  после поступления, чтобы вход в игру и ручной тик не ждали следующего тика.
+ *  Поэтому долгий тик не задерживает запросы, которые читают опубликованные снимки.
+ */
+class SimulationThread {
+public:
+    using Command = std::function<void()>;
+    using ErrorHandler = std::function<void(const std::exception& ex)>;
+
+    SimulationThread();
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    // Можно вызывать из любого потока
+    void Post(Command command);
+
+    // Тики с фиксированным шагом; до Start
+    void StartTicker(std::chrono::milliseconds period, Ticker::Handler handler,
+                     Ticker::CatchUpPolicy policy, Ticker::Metrics metrics);
+    // Получает исключения из команд и тиков; без него исключение завершает программу. До Start
+    void SetErrorHandler(ErrorHandler error_handler);
+
+    void Start();
+    // Выполняет уже поставленные команды, останавливает тики и дожидается потока
+    void Stop();
+
+private:
+    void ScheduleDrain();
+    void DrainCommands();
+
+    net::io_context ioc_{1};
+    Ticker::Strand strand_{net::make_strand(ioc_)};
+    net::executor_work_guard<net::io_context::executor_type> work_{ioc_.get_executor()};
+
+    MpscQueue<Command> commands_;
+    // Выполнение команд уже запланировано в потоке симуляции
+    std::atomic<bool> drain_scheduled_ = false;
+
+    std::shared_ptr<Ticker> ticker_;
+    ErrorHandler error_handler_;
+    std::thread thread_;
+};
+
+}  // namespace util
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Хранилище объектов с устойчивыми дескрипторами.
+ *  Значения лежат подряд в одном векторе, поэтому обход идёт по непрерывной памяти.
+ *  Вставка и удаление выполняются за O(1): удалённый элемент заменяется последним,
+ *  а освободившийся слот уходит в список свободных.
+ *  Дескриптор хранит поколение слота, поэтому дескриптор удалённого объекта
+ *  не найдёт объект, занявший его слот позже.
+ *  Порядок обхода после удалений не сохраняется.
+ */
+template <typename T>
+class SlotMap {
+public:
+    struct Handle {
+        uint32_t index = INVALID_INDEX;
+        uint32_t generation = 0;
+
+        bool operator==(const Handle&) const = default;
+    };
+
+    using Values = std::vector<T>;
+    using ConstIterator = typename Values::const_iterator;
+
+    Handle Insert(T value) {
+        uint32_t index;
+        if (free_head_ != INVALID_INDEX) {
+            index = free_head_;
+            free_head_ = slots_[index].position;
+        } else {
+            index = static_cast<uint32_t>(slots_.size());
+            slots_.push_back({});
+        }
+
+        auto& slot = slots_[index];
+        slot.position = static_cast<uint32_t>(values_.size());
+        values_.push_back(std::move(value));
+        value_slots_.push_back(index);
+        return Handle{index, slot.generation};
+    }
+
+    // Возвращает false, если дескриптор уже недействителен
+    bool Remove(Handle handle) {
+        if (!Contains(handle)) {
+            return false;
+        }
+
+        auto& slot = slots_[handle.index];
+        const uint32_t position = slot.position;
+        const uint32_t last = static_cast<uint32_t>(values_.size() - 1);
+        if (position != last) {
+            values_[position] = std::move(values_[last]);
+            value_slots_[position] = value_slots_[last];
+            slots_[value_slots_[position]].position = position;
+        }
+        values_.pop_back();
+        value_slots_.pop_back();
+
+        ++slot.generation;
+        slot.position = free_head_;
+        free_head_ = handle.index;
+        return true;
+    }
+
+    bool Contains(Handle handle) const noexcept {
+        return handle.index < slots_.size()
+            && slots_[handle.index].generation == handle.generation
+            && IsOccupied(handle.index);
+    }
+
+    T* Find(Handle handle) noexcept {
+        return Contains(handle) ? &values_[slots_[handle.index].position] : nullptr;
+    }
+
+    const T* Find(Handle handle) const noexcept {
+        return Contains(handle) ? &values_[slots_[handle.index].position] : nullptr;
+    }
+
+    // Дескриптор значения, лежащего на позиции position при обходе
+    Handle GetHandle(size_t position) const {
+        const uint32_t index = value_slots_.at(position);
+        return Handle{index, slots_[index].generation};
+    }
+
+    // Число слотов; индексы дескрипторов всегда меньше него
+    size_t SlotCount() const noexcept {
+        return slots_.size();
+    }
+
+    size_t Size() const noexcept {
+        return values_.size();
+    }
+
+    bool Empty() const noexcept {
+        return values_.empty();
+    }
+
+    void Reserve(size_t count) {
+        values_.reserve(count);
+        value_slots_.reserve(count);
+        slots_.reserve(count);
+    }
+
+    void Clear() noexcept {
+        while (!values_.empty()) {
+            Remove(GetHandle(values_.size() - 1));
+        }
+    }
+
+    const Values& GetValues() const noexcept {
+        return values_;
+    }
+
+    ConstIterator begin() const noexcept {
+        return values_.begin();
+    }
+
+    ConstIterator end() const noexcept {
+        return values_.end();
+    }
+
+private:
+    static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+    struct Slot {
+        // Для занятого слота - позиция значения в values_, для свободного - следующий свободный слот
+        uint32_t position = INVALID_INDEX;
+        uint32_t generation = 0;
+    };
+
+    bool IsOccupied(uint32_t index) const noexcept {
+        const uint32_t position = slots_[index].position;
+        return position < value_slots_.size() && value_slots_[position] == index;
+    }
+
+    Values values_;
+    // Слот каждого значения из values_
+    std::vector<uint32_t> value_slots_;
+    std::vector<Slot> slots_;
+    uint32_t free_head_ = INVALID_INDEX;
+};
+
+}  // namespace util
@@ -0,0 +1,178 @@
+#include "state_encoding.h"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace state_encoding {
+
+using namespace std::literals;
+
+namespace {
+
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data_(data) {}
+
+    uint8_t ReadByte() {
+        if (pos_ >= data_.size()) {
+            throw std::invalid_argument("Unexpected end of binary state"s);
+        }
+        return static_cast<uint8_t>(data_[pos_++]);
+    }
+
+    uint64_t ReadVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint8_t byte = ReadByte();
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::invalid_argument("Varint is too long"s);
+    }
+
+    double ReadFixed() {
+        uint32_t raw = 0;
+        for (int i = 0; i < 4; ++i) {
+            raw |= static_cast<uint32_t>(ReadByte()) << (8 * i);
+        }
+        return static_cast<double>(static_cast<int32_t>(raw)) / FIXED_POINT_SCALE;
+    }
+
+    bool AtEnd() const noexcept {
+        return pos_ == data_.size();
+    }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+};
+
+char DirectionToChar(model::Direction dir) {
+    switch (dir) {
+        case model::Direction::NORTH: return 'U';
+        case model::Direction::SOUTH: return 'D';
+        case model::Direction::WEST: return 'L';
+        case model::Direction::EAST: return 'R';
+        case model::Direction::NONE: return 'N';
+    }
+    throw std::invalid_argument("Unknown direction"s);
+}
+
+model::Direction DirectionFromChar(char dir) {
+    switch (dir) {
+        case 'U': return model::Direction::NORTH;
+        case 'D': return model::Direction::SOUTH;
+        case 'L': return model::Direction::WEST;
+        case 'R': return model::Direction::EAST;
+        case 'N': return model::Direction::NONE;
+    }
+    throw std::invalid_argument("Unknown direction in binary state"s);
+}
+
+}  // namespace
+
+void WriteVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void WriteFixed(std::string& out, double value) {
+    const double scaled = std::round(value * FIXED_POINT_SCALE);
+    // Сравнение записано так, чтобы NaN тоже не прошёл проверку
+    if (!(scaled >= std::numeric_limits<int32_t>::min() && scaled <= std::numeric_limits<int32_t>::max())) {
+        throw std::out_of_range("Value does not fit into 16.16 fixed point"s);
+    }
+    const auto raw = static_cast<uint32_t>(static_cast<int32_t>(scaled));
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((raw >> (8 * i)) & 0xFF));
+    }
+}
+
+std::string EncodeBinary(const model::GameSession::GameStateData& state) {
+    std::string out;
+    // Оценка сверху, чтобы обойтись без перевыделений
+    out.reserve(16 + state.dogs.size() * 40 + state.loots.size() * 16);
+
+    out.push_back(static_cast<char>(BINARY_VERSION));
+    WriteVarint(out, state.tick);
+
+    WriteVarint(out, state.dogs.size());
+    for (const auto& dog : state.dogs) {
+        WriteVarint(out, *dog.id);
+        WriteFixed(out, dog.position.x);
+        WriteFixed(out, dog.position.y);
+        WriteFixed(out, dog.speed.x);
+        WriteFixed(out, dog.speed.y);
+        out.push_back(DirectionToChar(dog.direction));
+        WriteVarint(out, dog.score);
+        WriteVarint(out, dog.bag.size());
+        for (const auto& item : dog.bag) {
+            WriteVarint(out, *item.id);
+            WriteVarint(out, item.type);
+        }
+    }
+
+    WriteVarint(out, state.loots.size());
+    for (const auto& loot : state.loots) {
+        WriteVarint(out, *loot.id);
+        WriteVarint(out, loot.type);
+        WriteFixed(out, loot.position.x);
+        WriteFixed(out, loot.position.y);
+    }
+
+    return out;
+}
+
+model::GameSession::GameStatePtr DecodeBinary(std::string_view data) {
+    Reader reader(data);
+
+    if (reader.ReadByte() != BINARY_VERSION) {
+        throw std::invalid_argument("Unsupported binary state version"s);
+    }
+
+    auto state = std::make_shared<model::GameSession::GameStateData>();
+    state->tick = reader.ReadVarint();
+
+    const uint64_t dogs_count = reader.ReadVarint();
+    for (uint64_t i = 0; i < dogs_count; ++i) {
+        // Имя в двоичный формат не входит
+        model::GameSession::DogState dog{model::Dog::Id{reader.ReadVarint()}, {}, {}, {}, model::Direction::NONE, {}, 0};
+        dog.position.x = reader.ReadFixed();
+        dog.position.y = reader.ReadFixed();
+        dog.speed.x = reader.ReadFixed();
+        dog.speed.y = reader.ReadFixed();
+        dog.direction = DirectionFromChar(static_cast<char>(reader.ReadByte()));
+        dog.score = reader.ReadVarint();
+
+        const uint64_t bag_size = reader.ReadVarint();
+        for (uint64_t j = 0; j < bag_size; ++j) {
+            model::LootItem item;
+            item.id = model::Loot::Id{reader.ReadVarint()};
+            item.type = reader.ReadVarint();
+            dog.bag.push_back(item);
+        }
+        state->dogs.push_back(std::move(dog));
+    }
+
+    const uint64_t loots_count = reader.ReadVarint();
+    for (uint64_t i = 0; i < loots_count; ++i) {
+        model::GameSession::LootState loot{model::Loot::Id{reader.ReadVarint()}, 0, {}};
+        loot.type = reader.ReadVarint();
+        loot.position.x = reader.ReadFixed();
+        loot.position.y = reader.ReadFixed();
+        state->loots.push_back(loot);
+    }
+
+    if (!reader.AtEnd()) {
+        throw std::invalid_argument("Trailing data in binary state"s);
+    }
+    return state;
+}
+
+}  // namespace state_encoding
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "model.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace state_encoding {
+
+/*
+ *  Компактное двоичное представление снимка сессии (little-endian).
+ *
+ *  u8     версия формата (BINARY_VERSION)
+ *  varint tick
+ *  varint число собак, для каждой:
+ *         varint id, i32 x, i32 y, i32 speed_x, i32 speed_y, u8 направление ('U', 'D', 'L', 'R', 'N' - нет),
+ *         varint score, varint число предметов в рюкзаке, для каждого: varint id, varint type
+ *  varint число предметов на карте, для каждого:
+ *         varint id, varint type, i32 x, i32 y
+ *
+ *  Координаты и скорости хранятся в фиксированной точке 16.16, поэтому по модулю
+ *  должны быть меньше 32768.
+ *  varint - беззнаковое число группами по 7 бит, младшие группы первыми.
+ *  Браузерный клиент (static/js/game.js) разбирает тот же формат: при смене версии
+ *  нужно поменять и binaryStateVersion в нём.
+ */
+constexpr uint8_t BINARY_VERSION = 2;
+constexpr double FIXED_POINT_SCALE = 65536.0;
+
+void WriteVarint(std::string& out, uint64_t value);
+// Бросает std::out_of_range, если значение не помещается в 16.16
+void WriteFixed(std::string& out, double value);
+
+// Бросает std::out_of_range, если координата или скорость не помещается в 16.16
+std::string EncodeBinary(const model::GameSession::GameStateData& state);
+
+// Восстанавливает снимок из двоичного представления; координаты - с точностью 16.16.
+// Бросает std::invalid_argument, если данные повреждены или версия неизвестна
+model::GameSession::GameStatePtr DecodeBinary(std::string_view data);
+
+}  // namespace state_encoding
@@ -0,0 +1,117 @@
+#include "state_push.h"
+
+#include <boost/asio/post.hpp>
+
+namespace http_handler {
+
+    StatePushChannel::StatePushChannel(app::Application& application, util::SimulationThread& simulation)
+        : application_(application), simulation_(simulation) {}
+
+    void StatePushChannel::Connect(std::shared_ptr<http_server::WebSocketSession> ws, StringRequest&& request) {
+        if (ApiHandler::GetPath(request.target()) != requests::GAME_WS) {
+            return ws->Reject(std::move(request), "Bad request");
+        }
+
+        auto token = ApiHandler::GetToken(request);
+        if (!token) {
+            return ws->Reject(std::move(request), "Authorization token is missing");
+        }
+
+        auto player = application_.GetPlayers().FindPlayerByToken(*token);
+        if (!player) {
+            return ws->Reject(std::move(request), "Player token has not been found");
+        }
+
+        // Токен пришёл подпротоколом - клиент ждёт его в ответе на рукопожатие
+        std::string protocol;
+        if (ApiHandler::GetProtocolToken(request)) {
+            protocol = ApiHandler::TOKEN_PROTOCOL;
+        }
+
+        std::weak_ptr<StatePushChannel> weak_self = weak_from_this();
+        std::weak_ptr<http_server::WebSocketSession> weak_ws = ws;
+        ws->Accept(std::move(request), std::move(protocol),
+            // Пока рукопожатие не завершено, тики соединению ничего не рассылают
+            [weak_self, weak_ws, token = *token, session = player->GetSession()] {
+                auto self = weak_self.lock();
+                auto ws = weak_ws.lock();
+                if (self && ws) {
+                    self->Subscribe(token, session, ws);
+                }
+            },
+            [weak_self, token = *token](std::string message) {
+                if (auto self = weak_self.lock()) {
+                    self->HandleMessage(token, message);
+                }
+            },
+            // Отписка происходит на следующем тике, когда соединение уже уничтожено
+            nullptr);
+    }
+
+    void StatePushChannel::Subscribe(const app::Token& token, std::shared_ptr<model::GameSession> session,
+                                     const std::shared_ptr<http_server::WebSocketSession>& ws) {
+        std::lock_guard lock(mutex_);
+        // Игрок мог уйти на покой, пока шло рукопожатие
+        if (!application_.GetPlayers().FindPlayerByToken(token)) {
+            return ws->Close();
+        }
+        // Под той же блокировкой, что и рассылка тика, чтобы начальный кадр ушёл первым
+        ws->Send(MakeFrame(*session));
+        subscribers_.push_back({token, std::move(session), ws});
+    }
+
+    void StatePushChannel::OnTick([[maybe_unused]] std::chrono::milliseconds delta) {
+        std::lock_guard lock(mutex_);
+
+        std::erase_if(subscribers_, [this](const Subscriber& subscriber) {
+            auto ws = subscriber.ws.lock();
+            if (!ws) {
+                return true;
+            }
+            // Собака ушла на покой - токен больше не действует
+            if (!application_.GetPlayers().FindPlayerByToken(subscriber.token)) {
+                ws->Close();
+                return true;
+            }
+            ws->Send(MakeFrame(*subscriber.session));
+            return false;
+        });
+    }
+
+    void StatePushChannel::HandleMessage(const app::Token& token, std::string_view message) {
+        json::value command;
+        try {
+            command = json::parse(message);
+        }
+        catch (const std::exception&) {
+            return;
+        }
+
+        if (!command.is_object() || !command.as_object().contains("move") || !command.as_object().at("move").is_string()) {
+            return;
+        }
+
+        std::string move_direction(command.as_object().at("move").get_string());
+        if (!ApiHandler::IsValidMoveDirection(move_direction)) {
+            return;
+        }
+
+        // Состояние игры меняется только в потоке симуляции
+        simulation_.Post([self = shared_from_this(), token, move_direction = std::move(move_direction)] {
+            try {
+                self->application_.SetPlayerAction(token, move_direction);
+            }
+            catch (const app::ApiError&) {
+                // Игрок успел уйти на покой
+            }
+        });
+    }
+
+    http_server::WebSocketSession::Message StatePushChannel::MakeFrame(const model::GameSession& session) {
+        // Кадр принадлежит снимку, поэтому сообщение продлевает жизнь снимка, а не копирует строку
+        auto state = session.GetGameState();
+        const std::string& frame = state->GetFrame(model::GameSession::GameStateData::FrameFormat::JSON, ApiHandler::RenderGameState);
+        return http_server::WebSocketSession::Message(state, &frame);
+    }
+
+}  // namespace http_handler
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "api_handler.h"
+#include "app.h"
+#include "http_server.h"
+#include "simulation_thread.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace http_handler {
+
+namespace net = boost::asio;
+
+/*
+ *  Канал WebSocket для игроков: после каждого тика отправляет клиенту состояние его
+ *  сессии и принимает команды движения {"move": "L"} по тому же соединению.
+ *  Токен передаётся заголовком Authorization или подпротоколом
+ *  (Sec-WebSocket-Protocol: bearer, <токен>) и проверяется один раз при подключении.
+ */
+class StatePushChannel : public app::ApplicationListener, public std::enable_shared_from_this<StatePushChannel> {
+public:
+    using StringRequest = http::request<http::string_body>;
+
+    StatePushChannel(app::Application& application, util::SimulationThread& simulation);
+
+    void Connect(std::shared_ptr<http_server::WebSocketSession> ws, StringRequest&& request);
+
+    // Вызывается в потоке симуляции после обновления состояния игры
+    void OnTick(std::chrono::milliseconds delta) override;
+
+private:
+    struct Subscriber {
+        app::Token token;
+        std::shared_ptr<model::GameSession> session;
+        std::weak_ptr<http_server::WebSocketSession> ws;
+    };
+
+    // Вызывается после рукопожатия: отправляет текущее состояние и подписывает на тики
+    void Subscribe(const app::Token& token, std::shared_ptr<model::GameSession> session,
+                   const std::shared_ptr<http_server::WebSocketSession>& ws);
+    void HandleMessage(const app::Token& token, std::string_view message);
+    static http_server::WebSocketSession::Message MakeFrame(const model::GameSession& session);
+
+    app::Application& application_;
+    util::SimulationThread& simulation_;
+
+    std::mutex mutex_;
+    std::vector<Subscriber> subscribers_;
+};
+
+}  // namespace http_handler
@@ -0,0 +1,106 @@
+#include "task_pool.h"
+
+namespace util {
+
+    TaskPool::TaskPool(size_t helpers) {
+        threads_.reserve(helpers);
+        for (size_t i = 0; i < helpers; ++i) {
+            threads_.emplace_back([this] {
+                WorkerLoop();
+            });
+        }
+    }
+
+    TaskPool::~TaskPool() {
+        {
+            std::lock_guard lock(mutex_);
+            stopped_ = true;
+        }
+        wake_cv_.notify_all();
+
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    void TaskPool::ParallelFor(size_t count, const Task& task) {
+        if (count == 0) {
+            return;
+        }
+
+        Job job{task, count, 0, {}, nullptr};
+
+        if (count > 1 && !threads_.empty()) {
+            {
+                std::lock_guard lock(mutex_);
+                job_ = &job;
+                ++generation_;
+            }
+            wake_cv_.notify_all();
+        }
+
+        RunJob(job);
+
+        {
+            // Задачи разобраны, ждём помощников, которые ещё доделывают свои
+            std::unique_lock lock(mutex_);
+            job_ = nullptr;
+            done_cv_.wait(lock, [this] {
+                return active_ == 0;
+            });
+        }
+
+        if (job.error) {
+            std::rethrow_exception(job.error);
+        }
+    }
+
+    size_t TaskPool::GetHelpersCount() const noexcept {
+        return threads_.size();
+    }
+
+    size_t TaskPool::DefaultHelpers() noexcept {
+        const unsigned cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 0;
+    }
+
+    void TaskPool::WorkerLoop() {
+        uint64_t seen_generation = 0;
+        std::unique_lock lock(mutex_);
+
+        while (true) {
+            wake_cv_.wait(lock, [&] {
+                return stopped_ || (job_ != nullptr && generation_ != seen_generation);
+            });
+            if (stopped_) {
+                return;
+            }
+
+            seen_generation = generation_;
+            Job* job = job_;
+            ++active_;
+
+            lock.unlock();
+            RunJob(*job);
+            lock.lock();
+
+            if (--active_ == 0) {
+                done_cv_.notify_all();
+            }
+        }
+    }
+
+    void TaskPool::RunJob(Job& job) {
+        for (size_t i = job.next++; i < job.count; i = job.next++) {
+            try {
+                job.task(i);
+            } catch (...) {
+                std::lock_guard lock(job.error_mutex);
+                if (!job.error) {
+                    job.error = std::current_exception();
+                }
+            }
+        }
+    }
+
+}  // namespace util
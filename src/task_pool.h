@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Пул потоков для параллельной обработки независимых задач.
+ *  Вызывающий поток сам участвует в работе, поэтому пул без помощников
+ *  просто выполняет задачи последовательно.
+ */
+class TaskPool {
+public:
+    using Task = std::function<void(size_t)>;
+
+    // helpers - количество потоков-помощников помимо вызывающего
+    explicit TaskPool(size_t helpers = DefaultHelpers());
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    /*
+     * Вызывает task(i) для всех i из [0, count) и дожидается их завершения.
+     * Потоки разбирают индексы по одному, поэтому освободившийся поток сразу
+     * берёт следующую задачу, а долгая задача не задерживает остальные.
+     * Если задачи бросили исключения, после завершения всех задач пробрасывается одно из них.
+     * Одновременно ParallelFor может выполняться только в одном потоке.
+     */
+    void ParallelFor(size_t count, const Task& task);
+
+    size_t GetHelpersCount() const noexcept;
+
+    static size_t DefaultHelpers() noexcept;
+
+private:
+    struct Job {
+        const Task& task;
+        size_t count;
+        std::atomic<size_t> next = 0;
+        std::mutex error_mutex;
+        std::exception_ptr error;
+    };
+
+    void WorkerLoop();
+    static void RunJob(Job& job);
+
+    std::mutex mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable done_cv_;
+    Job* job_ = nullptr;
+    uint64_t generation_ = 0;
+    size_t active_ = 0;
+    bool stopped_ = false;
+
+    std::vector<std::thread> threads_;
+};
+
+}  // namespace util
@@ -1,68 +1,191 @@
 #pragma once
 
 #include <boost/asio.hpp>
+#include <algorithm>
 #include <chrono>
+#include <exception>
 #include <functional>
 #include <memory>
 
+#include "metrics.h"
+
 namespace net = boost::asio;
 
+/*
+ *  Планировщик тиков с фиксированным шагом.
+ *  Сроки тиков отсчитываются от момента запуска (start + n * period), поэтому время
+ *  работы обработчика не накапливается в дрейф. Если тик опоздал на целые периоды,
+ *  пропущенное время обрабатывается согласно CatchUpPolicy.
+ *  Опоздание каждого тика, переполнения и пропущенные тики попадают в метрики.
+ */
 class Ticker : public std::enable_shared_from_this<Ticker> {
 public:
     using Strand = net::strand<net::io_context::executor_type>;
     using Handler = std::function<void(std::chrono::milliseconds delta)>;
+    using ErrorHandler = std::function<void(const std::exception& ex)>;
+
+    enum class CatchUpPolicy {
+        // Один тик с шагом period, пропущенные периоды отбрасываются
+        SKIP,
+        // По тику с шагом period на каждый пропущенный период, но не больше MAX_CATCH_UP_STEPS
+        SUB_STEP,
+        // Один тик с шагом, равным прошедшему времени, но не больше MAX_CATCH_UP_STEPS периодов
+        CLAMP
+    };
+
+    static constexpr int64_t MAX_CATCH_UP_STEPS = 5;
+
+    struct Metrics {
+        metrics::Counter& ticks;
+        // Обработчик не уложился в период и следующий тик начнётся с опозданием
+        metrics::Counter& overruns;
+        metrics::Counter& skipped_ticks;
+        metrics::Counter& handler_errors;
+        // Насколько позже срока начался тик
+        metrics::Histogram& lateness;
+    };
+
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t overruns = 0;
+        uint64_t skipped_ticks = 0;
+        uint64_t handler_errors = 0;
+        std::chrono::microseconds lateness_p50{};
+        std::chrono::microseconds lateness_p99{};
+        std::chrono::microseconds max_lateness{};
+    };
+
+    static Metrics RegisterMetrics(metrics::Registry& registry) {
+        using namespace std::literals;
+        return Metrics{
+            registry.AddCounter("ticker_ticks_total"sv, "Game ticks run by the scheduler"sv),
+            registry.AddCounter("ticker_overruns_total"sv, "Ticks that did not finish before the next deadline"sv),
+            registry.AddCounter("ticker_skipped_ticks_total"sv, "Periods dropped by the catch-up policy"sv),
+            registry.AddCounter("ticker_handler_errors_total"sv, "Exceptions thrown by the tick handler"sv),
+            registry.AddHistogram("ticker_lateness_seconds"sv, "Delay between tick deadline and tick start"sv)
+        };
+    }
 
-    Ticker(Strand strand, std::chrono::milliseconds period, Handler handler)
+    Ticker(Strand strand, std::chrono::milliseconds period, Handler handler, CatchUpPolicy policy, Metrics metrics)
         : strand_{strand}
         , period_{period}
-        , handler_{std::move(handler)} {
+        , handler_{std::move(handler)}
+        , policy_{policy}
+        , metrics_{metrics} {
+    }
+
+    // Без обработчика ошибок исключение из тика прерывает работу io_context
+    void SetErrorHandler(ErrorHandler error_handler) {
+        error_handler_ = std::move(error_handler);
     }
 
     void Start() {
         net::dispatch(strand_, [self = shared_from_this()] {
             self->last_tick_ = Clock::now();
+            self->deadline_ = self->last_tick_ + self->period_;
             self->ScheduleTick();
         });
     }
 
     void Stop() {
         net::dispatch(strand_, [self = shared_from_this()] {
+            self->stopped_ = true;
             boost::system::error_code ec;
             self->timer_.cancel(ec);
         });
     }
 
+    // Можно вызывать из любого потока
+    Stats GetStats() const {
+        using std::chrono::microseconds;
+        return Stats{
+            metrics_.ticks.Get(),
+            metrics_.overruns.Get(),
+            metrics_.skipped_ticks.Get(),
+            metrics_.handler_errors.Get(),
+            microseconds(metrics_.lateness.Percentile(0.5)),
+            microseconds(metrics_.lateness.Percentile(0.99)),
+            microseconds(metrics_.lateness.Percentile(1.0))
+        };
+    }
+
 private:
+    using Clock = std::chrono::steady_clock;
+
     void ScheduleTick() {
-        timer_.expires_after(period_);
-        timer_.async_wait([self = shared_from_this()](sys::error_code ec) {
+        timer_.expires_at(deadline_);
+        timer_.async_wait([self = shared_from_this()](boost::system::error_code ec) {
             self->OnTick(ec);
         });
     }
 
-    void OnTick(sys::error_code ec) {
+    void OnTick(boost::system::error_code ec) {
         using namespace std::chrono;
-        
-        if (!ec) {
-            auto this_tick = Clock::now();
-            auto delta = duration_cast<milliseconds>(this_tick - last_tick_);
-            last_tick_ = this_tick;
-            
-            try {
-                handler_(delta);
-            } catch (...) {
-                // Игнорируем исключения в обработчике
+
+        if (ec || stopped_) {
+            return;
+        }
+
+        const auto now = Clock::now();
+        const auto lateness = std::max(now - deadline_, Clock::duration::zero());
+        metrics_.lateness.Record(lateness);
+
+        // Сколько следующих сроков тоже уже прошло
+        const int64_t missed = lateness / period_;
+        deadline_ += period_ * (missed + 1);
+
+        switch (policy_) {
+        case CatchUpPolicy::SKIP:
+            metrics_.skipped_ticks.Add(missed);
+            RunHandler(period_);
+            break;
+        case CatchUpPolicy::SUB_STEP: {
+            const int64_t steps = std::min(missed + 1, MAX_CATCH_UP_STEPS);
+            metrics_.skipped_ticks.Add(missed + 1 - steps);
+            for (int64_t step = 0; step < steps && !stopped_; ++step) {
+                RunHandler(period_);
             }
-            
+            break;
+        }
+        case CatchUpPolicy::CLAMP: {
+            const auto elapsed = duration_cast<milliseconds>(now - last_tick_);
+            const auto delta = std::min(elapsed, period_ * MAX_CATCH_UP_STEPS);
+            metrics_.skipped_ticks.Add((elapsed - delta) / period_);
+            RunHandler(delta);
+            break;
+        }
+        }
+        last_tick_ = now;
+
+        if (Clock::now() > deadline_) {
+            metrics_.overruns.Add();
+        }
+        if (!stopped_) {
             ScheduleTick();
         }
     }
 
-    using Clock = std::chrono::steady_clock;
+    void RunHandler(std::chrono::milliseconds delta) {
+        metrics_.ticks.Add();
+        try {
+            handler_(delta);
+        } catch (const std::exception& ex) {
+            metrics_.handler_errors.Add();
+            if (!error_handler_) {
+                throw;
+            }
+            error_handler_(ex);
+        }
+    }
 
     Strand strand_;
     std::chrono::milliseconds period_;
     net::steady_timer timer_{strand_};
     Handler handler_;
-    std::chrono::steady_clock::time_point last_tick_;
-};
\ No newline at end of file
+    ErrorHandler error_handler_;
+    CatchUpPolicy policy_;
+    Metrics metrics_;
+    Clock::time_point deadline_;
+    Clock::time_point last_tick_;
+    bool stopped_ = false;
+};
@@ -77,12 +77,73 @@ function vec3_mul(v1,s2) {
 const roadEdge = new THREE.MeshPhongMaterial({color: '#AAA'});
 const roadH = 0.55;
 
+// Разбор двоичного состояния игры (формат описан в src/state_encoding.h)
+const binaryStateVersion = 2;
+
+function decodeBinaryState(buffer) {
+  const view = new DataView(buffer);
+  let offset = 0;
+
+  function readByte() {
+    return view.getUint8(offset++);
+  }
+  function readVarint() {
+    let value = 0;
+    let mul = 1;
+    for (;;) {
+      const byte = readByte();
+      value += (byte & 0x7F) * mul;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+      mul *= 128;
+    }
+  }
+  function readFixed() {
+    const value = view.getInt32(offset, true) / 65536;
+    offset += 4;
+    return value;
+  }
+
+  if (readByte() != binaryStateVersion) {
+    throw new Error('Unsupported binary state version');
+  }
+
+  const state = {tick: readVarint(), players: {}, lostObjects: {}};
+
+  const playersCount = readVarint();
+  for (let i = 0; i < playersCount; ++i) {
+    const id = readVarint();
+    const pos = [readFixed(), readFixed()];
+    const speed = [readFixed(), readFixed()];
+    const dir = String.fromCharCode(readByte());
+    const score = readVarint();
+    const bag = [];
+    const bagSize = readVarint();
+    for (let j = 0; j < bagSize; ++j) {
+      bag.push({id: readVarint(), type: readVarint()});
+    }
+    state.players[id] = {pos: pos, speed: speed, dir: dir, bag: bag, score: score};
+  }
+
+  const lootCount = readVarint();
+  for (let i = 0; i < lootCount; ++i) {
+    const id = readVarint();
+    const type = readVarint();
+    state.lostObjects[id] = {type: type, pos: [readFixed(), readFixed()]};
+  }
+
+  return state;
+}
+
 function convDirection(d) {
   const dict = {
     R:Math.PI/2,
     U:Math.PI,
     L:Math.PI*3/2,
-    D:0
+    D:0,
+    // Собака без направления (NONE); в JSON такая собака отдаётся как U
+    N:Math.PI
   };
   return dict[d];
 }
@@ -411,16 +472,27 @@ class GameState {
 
   _updateState(then) {
     let self = this;
-    $.get({
-      url: '/api/v1/game/state',
-      dataType: 'json',
-      beforeSend: function(xhr) {
-        xhr.setRequestHeader("Authorization", "Bearer " + Cookies.get('authToken'));
+    fetch('/api/v1/game/state', {
+      headers: {
+        'Authorization': 'Bearer ' + Cookies.get('authToken'),
+        'Accept': 'application/octet-stream'
       }
-    }).done(function(x){
-      self.desiredState = x;
+    }).then(function(response) {
+      if (!response.ok) {
+        throw new Error('Failed to get game state: ' + response.status);
+      }
+      // Если координаты не помещаются в двоичный формат, сервер отвечает JSON
+      const contentType = response.headers.get('Content-Type') || '';
+      if (contentType.startsWith('application/octet-stream')) {
+        return response.arrayBuffer().then(decodeBinaryState);
+      }
+      return response.json();
+    }).then(function(state) {
+      self.desiredState = state;
       self.stateTime = performance.now();
       then();
+    }).catch(function(err) {
+      console.log(err);
     })
   }
 
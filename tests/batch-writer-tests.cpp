@@ -0,0 +1,236 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/batch_writer.h"
+
+using namespace std::literals;
+
+namespace {
+
+using Writer = util::BatchWriter<int>;
+
+// Запоминает пачки, полученные flush, и позволяет дождаться нужного числа элементов
+class Sink {
+public:
+    void Write(const Writer::Batch& batch) {
+        {
+            std::lock_guard lock{mutex_};
+            batches_.push_back(batch);
+            items_ += batch.size();
+        }
+        cond_.notify_all();
+    }
+
+    bool WaitItems(size_t count) {
+        std::unique_lock lock{mutex_};
+        return cond_.wait_for(lock, 2s, [&] {
+            return items_ >= count;
+        });
+    }
+
+    std::vector<Writer::Batch> GetBatches() const {
+        std::lock_guard lock{mutex_};
+        return batches_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::vector<Writer::Batch> batches_;
+    size_t items_ = 0;
+};
+
+void IgnoreError(const std::exception&) {
+}
+
+}  // namespace
+
+SCENARIO("Background batch writer") {
+    metrics::Registry registry;
+    auto writer_metrics = Writer::RegisterMetrics(registry, "test_writer"s);
+    Sink sink;
+    auto flush = [&sink](const Writer::Batch& batch) {
+        sink.Write(batch);
+    };
+
+    GIVEN("a writer that flushes by size") {
+        std::optional<Writer> writer;
+        writer.emplace(Writer::Config{100, 3, 10s}, flush, IgnoreError, writer_metrics);
+
+        WHEN("more items than a batch are added") {
+            for (int i = 0; i < 7; ++i) {
+                CHECK(writer->Add(i));
+            }
+
+            THEN("full batches are written without waiting for the delay") {
+                REQUIRE(sink.WaitItems(6));
+                CHECK(sink.GetBatches() == std::vector<Writer::Batch>{{0, 1, 2}, {3, 4, 5}});
+                CHECK(writer->GetQueueDepth() == 1);
+            }
+
+            AND_WHEN("the writer is destroyed") {
+                writer.reset();
+
+                THEN("the rest is written and the order is kept") {
+                    CHECK(sink.GetBatches() == std::vector<Writer::Batch>{{0, 1, 2}, {3, 4, 5}, {6}});
+                    CHECK(writer_metrics.written.Get() == 7);
+                    CHECK(writer_metrics.dropped.Get() == 0);
+                    CHECK(writer_metrics.queue_depth.Get() == 0);
+                    CHECK(writer_metrics.flush_duration.GetCount() == 3);
+                }
+            }
+        }
+    }
+
+    GIVEN("a writer that flushes by time") {
+        Writer writer{{100, 100, 20ms}, flush, IgnoreError, writer_metrics};
+
+        WHEN("fewer items than a batch are added") {
+            writer.Add(1);
+            writer.Add(2);
+
+            THEN("they are written after the delay while the writer is running") {
+                REQUIRE(sink.WaitItems(2));
+                CHECK(writer.GetQueueDepth() == 0);
+            }
+        }
+    }
+
+    GIVEN("a flush that fails a few times") {
+        std::vector<std::string> errors;
+        int failures_left = 2;
+        {
+            Writer writer{{100, 2, 10ms, 1ms, 4ms},
+                [&](const Writer::Batch& batch) {
+                    if (failures_left > 0) {
+                        --failures_left;
+                        throw std::runtime_error("connection lost"s);
+                    }
+                    sink.Write(batch);
+                },
+                [&errors](const std::exception& ex) {
+                    errors.emplace_back(ex.what());
+                }, writer_metrics};
+
+            for (int i = 0; i < 4; ++i) {
+                writer.Add(i);
+            }
+            REQUIRE(sink.WaitItems(4));
+        }
+
+        THEN("the failed batch is retried and nothing is lost") {
+            CHECK(errors == std::vector{"connection lost"s, "connection lost"s});
+            CHECK(sink.GetBatches() == std::vector<Writer::Batch>{{0, 1}, {2, 3}});
+            CHECK(writer_metrics.retries.Get() == 2);
+            CHECK(writer_metrics.written.Get() == 4);
+            CHECK(writer_metrics.dropped.Get() == 0);
+        }
+    }
+
+    GIVEN("a flush that always fails") {
+        size_t attempts = 0;
+        {
+            Writer writer{{100, 2, 10ms, 1ms, 2ms},
+                [&attempts](const Writer::Batch&) {
+                    ++attempts;
+                    throw std::runtime_error("connection lost"s);
+                }, IgnoreError, writer_metrics};
+
+            for (int i = 0; i < 4; ++i) {
+                writer.Add(i);
+            }
+        }
+
+        THEN("the queue is dropped after the last attempt on destruction") {
+            CHECK(attempts >= 1);
+            CHECK(writer_metrics.dropped.Get() == 4);
+            CHECK(writer_metrics.written.Get() == 0);
+            CHECK(writer_metrics.queue_depth.Get() == 0);
+        }
+    }
+
+    GIVEN("a flush that rejects one item for good") {
+        std::vector<std::string> errors;
+        {
+            Writer writer{{100, 4, 10s, 1ms, 4ms},
+                [&sink](const Writer::Batch& batch) {
+                    if (std::find(batch.begin(), batch.end(), 2) != batch.end()) {
+                        throw std::invalid_argument("bad item"s);
+                    }
+                    sink.Write(batch);
+                },
+                [&errors](const std::exception& ex) {
+                    errors.emplace_back(ex.what());
+                }, writer_metrics,
+                [](const std::exception& ex) {
+                    return dynamic_cast<const std::invalid_argument*>(&ex) == nullptr;
+                }};
+
+            for (int i = 0; i < 4; ++i) {
+                writer.Add(i);
+            }
+            REQUIRE(sink.WaitItems(3));
+        }
+
+        THEN("the batch is written item by item and only the bad item is dropped") {
+            CHECK(sink.GetBatches() == std::vector<Writer::Batch>{{0}, {1}, {3}});
+            CHECK(errors == std::vector{"bad item"s, "bad item"s});
+            CHECK(writer_metrics.written.Get() == 3);
+            CHECK(writer_metrics.dropped.Get() == 1);
+            CHECK(writer_metrics.retries.Get() == 0);
+        }
+    }
+
+    GIVEN("a writer whose flush is stuck") {
+        std::promise<void> flush_entered;
+        auto entered = flush_entered.get_future();
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        bool first_call = true;
+        std::vector<std::string> errors;
+
+        Writer writer{{2, 1, 0ms},
+            [&](const Writer::Batch& batch) {
+                if (first_call) {
+                    first_call = false;
+                    flush_entered.set_value();
+                }
+                released.wait();
+                sink.Write(batch);
+            },
+            [&errors](const std::exception& ex) {
+                errors.emplace_back(ex.what());
+            }, writer_metrics};
+
+        writer.Add(0);
+        entered.wait();
+
+        WHEN("the queue fills up") {
+            CHECK(writer.Add(1));
+            CHECK(writer.Add(2));
+            const bool accepted = writer.Add(3);
+            writer.Add(4);
+
+            THEN("Add does not wait, drops the items and reports the overflow once") {
+                CHECK_FALSE(accepted);
+                CHECK(writer.GetQueueDepth() == 2);
+                CHECK(writer_metrics.queue_depth.Get() == 2);
+                CHECK(writer_metrics.dropped.Get() == 2);
+                CHECK(errors.size() == 1);
+            }
+
+            release.set_value();
+            REQUIRE(sink.WaitItems(3));
+            CHECK(sink.GetBatches() == std::vector<Writer::Batch>{{0}, {1}, {2}});
+        }
+    }
+}
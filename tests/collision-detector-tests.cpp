@@ -183,4 +183,95 @@ TEST_CASE("Events have correct data") {
     CHECK(event.time >= 0.0);
     CHECK(event.time <= 1.0);
     CHECK(event.sq_distance >= 0.0);
+}
+
+// ============================================================================
+// ТЕСТ 5: Сетка не меняет результат полного перебора
+// ============================================================================
+TEST_CASE("Broadphase grid gives the same events as brute force") {
+    std::vector<collision_detector::Item> items;
+    std::vector<collision_detector::Gatherer> gatherers;
+
+    // Детерминированный разброс предметов и собирателей по карте 100x100
+    uint64_t seed = 42;
+    auto next = [&seed] {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<double>(seed >> 11) / static_cast<double>(1ull << 53);
+    };
+
+    for (int i = 0; i < 500; ++i) {
+        items.push_back({geom::Point2D{next() * 100.0, next() * 100.0}, i % 10 == 0 ? 0.5 : 0.0});
+    }
+    for (int g = 0; g < 200; ++g) {
+        geom::Point2D start{next() * 100.0, next() * 100.0};
+        geom::Point2D end = g % 2 == 0 ? geom::Point2D{start.x + (next() - 0.5) * 10.0, start.y}
+                                       : geom::Point2D{start.x, start.y + (next() - 0.5) * 10.0};
+        gatherers.push_back({start, end, 0.6});
+    }
+
+    std::vector<collision_detector::GatheringEvent> expected;
+    for (size_t g = 0; g < gatherers.size(); ++g) {
+        for (size_t i = 0; i < items.size(); ++i) {
+            auto res = collision_detector::TryCollectPoint(gatherers[g].start_pos, gatherers[g].end_pos, items[i].position);
+            if (res.IsCollected(gatherers[g].width + items[i].width)) {
+                expected.push_back({i, g, res.sq_distance, res.proj_ratio});
+            }
+        }
+    }
+    std::sort(expected.begin(), expected.end(), [](const auto& l, const auto& r) {
+        return l.time < r.time;
+    });
+
+    TestProvider provider(items, gatherers);
+    auto events = collision_detector::FindGatherEvents(provider);
+
+    REQUIRE(!expected.empty());
+    REQUIRE(events.size() == expected.size());
+    for (size_t i = 0; i < events.size(); ++i) {
+        CHECK(EventsEqual(events[i], expected[i]));
+    }
+}
+
+// ============================================================================
+// ТЕСТ 6: Пакетная проверка совпадает с TryCollectPoint
+// ============================================================================
+TEST_CASE("Batched TryCollectPoints matches TryCollectPoint") {
+    uint64_t seed = 7;
+    auto next = [&seed] {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<double>(seed >> 11) / static_cast<double>(1ull << 53);
+    };
+
+    std::vector<double> xs, ys, widths;
+    for (size_t i = 0; i < collision_detector::MAX_BATCH_SIZE; ++i) {
+        xs.push_back(next() * 20.0);
+        ys.push_back(next() * 20.0);
+        widths.push_back(i % 3 == 0 ? 0.5 : 0.0);
+    }
+    const collision_detector::ItemArrays items{xs.data(), ys.data(), widths.data()};
+
+    // Разное число предметов, чтобы задеть и векторную часть, и хвост
+    for (size_t count : {size_t{0}, size_t{1}, size_t{3}, size_t{5}, size_t{17}, collision_detector::MAX_BATCH_SIZE}) {
+        for (int g = 0; g < 20; ++g) {
+            const geom::Point2D a{next() * 20.0, next() * 20.0};
+            const geom::Point2D b = g % 3 == 0 ? geom::Point2D{a.x + 5.0, a.y}
+                                  : g % 3 == 1 ? geom::Point2D{a.x, a.y - 5.0}
+                                               : geom::Point2D{next() * 20.0, next() * 20.0};
+            const double width = 0.6;
+
+            double sq_distance[collision_detector::MAX_BATCH_SIZE];
+            double proj_ratio[collision_detector::MAX_BATCH_SIZE];
+            const uint64_t mask = collision_detector::TryCollectPoints(a, b, width, items, count, sq_distance, proj_ratio);
+
+            for (size_t i = 0; i < count; ++i) {
+                const auto expected = collision_detector::TryCollectPoint(a, b, geom::Point2D{xs[i], ys[i]});
+                CHECK(sq_distance[i] == expected.sq_distance);
+                CHECK(proj_ratio[i] == expected.proj_ratio);
+                CHECK(((mask >> i) & 1) == (expected.IsCollected(width + widths[i]) ? 1u : 0u));
+            }
+            if (count < collision_detector::MAX_BATCH_SIZE) {
+                CHECK((mask >> count) == 0);
+            }
+        }
+    }
 }
\ No newline at end of file
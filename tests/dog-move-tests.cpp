@@ -0,0 +1,88 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/model.h"
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+Map MakeCrossMap() {
+    boost::json::array loot_types;
+    loot_types.push_back(boost::json::object{{"value", 1}});
+
+    // Крест из двух дорог и отрезок, продолжающий горизонтальную дорогу
+    Map map{Map::Id{"cross"s}, "Cross"s, extra_data::ExtraData{loot_types}};
+    map.AddRoad(Road{Road::HORIZONTAL, Point{0, 5}, 10});
+    map.AddRoad(Road{Road::VERTICAL, Point{5, 0}, 10});
+    map.AddRoad(Road{Road::HORIZONTAL, Point{10, 5}, 20});
+    map.BuildRoadIndexes();
+    return map;
+}
+
+}  // namespace
+
+SCENARIO("Dog movement along roads") {
+    GIVEN("a map with crossing roads") {
+        const Map map = MakeCrossMap();
+
+        WHEN("dog moves inside a road") {
+            Dog dog{Dog::Id{0}, "Rex"s, {1.0, 5.0}, 3};
+            dog.SetSpeed({2.0, 0.0});
+            const auto pos = dog.Move(1.0, map);
+
+            THEN("it reaches the target point and keeps speed") {
+                CHECK(pos.x == 3.0);
+                CHECK(pos.y == 5.0);
+                CHECK(dog.GetSpeed().x == 2.0);
+            }
+        }
+
+        WHEN("dog crosses the joint of two adjacent roads") {
+            Dog dog{Dog::Id{0}, "Rex"s, {9.0, 5.0}, 3};
+            dog.SetSpeed({3.0, 0.0});
+            const auto pos = dog.Move(1.0, map);
+
+            THEN("it continues on the next road") {
+                CHECK(pos.x == 12.0);
+                CHECK(pos.y == 5.0);
+            }
+        }
+
+        WHEN("dog runs into the end of a road") {
+            Dog dog{Dog::Id{0}, "Rex"s, {18.0, 5.0}, 3};
+            dog.SetSpeed({5.0, 0.0});
+            const auto pos = dog.Move(1.0, map);
+
+            THEN("it stops at the road border") {
+                CHECK(pos.x == 20.0 + ROAD_WIDTH_HALF);
+                CHECK(pos.y == 5.0);
+                CHECK(dog.GetSpeed().x == 0.0);
+                CHECK(dog.GetSpeed().y == 0.0);
+            }
+        }
+
+        WHEN("dog turns onto the crossing road") {
+            Dog dog{Dog::Id{0}, "Rex"s, {5.0, 5.0}, 3};
+            dog.SetSpeed({0.0, -2.0});
+            const auto pos = dog.Move(1.0, map);
+
+            THEN("it moves along the vertical road") {
+                CHECK(pos.x == 5.0);
+                CHECK(pos.y == 3.0);
+            }
+        }
+
+        WHEN("dog tries to leave the road sideways") {
+            Dog dog{Dog::Id{0}, "Rex"s, {2.0, 5.0}, 3};
+            dog.SetSpeed({0.0, 1.0});
+            const auto pos = dog.Move(1.0, map);
+
+            THEN("it is clamped by the road width") {
+                CHECK(pos.x == 2.0);
+                CHECK(pos.y == 5.0 + ROAD_WIDTH_HALF);
+                CHECK(dog.GetSpeed().y == 0.0);
+            }
+        }
+    }
+}
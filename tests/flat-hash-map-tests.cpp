@@ -0,0 +1,85 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "../src/flat_hash_map.h"
+#include "../src/tagged.h"
+
+using namespace std::literals;
+
+namespace {
+
+struct IdTag {};
+using Id = util::Tagged<uint64_t, IdTag>;
+using IdMap = util::FlatHashMap<Id, std::string, util::TaggedHasher<Id>>;
+
+}  // namespace
+
+SCENARIO("Flat hash map with tagged keys") {
+    GIVEN("an empty map") {
+        IdMap map;
+
+        THEN("nothing is found") {
+            CHECK(map.empty());
+            CHECK(map.find(Id{1}) == map.end());
+            CHECK_FALSE(map.contains(Id{1}));
+            CHECK(map.erase(Id{1}) == 0);
+        }
+
+        WHEN("values are inserted") {
+            CHECK(map.emplace(Id{1}, "one"s).second);
+            CHECK(map.emplace(Id{2}, "two"s).second);
+
+            THEN("a duplicate key keeps the old value") {
+                auto [it, inserted] = map.emplace(Id{1}, "uno"s);
+                CHECK_FALSE(inserted);
+                CHECK(it->second == "one"s);
+                CHECK(map.size() == 2);
+            }
+
+            THEN("values are found by key") {
+                CHECK(map.at(Id{2}) == "two"s);
+                CHECK_THROWS_AS(map.at(Id{3}), std::out_of_range);
+            }
+
+            AND_WHEN("a value is erased through an iterator") {
+                map.erase(map.find(Id{1}));
+
+                THEN("the other value stays reachable") {
+                    CHECK(map.size() == 1);
+                    CHECK_FALSE(map.contains(Id{1}));
+                    CHECK(map.at(Id{2}) == "two"s);
+                }
+            }
+        }
+    }
+
+    GIVEN("random inserts and erases") {
+        IdMap map;
+        std::unordered_map<uint64_t, std::string> reference;
+        std::mt19937_64 random{42};
+
+        for (int i = 0; i < 20000; ++i) {
+            const uint64_t key = random() % 3000;
+            if (random() % 3 == 0) {
+                CHECK(map.erase(Id{key}) == reference.erase(key));
+            } else {
+                map[Id{key}] = std::to_string(i);
+                reference[key] = std::to_string(i);
+            }
+        }
+
+        THEN("the map matches std::unordered_map") {
+            REQUIRE(map.size() == reference.size());
+            for (const auto& [key, value] : reference) {
+                REQUIRE(map.contains(Id{key}));
+                CHECK(map.at(Id{key}) == value);
+            }
+            for (const auto& [id, value] : map) {
+                CHECK(reference.at(*id) == value);
+            }
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <stdexcept>
+
+#include "../src/model.h"
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+Map MakeMap(std::string id, size_t session_capacity) {
+    boost::json::array loot_types;
+    loot_types.push_back(boost::json::object{{"value", 1}});
+
+    Map map{Map::Id{std::move(id)}, "Map"s, extra_data::ExtraData{loot_types}};
+    map.AddRoad(Road{Road::HORIZONTAL, Point{0, 0}, 10});
+    map.SetSessionCapacity(session_capacity);
+    map.BuildRoadIndexes();
+    return map;
+}
+
+}  // namespace
+
+SCENARIO("Session instances are balanced by capacity") {
+    GIVEN("a map limited to two players per session") {
+        Game game;
+        game.AddMap(MakeMap("town"s, 2));
+        const Map::Id map_id{"town"s};
+
+        WHEN("three players join one by one") {
+            auto first = game.FindOrAddGameSession(map_id);
+            first->AddDog("Rex"s, false);
+            auto second = game.FindOrAddGameSession(map_id);
+            second->AddDog("Max"s, false);
+            auto third = game.FindOrAddGameSession(map_id);
+            third->AddDog("Bim"s, false);
+
+            THEN("a new instance is started when the first one is full") {
+                CHECK(first == second);
+                CHECK(third != first);
+                CHECK(game.GetSessions().size() == 2);
+            }
+
+            THEN("session ids are distinct from the map id") {
+                CHECK(*first->GetId() != *map_id);
+                CHECK(*third->GetId() != *first->GetId());
+                CHECK(game.FindGameSession(third->GetId()) == third);
+                CHECK(first->GetMap().GetId() == map_id);
+            }
+
+            AND_WHEN("a player leaves the first instance") {
+                first->DeletePlayer(first->GetDogs().begin()->second);
+                auto next = game.FindOrAddGameSession(map_id);
+
+                THEN("the least loaded instance is chosen") {
+                    CHECK(next->GetDogs().size() == 1);
+                    CHECK(game.GetSessions().size() == 2);
+                }
+            }
+        }
+    }
+
+    GIVEN("a map without a limit") {
+        Game game;
+        game.AddMap(MakeMap("field"s, 0));
+        const Map::Id map_id{"field"s};
+
+        THEN("all players share one session") {
+            auto session = game.FindOrAddGameSession(map_id);
+            for (int i = 0; i < 10; ++i) {
+                session->AddDog("Rex"s, false);
+            }
+            CHECK(game.FindOrAddGameSession(map_id) == session);
+            CHECK(game.GetSessions().size() == 1);
+        }
+
+        THEN("an unknown map has no sessions") {
+            CHECK(game.FindOrAddGameSession(Map::Id{"unknown"s}) == nullptr);
+        }
+    }
+}
+
+SCENARIO("Dog handles after players leave") {
+    GIVEN("a session with three dogs") {
+        const Map map = MakeMap("town"s, 10);
+        GameSession session{GameSession::Id{"town"s}, map, lootGeneratorConfig{5.0, 0.0}, 60.0};
+        auto first = session.AddDog("Rex"s, false);
+        auto second = session.AddDog("Max"s, false);
+        auto third = session.AddDog("Rocky"s, false);
+        third->SetPosition({7.0, 0.0});
+
+        WHEN("a dog in the middle of the store leaves") {
+            session.DeletePlayer(first);
+
+            THEN("the remaining handles still find their dogs") {
+                CHECK(second->GetName() == "Max"s);
+                CHECK(third->GetName() == "Rocky"s);
+                CHECK(third->GetPosition().x == 7.0);
+            }
+
+            THEN("the handle of the removed dog throws instead of reading someone else's data") {
+                CHECK(first->GetId() == Dog::Id{0});
+                CHECK_THROWS_AS(first->GetName(), std::out_of_range);
+                CHECK_THROWS_AS(first->SetSpeed({1.0, 0.0}), std::out_of_range);
+            }
+        }
+    }
+}
@@ -0,0 +1,217 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/model.h"
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+Map MakeRoadMap() {
+    boost::json::array loot_types;
+    loot_types.push_back(boost::json::object{{"value", 1}});
+
+    Map map{Map::Id{"road"s}, "Road"s, extra_data::ExtraData{loot_types}};
+    map.AddRoad(Road{Road::HORIZONTAL, Point{0, 0}, 10});
+    map.SetBagCapacity(1);
+    map.BuildRoadIndexes();
+    return map;
+}
+
+}  // namespace
+
+SCENARIO("Loot collection during a tick") {
+    GIVEN("two dogs running over the same loot") {
+        const Map map = MakeRoadMap();
+        GameSession session{GameSession::Id{"road"s}, map, lootGeneratorConfig{5.0, 0.0}, 60.0};
+
+        auto first = session.AddDog("Rex"s, false);
+        auto second = session.AddDog("Max"s, false);
+        first->SetSpeed({5.0, 0.0});
+        second->SetSpeed({5.0, 0.0});
+
+        session.AddLoot(Loot{Position{2.0, 0.0}, Loot::Id{0}, 0});
+        session.AddLoot(Loot{Position{3.0, 0.0}, Loot::Id{1}, 0});
+
+        WHEN("the session is updated") {
+            session.UpdateState(1s);
+
+            THEN("each loot is picked up only once") {
+                CHECK(session.GetLoot().Empty());
+                CHECK(first->GetItemsFromBag().size() == 1);
+                CHECK(second->GetItemsFromBag().size() == 1);
+                CHECK(first->GetItemsFromBag().front().id != second->GetItemsFromBag().front().id);
+            }
+
+            THEN("the published snapshot reflects the tick") {
+                const auto state = session.GetGameState();
+                CHECK(state->loots.empty());
+                REQUIRE(state->dogs.size() == 2);
+                for (const auto& dog : state->dogs) {
+                    CHECK(dog.position.x == 5.0);
+                    CHECK(dog.bag.size() == 1);
+                }
+            }
+
+            THEN("older snapshots stay unchanged") {
+                const auto before = session.GetGameState();
+                session.AddDog("Rocky"s, false);
+                session.UpdateState(1ms);
+                CHECK(before->dogs.size() == 2);
+                CHECK(session.GetGameState()->dogs.size() == 3);
+            }
+        }
+    }
+}
+
+SCENARIO("Published state snapshots") {
+    GIVEN("a session with a dog") {
+        const Map map = MakeRoadMap();
+        GameSession session{GameSession::Id{"road"s}, map, lootGeneratorConfig{5.0, 0.0}, 60.0};
+        session.AddDog("Rex"s, false);
+        session.PublishState();
+
+        WHEN("the session is updated") {
+            const auto before = session.GetGameState();
+            session.UpdateState(100ms);
+            const auto after = session.GetGameState();
+
+            THEN("a snapshot with a new tick is published") {
+                CHECK(after != before);
+                CHECK(after->tick > before->tick);
+                CHECK(*after->session_id == "road"s);
+            }
+        }
+
+        WHEN("players join and leave between ticks") {
+            const auto before = session.GetGameState();
+            auto dog = session.AddDog("Max"s, false);
+            session.AddDog("Rocky"s, false);
+            session.DeletePlayer(dog);
+
+            THEN("nothing is published until the end of the tick") {
+                CHECK(session.GetGameState() == before);
+            }
+
+            AND_WHEN("the tick ends") {
+                session.UpdateState(100ms);
+                const auto after = session.GetGameState();
+
+                THEN("all changes come in one snapshot numbered by the tick") {
+                    CHECK(after->tick == before->tick + 1);
+                    CHECK(after->version == before->version + 1);
+                    CHECK(after->dogs.size() == 2);
+                }
+            }
+
+            AND_WHEN("the state is published again before the tick") {
+                session.PublishState();
+                const auto after = session.GetGameState();
+
+                THEN("the snapshot keeps the tick number and gets a new version") {
+                    CHECK(after->tick == before->tick);
+                    CHECK(after->version == before->version + 1);
+                    CHECK(after->dogs.size() == 2);
+                }
+            }
+        }
+
+        WHEN("the frame of a snapshot is requested several times") {
+            const auto state = session.GetGameState();
+            int renders = 0;
+            auto render = [&renders](const GameSession::GameStateData& data) {
+                ++renders;
+                return std::to_string(data.dogs.size());
+            };
+
+            const auto format = GameSession::GameStateData::FrameFormat::JSON;
+            const std::string& first = state->GetFrame(format, render);
+            const std::string& second = state->GetFrame(format, render);
+
+            THEN("it is rendered only once") {
+                CHECK(renders == 1);
+                CHECK(first == "1");
+                CHECK(&first == &second);
+            }
+        }
+    }
+}
+
+SCENARIO("State deltas between snapshots") {
+    GIVEN("a session with a moving dog, a resting dog and loot") {
+        const Map map = MakeRoadMap();
+        GameSession session{GameSession::Id{"road"s}, map, lootGeneratorConfig{5.0, 0.0}, 60.0};
+
+        auto runner = session.AddDog("Rex"s, false);
+        auto resting = session.AddDog("Max"s, false);
+        session.AddLoot(Loot{Position{2.0, 0.0}, Loot::Id{0}, 0});
+        session.AddLoot(Loot{Position{9.0, 0.0}, Loot::Id{1}, 0});
+        session.PublishState();
+        runner->SetSpeed({5.0, 0.0});
+
+        const uint64_t base = session.GetGameState()->version;
+
+        WHEN("a tick passes") {
+            session.UpdateState(1s);
+            const auto delta = session.GetGameStateDelta(base);
+
+            THEN("only the changed dog and the collected loot are reported") {
+                CHECK_FALSE(delta.full);
+                CHECK(delta.since == base);
+                CHECK(delta.version == session.GetGameState()->version);
+                CHECK(delta.tick == session.GetGameState()->tick);
+                REQUIRE(delta.dogs.size() == 1);
+                CHECK(delta.dogs.front().id == runner->GetId());
+                CHECK(delta.loots.empty());
+                REQUIRE(delta.removed_loots.size() == 1);
+                CHECK(delta.removed_loots.front() == Loot::Id{0});
+                CHECK(delta.removed_dogs.empty());
+            }
+        }
+
+        WHEN("several publications pass") {
+            session.UpdateState(1s);
+            auto newcomer = session.AddDog("Rocky"s, false);
+            session.PublishState();
+            session.DeletePlayer(resting);
+            session.UpdateState(1s);
+            const auto delta = session.GetGameStateDelta(base);
+
+            THEN("their changes are combined") {
+                CHECK_FALSE(delta.full);
+                CHECK(delta.version == base + 3);
+                REQUIRE(delta.dogs.size() == 2);
+                CHECK(delta.dogs[0].id == runner->GetId());
+                CHECK(delta.dogs[1].id == newcomer->GetId());
+                CHECK(delta.removed_dogs == std::vector<Dog::Id>{Dog::Id{1}});
+                CHECK(delta.removed_loots == std::vector<Loot::Id>{Loot::Id{0}});
+                CHECK(delta.loots.empty());
+            }
+        }
+
+        WHEN("the client is up to date") {
+            const auto delta = session.GetGameStateDelta(base);
+
+            THEN("the delta is empty") {
+                CHECK_FALSE(delta.full);
+                CHECK(delta.dogs.empty());
+                CHECK(delta.removed_dogs.empty());
+                CHECK(delta.loots.empty());
+                CHECK(delta.removed_loots.empty());
+            }
+        }
+
+        WHEN("the base snapshot is too old") {
+            for (size_t i = 0; i <= GameSession::STATE_JOURNAL_SIZE; ++i) {
+                session.UpdateState(10ms);
+            }
+            const auto delta = session.GetGameStateDelta(base);
+
+            THEN("the full state is returned") {
+                CHECK(delta.full);
+                CHECK(delta.dogs.size() == 2);
+                CHECK(delta.loots.size() == session.GetLoot().Size());
+            }
+        }
+    }
+}
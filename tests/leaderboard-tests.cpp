@@ -0,0 +1,106 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+#include "../src/leaderboard.h"
+
+using namespace std::literals;
+
+namespace {
+
+struct Record {
+    std::string name;
+    int score;
+
+    bool operator==(const Record&) const = default;
+};
+
+struct ByScore {
+    bool operator()(const Record& lhs, const Record& rhs) const {
+        return lhs.score > rhs.score;
+    }
+    bool operator()(int score, const Record& rhs) const {
+        return score > rhs.score;
+    }
+};
+
+using Board = util::Leaderboard<Record, ByScore>;
+
+}  // namespace
+
+SCENARIO("In-memory leaderboard") {
+    GIVEN("a leaderboard warmed with a full top") {
+        Board board{3};
+        board.Reset({{"a"s, 50}, {"b"s, 40}, {"c"s, 30}});
+
+        THEN("windows inside the top are served from memory") {
+            CHECK(board.Find(0, 3) == std::vector<Record>{{"a"s, 50}, {"b"s, 40}, {"c"s, 30}});
+            CHECK(board.Find(1, 1) == std::vector<Record>{{"b"s, 40}});
+            CHECK(board.Find(3, 0) == std::vector<Record>{});
+        }
+
+        THEN("windows beyond the top fall through to the database") {
+            CHECK_FALSE(board.Find(2, 2));
+            CHECK_FALSE(board.Find(5, 1));
+        }
+
+        THEN("windows after a key are served from memory while they fit in the top") {
+            CHECK(board.FindAfter(50, 2) == std::vector<Record>{{"b"s, 40}, {"c"s, 30}});
+            CHECK(board.FindAfter(45, 1) == std::vector<Record>{{"b"s, 40}});
+            CHECK(board.FindAfter(100, 1) == std::vector<Record>{{"a"s, 50}});
+            CHECK_FALSE(board.FindAfter(40, 2));
+            CHECK_FALSE(board.FindAfter(30, 1));
+        }
+
+        WHEN("a record better than the last one is added") {
+            board.Add({{"d"s, 45}});
+
+            THEN("it takes its place and the last one is evicted") {
+                CHECK(board.Find(0, 3) == std::vector<Record>{{"a"s, 50}, {"d"s, 45}, {"b"s, 40}});
+                CHECK_FALSE(board.Find(0, 4));
+            }
+        }
+
+        WHEN("a record below the top is added") {
+            board.Add({{"e"s, 10}});
+
+            THEN("the top does not change") {
+                CHECK(board.Find(0, 3) == std::vector<Record>{{"a"s, 50}, {"b"s, 40}, {"c"s, 30}});
+            }
+        }
+
+        WHEN("records with the same score are added") {
+            board.Add({{"f"s, 40}, {"g"s, 40}});
+
+            THEN("they go after the ones already there") {
+                CHECK(board.Find(0, 3) == std::vector<Record>{{"a"s, 50}, {"b"s, 40}, {"f"s, 40}});
+            }
+        }
+    }
+
+    GIVEN("a leaderboard holding the whole table") {
+        Board board{3};
+        board.Reset({{"a"s, 50}});
+
+        THEN("any window is served from memory") {
+            CHECK(board.Find(0, 10) == std::vector<Record>{{"a"s, 50}});
+            CHECK(board.Find(5, 10) == std::vector<Record>{});
+        }
+
+        WHEN("the table grows up to the capacity") {
+            board.Add({{"b"s, 20}, {"c"s, 30}});
+
+            THEN("memory still covers the whole table") {
+                CHECK(board.Find(0, 10) == std::vector<Record>{{"a"s, 50}, {"c"s, 30}, {"b"s, 20}});
+            }
+
+            board.Add({{"d"s, 10}});
+
+            THEN("after one more record windows beyond the top fall through to the database") {
+                CHECK(board.Find(0, 3) == std::vector<Record>{{"a"s, 50}, {"c"s, 30}, {"b"s, 20}});
+                CHECK_FALSE(board.Find(0, 10));
+            }
+        }
+    }
+}
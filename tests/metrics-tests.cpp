@@ -0,0 +1,115 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/metrics.h"
+
+using namespace std::literals;
+
+SCENARIO("Log-linear histogram buckets") {
+    using metrics::Histogram;
+
+    GIVEN("consecutive values") {
+        THEN("small values get their own buckets") {
+            for (uint64_t value = 0; value < Histogram::SUB_BUCKETS; ++value) {
+                CHECK(Histogram::BucketIndex(value) == value);
+                CHECK(Histogram::BucketUpperBound(value) == value);
+            }
+        }
+
+        THEN("each value is not above the upper bound of its bucket and above the previous one") {
+            for (uint64_t value = 1; value < 100000; value += 7) {
+                const size_t index = Histogram::BucketIndex(value);
+                CHECK(value <= Histogram::BucketUpperBound(index));
+                CHECK(value > Histogram::BucketUpperBound(index - 1));
+            }
+        }
+
+        THEN("relative bucket width does not exceed one sub-bucket") {
+            for (size_t index = Histogram::SUB_BUCKETS; index < Histogram::BUCKET_COUNT; ++index) {
+                const uint64_t lower = Histogram::BucketUpperBound(index - 1) + 1;
+                const uint64_t upper = Histogram::BucketUpperBound(index);
+                CHECK((upper - lower + 1) * Histogram::SUB_BUCKETS <= lower);
+            }
+        }
+
+        THEN("values above the range go to the last bucket") {
+            CHECK(Histogram::BucketIndex(Histogram::MaxValue()) == Histogram::BUCKET_COUNT - 1);
+            CHECK(Histogram::BucketIndex(Histogram::MaxValue() * 4) == Histogram::BUCKET_COUNT - 1);
+        }
+    }
+}
+
+SCENARIO("Histogram percentiles") {
+    GIVEN("a histogram with values 1..1000 microseconds") {
+        metrics::Histogram histogram;
+        for (uint64_t value = 1; value <= 1000; ++value) {
+            histogram.Record(value);
+        }
+
+        THEN("count and sum are exact") {
+            CHECK(histogram.GetCount() == 1000);
+            CHECK(histogram.GetSum() == 500500);
+        }
+
+        THEN("percentiles are within the bucket precision") {
+            for (double p : {0.5, 0.9, 0.99, 0.999}) {
+                const double expected = p * 1000;
+                const auto actual = static_cast<double>(histogram.Percentile(p));
+                CHECK(actual >= expected);
+                CHECK(actual <= expected * (1.0 + 1.0 / metrics::Histogram::SUB_BUCKETS) + 1);
+            }
+        }
+    }
+
+    GIVEN("durations recorded from several threads") {
+        metrics::Histogram histogram;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([&histogram] {
+                for (int j = 0; j < 10000; ++j) {
+                    histogram.Record(std::chrono::milliseconds(2));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        THEN("no records are lost") {
+            CHECK(histogram.GetCount() == 40000);
+            CHECK(histogram.GetSum() == 40000 * 2000);
+        }
+    }
+}
+
+SCENARIO("Prometheus text format") {
+    GIVEN("a registry with a counter, a gauge and a labeled histogram") {
+        metrics::Registry registry;
+        registry.AddCounter("requests_total"sv, "Requests"sv).Add(3);
+        registry.AddGauge("dogs"sv, "Dogs"sv).Set(7);
+        auto& fast = registry.AddHistogram("latency_seconds"sv, "Latency"sv, {{"route"s, "/a"s}});
+        registry.AddHistogram("latency_seconds"sv, {}, {{"route"s, "/b"s}});
+        fast.Record(3);
+        fast.Record(1000);
+
+        const std::string text = registry.SerializePrometheus();
+
+        THEN("each family is described once") {
+            CHECK(text.find("# TYPE requests_total counter\nrequests_total 3\n"s) != std::string::npos);
+            CHECK(text.find("# TYPE dogs gauge\ndogs 7\n"s) != std::string::npos);
+            CHECK(text.find("# TYPE latency_seconds histogram\n"s) != std::string::npos);
+            CHECK(text.find("# HELP latency_seconds") == text.rfind("# HELP latency_seconds"));
+        }
+
+        THEN("histogram buckets are cumulative and in seconds") {
+            CHECK(text.find("latency_seconds_bucket{route=\"/a\",le=\"3e-06\"} 1\n"s) != std::string::npos);
+            CHECK(text.find("latency_seconds_bucket{route=\"/a\",le=\"0.001023\"} 2\n"s) != std::string::npos);
+            CHECK(text.find("latency_seconds_bucket{route=\"/a\",le=\"+Inf\"} 2\n"s) != std::string::npos);
+            CHECK(text.find("latency_seconds_sum{route=\"/a\"} 0.001003\n"s) != std::string::npos);
+            CHECK(text.find("latency_seconds_count{route=\"/b\"} 0\n"s) != std::string::npos);
+        }
+    }
+}
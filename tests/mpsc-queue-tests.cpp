@@ -0,0 +1,90 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/mpsc_queue.h"
+
+using namespace std::literals;
+
+SCENARIO("Multi-producer single-consumer queue") {
+    GIVEN("an empty queue") {
+        util::MpscQueue<std::string> queue;
+
+        THEN("nothing can be popped") {
+            CHECK(queue.Empty());
+            CHECK_FALSE(queue.Pop());
+        }
+
+        WHEN("values are pushed from one thread") {
+            queue.Push("a"s);
+            queue.Push("b"s);
+            queue.Push("c"s);
+
+            THEN("they are popped in the same order") {
+                CHECK_FALSE(queue.Empty());
+                CHECK(queue.Pop() == "a"s);
+                CHECK(queue.Pop() == "b"s);
+                CHECK(queue.Pop() == "c"s);
+                CHECK_FALSE(queue.Pop());
+                CHECK(queue.Empty());
+            }
+        }
+    }
+
+    GIVEN("a queue destroyed with values inside") {
+        auto value = std::make_shared<int>(1);
+        {
+            util::MpscQueue<std::shared_ptr<int>> queue;
+            queue.Push(value);
+            queue.Push(value);
+            CHECK(value.use_count() == 3);
+        }
+
+        THEN("the values are released") {
+            CHECK(value.use_count() == 1);
+        }
+    }
+
+    GIVEN("several producers and a concurrent consumer") {
+        constexpr int PRODUCERS = 4;
+        constexpr int VALUES_PER_PRODUCER = 50000;
+
+        struct Item {
+            int producer;
+            int value;
+        };
+        util::MpscQueue<Item> queue;
+
+        std::vector<std::thread> producers;
+        for (int producer = 0; producer < PRODUCERS; ++producer) {
+            producers.emplace_back([&queue, producer] {
+                for (int value = 0; value < VALUES_PER_PRODUCER; ++value) {
+                    queue.Push({producer, value});
+                }
+            });
+        }
+
+        std::vector<int> next_value(PRODUCERS, 0);
+        bool ordered = true;
+        int received = 0;
+        while (received < PRODUCERS * VALUES_PER_PRODUCER) {
+            if (auto item = queue.Pop()) {
+                ordered = ordered && item->value == next_value[item->producer];
+                next_value[item->producer] = item->value + 1;
+                ++received;
+            }
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+
+        THEN("every value arrives once and in the order of its producer") {
+            CHECK(ordered);
+            CHECK(next_value == std::vector<int>(PRODUCERS, VALUES_PER_PRODUCER));
+            CHECK_FALSE(queue.Pop());
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <sstream>
+
+#include "../src/replay.h"
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+Game MakeGame(uint64_t seed) {
+    boost::json::array loot_types;
+    loot_types.push_back(boost::json::object{{"value", 1}});
+    loot_types.push_back(boost::json::object{{"value", 3}});
+
+    Map map{Map::Id{"town"s}, "Town"s, extra_data::ExtraData{loot_types}};
+    map.AddRoad(Road{Road::HORIZONTAL, Point{0, 0}, 40});
+    map.AddRoad(Road{Road::VERTICAL, Point{20, 0}, 30});
+    map.AddOffice(Office{Office::Id{"o"s}, Point{20, 30}, Offset{0, 0}});
+    map.SetDogSpeed(3.0);
+    map.SetSessionCapacity(2);
+    map.BuildRoadIndexes();
+
+    Game game;
+    game.SetLootGenConfig(lootGeneratorConfig{1.0, 1.0});
+    game.SetRandomSeed(seed);
+    game.AddMap(std::move(map));
+    return game;
+}
+
+// Играет короткую партию, записывая её в журнал
+std::string PlayAndRecord(Game& game) {
+    std::ostringstream out;
+    replay::JournalWriter writer(out, game.GetRandomSeed());
+    replay::ReplayDriver driver(game);
+
+    const auto join = [&](std::string name) {
+        writer.RecordJoin(Map::Id{"town"s}, name, true);
+        driver.Apply(replay::JoinEvent{Map::Id{"town"s}, std::move(name), true});
+    };
+    const auto tick = [&](std::chrono::milliseconds delta) {
+        writer.RecordTick(delta);
+        driver.Apply(replay::TickEvent{delta});
+    };
+
+    join("Rex"s);
+    join("Max"s);
+    join("Bim Bom"s);
+    tick(500ms);
+
+    for (const auto& [id, session] : game.GetSessions()) {
+        for (const auto& [dog_id, dog] : session->GetDogs()) {
+            const replay::ActionEvent action{id, dog_id, Speed{3.0, 0.0}, Direction::EAST};
+            writer.RecordAction(action.session_id, action.dog_id, action.speed, action.direction);
+            driver.Apply(action);
+        }
+    }
+    for (int i = 0; i < 20; ++i) {
+        tick(100ms);
+    }
+    return out.str();
+}
+
+}  // namespace
+
+SCENARIO("Input journal replay") {
+    GIVEN("a recorded game") {
+        Game live = MakeGame(42);
+        const std::string recorded = PlayAndRecord(live);
+
+        std::istringstream in(recorded);
+        const auto journal = replay::ReadJournal(in);
+
+        THEN("the journal keeps the seed and all events") {
+            CHECK(journal.seed == 42);
+            CHECK(journal.events.size() == 3 + 1 + 3 + 20);
+            CHECK(std::get<replay::JoinEvent>(journal.events[2]).name == "Bim Bom"s);
+        }
+
+        WHEN("it is replayed on a fresh game") {
+            Game replayed = MakeGame(0);
+            replay::ReplayDriver driver(replayed);
+            driver.Run(journal);
+
+            THEN("the world is reproduced exactly") {
+                CHECK(replayed.GetSessions().size() == 2);
+                CHECK(driver.GetTickTimes().size() == 21);
+                CHECK(replay::StateChecksum(replayed) == replay::StateChecksum(live));
+            }
+        }
+
+        WHEN("the same inputs run with another seed") {
+            Game other = MakeGame(43);
+            PlayAndRecord(other);
+
+            THEN("the world differs") {
+                CHECK(replay::StateChecksum(other) != replay::StateChecksum(live));
+            }
+        }
+    }
+
+    GIVEN("a damaged journal") {
+        std::istringstream in("journal 1 5\ntick -3\n"s);
+
+        THEN("reading fails") {
+            CHECK_THROWS_AS(replay::ReadJournal(in), std::runtime_error);
+        }
+    }
+}
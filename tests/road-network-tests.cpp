@@ -0,0 +1,129 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/model.h"
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+Map MakeMap() {
+    boost::json::array loot_types;
+    loot_types.push_back(boost::json::object{{"value", 1}});
+    return Map{Map::Id{"map"s}, "Map"s, extra_data::ExtraData{loot_types}};
+}
+
+}  // namespace
+
+SCENARIO("Road network normalization") {
+    GIVEN("a map with overlapping and touching colinear roads") {
+        Map map = MakeMap();
+        map.AddRoad(Road{Road::HORIZONTAL, Point{0, 0}, 10});
+        map.AddRoad(Road{Road::HORIZONTAL, Point{15, 0}, 5});
+        map.AddRoad(Road{Road::HORIZONTAL, Point{15, 0}, 20});
+        map.AddRoad(Road{Road::HORIZONTAL, Point{22, 0}, 30});
+        map.AddRoad(Road{Road::VERTICAL, Point{10, 0}, 10});
+        map.AddRoad(Road{Road::VERTICAL, Point{10, 3}, 7});
+
+        WHEN("road indexes are built") {
+            map.BuildRoadIndexes();
+
+            THEN("raw roads are kept as loaded") {
+                CHECK(map.GetRoads().size() == 6);
+            }
+
+            THEN("colinear segments are merged") {
+                const auto& network = map.GetRoadNetwork();
+                REQUIRE(network.size() == 3);
+
+                CHECK(network[0].GetStart().x == 0);
+                CHECK(network[0].GetEnd().x == 20);
+                CHECK(network[1].GetStart().x == 22);
+                CHECK(network[1].GetEnd().x == 30);
+                CHECK(network[2].GetStart().y == 0);
+                CHECK(network[2].GetEnd().y == 10);
+
+                CHECK(map.GetHorizontalRoadsByY().size() == 2);
+                CHECK(map.GetVerticalRoadsByX().size() == 1);
+            }
+        }
+    }
+}
+
+SCENARIO("Road junction graph") {
+    GIVEN("a map with a cross and a T-junction") {
+        Map map = MakeMap();
+        map.AddRoad(Road{Road::HORIZONTAL, Point{0, 5}, 10});
+        map.AddRoad(Road{Road::VERTICAL, Point{5, 0}, 10});
+        map.AddRoad(Road{Road::VERTICAL, Point{10, 5}, 0});
+        map.BuildRoadIndexes();
+
+        const auto& graph = map.GetRoadGraph();
+
+        THEN("nodes are road ends and intersections") {
+            // (0,5) (5,0) (5,5) (5,10) (10,0) (10,5)
+            CHECK(graph.GetNodes().size() == 6);
+            CHECK(graph.FindNode(Point{5, 5}).has_value());
+            CHECK(graph.FindNode(Point{10, 5}).has_value());
+            CHECK_FALSE(graph.FindNode(Point{3, 5}).has_value());
+        }
+
+        THEN("edges split roads at junctions") {
+            CHECK(graph.GetEdges().size() == 5);
+
+            const auto center = *graph.FindNode(Point{5, 5});
+            CHECK(graph.GetNodeEdges(center).size() == 4);
+
+            const auto corner = *graph.FindNode(Point{10, 5});
+            CHECK(graph.GetNodeEdges(corner).size() == 2);
+
+            size_t total_length = 0;
+            for (const auto& edge : graph.GetEdges()) {
+                total_length += edge.length;
+            }
+            CHECK(total_length == 25);
+        }
+    }
+}
+
+SCENARIO("Road lookup by point") {
+    GIVEN("several roads on the same lines") {
+        Map map = MakeMap();
+        map.AddRoad(Road{Road::HORIZONTAL, Point{0, 0}, 10});
+        map.AddRoad(Road{Road::HORIZONTAL, Point{12, 0}, 20});
+        map.AddRoad(Road{Road::HORIZONTAL, Point{0, 1}, 20});
+        map.AddRoad(Road{Road::VERTICAL, Point{5, 0}, 10});
+        map.AddRoad(Road{Road::VERTICAL, Point{5, 12}, 20});
+        map.BuildRoadIndexes();
+
+        const auto& network = map.GetRoadNetwork();
+
+        THEN("a point is found on the road of its line that covers it") {
+            const auto* road = map.FindHorizontalRoad(Position{15.0, 0.3});
+            REQUIRE(road != nullptr);
+            CHECK(network[road->road_idx].GetStart().x == 12);
+            CHECK(network[road->road_idx].GetStart().y == 0);
+
+            road = map.FindHorizontalRoad(Position{10.4, -0.4});
+            REQUIRE(road != nullptr);
+            CHECK(network[road->road_idx].GetEnd().x == 10);
+
+            road = map.FindHorizontalRoad(Position{15.0, 0.7});
+            REQUIRE(road != nullptr);
+            CHECK(network[road->road_idx].GetStart().y == 1);
+
+            road = map.FindVerticalRoad(Position{5.2, 15.0});
+            REQUIRE(road != nullptr);
+            CHECK(network[road->road_idx].GetStart().y == 12);
+        }
+
+        THEN("points between roads and between lines are not on a road") {
+            CHECK(map.FindHorizontalRoad(Position{11.0, 0.0}) == nullptr);
+            CHECK(map.FindHorizontalRoad(Position{21.0, 1.0}) == nullptr);
+            CHECK(map.FindHorizontalRoad(Position{5.0, 0.5}) == nullptr);
+            CHECK(map.FindHorizontalRoad(Position{5.0, 2.0}) == nullptr);
+            CHECK(map.FindVerticalRoad(Position{5.0, 11.0}) == nullptr);
+            CHECK(map.FindVerticalRoad(Position{4.5, 5.0}) == nullptr);
+        }
+    }
+}
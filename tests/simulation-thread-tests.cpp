@@ -0,0 +1,117 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/simulation_thread.h"
+
+using namespace std::literals;
+
+SCENARIO("Simulation thread") {
+    GIVEN("a running simulation thread without ticks") {
+        util::SimulationThread simulation;
+        simulation.Start();
+
+        WHEN("commands are posted from several threads") {
+            constexpr int PRODUCERS = 4;
+            constexpr int COMMANDS_PER_PRODUCER = 1000;
+
+            // Счётчик меняется только в потоке симуляции, поэтому не атомарный
+            int executed = 0;
+            std::thread::id simulation_thread;
+            bool single_thread = true;
+
+            std::vector<std::thread> producers;
+            for (int i = 0; i < PRODUCERS; ++i) {
+                producers.emplace_back([&] {
+                    for (int j = 0; j < COMMANDS_PER_PRODUCER; ++j) {
+                        simulation.Post([&] {
+                            if (executed++ == 0) {
+                                simulation_thread = std::this_thread::get_id();
+                            }
+                            single_thread = single_thread && simulation_thread == std::this_thread::get_id();
+                        });
+                    }
+                });
+            }
+            for (auto& producer : producers) {
+                producer.join();
+            }
+            simulation.Stop();
+
+            THEN("all of them run on the simulation thread") {
+                CHECK(executed == PRODUCERS * COMMANDS_PER_PRODUCER);
+                CHECK(single_thread);
+                CHECK(simulation_thread != std::this_thread::get_id());
+            }
+        }
+
+        WHEN("a command is posted between ticks") {
+            std::promise<int> result;
+            simulation.Post([&result] {
+                result.set_value(42);
+            });
+
+            THEN("it runs without waiting for a tick") {
+                auto future = result.get_future();
+                REQUIRE(future.wait_for(1s) == std::future_status::ready);
+                CHECK(future.get() == 42);
+            }
+        }
+    }
+
+    GIVEN("a simulation thread with ticks") {
+        metrics::Registry registry;
+        util::SimulationThread simulation;
+
+        std::vector<std::string> events;
+        std::promise<void> done;
+        simulation.StartTicker(10ms, [&](std::chrono::milliseconds) {
+            events.push_back("tick"s);
+            if (events.size() == 1) {
+                // Команда, поставленная во время тика, выполняется после него и до следующего тика
+                simulation.Post([&] {
+                    events.push_back("command"s);
+                });
+            }
+            if (events.size() == 4) {
+                done.set_value();
+            }
+        }, Ticker::CatchUpPolicy::SKIP, Ticker::RegisterMetrics(registry));
+        simulation.Start();
+
+        auto future = done.get_future();
+        REQUIRE(future.wait_for(5s) == std::future_status::ready);
+        simulation.Stop();
+
+        THEN("commands and ticks are serialized") {
+            REQUIRE(events.size() >= 3);
+            CHECK(events[0] == "tick"s);
+            CHECK(events[1] == "command"s);
+            CHECK(events[2] == "tick"s);
+        }
+    }
+
+    GIVEN("a command that throws") {
+        util::SimulationThread simulation;
+        std::promise<std::string> error;
+        simulation.SetErrorHandler([&error](const std::exception& ex) {
+            error.set_value(ex.what());
+        });
+        simulation.Start();
+        simulation.Post([] {
+            throw std::runtime_error("command failed");
+        });
+
+        THEN("the error handler receives it") {
+            auto future = error.get_future();
+            REQUIRE(future.wait_for(1s) == std::future_status::ready);
+            CHECK(future.get() == "command failed"s);
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+#include "../src/slot_map.h"
+
+using namespace std::literals;
+
+SCENARIO("Slot map with generational handles") {
+    GIVEN("a slot map with three values") {
+        util::SlotMap<std::string> values;
+        const auto a = values.Insert("a"s);
+        const auto b = values.Insert("b"s);
+        const auto c = values.Insert("c"s);
+
+        THEN("values are reachable by handles") {
+            CHECK(values.Size() == 3);
+            REQUIRE(values.Find(b));
+            CHECK(*values.Find(b) == "b"s);
+        }
+
+        WHEN("a value in the middle is removed") {
+            CHECK(values.Remove(a));
+
+            THEN("the remaining values stay contiguous and reachable") {
+                CHECK(values.Size() == 2);
+                CHECK_FALSE(values.Contains(a));
+                CHECK(*values.Find(b) == "b"s);
+                CHECK(*values.Find(c) == "c"s);
+
+                for (size_t i = 0; i < values.Size(); ++i) {
+                    CHECK(*values.Find(values.GetHandle(i)) == values.GetValues()[i]);
+                }
+            }
+
+            THEN("removing it again fails") {
+                CHECK_FALSE(values.Remove(a));
+            }
+
+            AND_WHEN("a new value reuses the freed slot") {
+                const auto d = values.Insert("d"s);
+
+                THEN("the stale handle does not see the new value") {
+                    CHECK(d.index == a.index);
+                    CHECK_FALSE(values.Contains(a));
+                    CHECK(values.Find(a) == nullptr);
+                    CHECK(*values.Find(d) == "d"s);
+                    CHECK(values.SlotCount() == 3);
+                }
+            }
+        }
+
+        WHEN("the map is cleared") {
+            values.Clear();
+
+            THEN("no handle stays valid") {
+                CHECK(values.Empty());
+                CHECK_FALSE(values.Contains(a));
+                CHECK_FALSE(values.Contains(b));
+                CHECK_FALSE(values.Contains(c));
+                CHECK(values.begin() == values.end());
+            }
+        }
+    }
+}
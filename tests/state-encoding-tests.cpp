@@ -0,0 +1,108 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/state_encoding.h"
+
+#include <cmath>
+
+using namespace model;
+using namespace state_encoding;
+using namespace std::literals;
+
+namespace {
+
+GameSession::GameStatePtr MakeState() {
+    auto state = std::make_shared<GameSession::GameStateData>();
+    state->tick = 300;
+
+    GameSession::DogState dog{Dog::Id{1}, "Rex"s, {10.5, 3.25}, {-2.5, 0.0}, Direction::WEST, {}, 130};
+    dog.bag.push_back({Loot::Id{7}, 2});
+    state->dogs.push_back(dog);
+    state->dogs.push_back({Dog::Id{200}, "Max"s, {0.0, 0.4}, {0.0, 0.0}, Direction::SOUTH, {}, 0});
+
+    state->loots.push_back({Loot::Id{3}, 1, {4.0, 17.125}});
+    return state;
+}
+
+}  // namespace
+
+SCENARIO("Binary state encoding") {
+    GIVEN("a state snapshot") {
+        const auto state = MakeState();
+
+        WHEN("it is encoded and decoded") {
+            const std::string data = EncodeBinary(*state);
+            const auto decoded = DecodeBinary(data);
+
+            THEN("the frame starts with the format version") {
+                CHECK(static_cast<uint8_t>(data.front()) == BINARY_VERSION);
+            }
+
+            THEN("all fields survive with 16.16 precision") {
+                CHECK(decoded->tick == 300);
+                REQUIRE(decoded->dogs.size() == 2);
+
+                const auto& rex = decoded->dogs[0];
+                CHECK(rex.id == Dog::Id{1});
+                CHECK(rex.position.x == 10.5);
+                CHECK(rex.position.y == 3.25);
+                CHECK(rex.speed.x == -2.5);
+                CHECK(rex.direction == Direction::WEST);
+                CHECK(rex.score == 130);
+                REQUIRE(rex.bag.size() == 1);
+                CHECK(rex.bag[0].id == Loot::Id{7});
+                CHECK(rex.bag[0].type == 2);
+
+                const auto& max = decoded->dogs[1];
+                CHECK(max.id == Dog::Id{200});
+                CHECK(std::abs(max.position.y - 0.4) <= 1.0 / FIXED_POINT_SCALE);
+                CHECK(max.direction == Direction::SOUTH);
+
+                REQUIRE(decoded->loots.size() == 1);
+                CHECK(decoded->loots[0].id == Loot::Id{3});
+                CHECK(decoded->loots[0].type == 1);
+                CHECK(decoded->loots[0].position.y == 17.125);
+            }
+        }
+
+        WHEN("the frame is truncated") {
+            const std::string data = EncodeBinary(*state);
+
+            THEN("decoding fails") {
+                CHECK_THROWS_AS(DecodeBinary(std::string_view(data).substr(0, data.size() - 1)), std::invalid_argument);
+            }
+        }
+    }
+
+    GIVEN("varint values") {
+        THEN("small values take one byte and large values take more") {
+            std::string out;
+            WriteVarint(out, 127);
+            CHECK(out.size() == 1);
+            out.clear();
+            WriteVarint(out, 128);
+            CHECK(out == "\x80\x01"s);
+        }
+    }
+
+    GIVEN("a dog standing still") {
+        GameSession::GameStateData still;
+        still.dogs.push_back({Dog::Id{1}, "Rex"s, {1.0, 2.0}, {0.0, 0.0}, Direction::NONE, {}, 0});
+        still.dogs.push_back({Dog::Id{2}, "Max"s, {1.0, 2.0}, {0.0, 0.0}, Direction::NORTH, {}, 0});
+
+        THEN("no direction and north are decoded differently") {
+            const auto decoded = DecodeBinary(EncodeBinary(still));
+            CHECK(decoded->dogs[0].direction == Direction::NONE);
+            CHECK(decoded->dogs[1].direction == Direction::NORTH);
+        }
+    }
+
+    GIVEN("coordinates outside the 16.16 range") {
+        THEN("encoding fails instead of wrapping around") {
+            std::string out;
+            CHECK_NOTHROW(WriteFixed(out, -32768.0));
+            CHECK_THROWS_AS(WriteFixed(out, 32768.0), std::out_of_range);
+            CHECK_THROWS_AS(WriteFixed(out, -40000.0), std::out_of_range);
+            CHECK_THROWS_AS(WriteFixed(out, std::nan("")), std::out_of_range);
+        }
+    }
+}
@@ -18,6 +18,21 @@ struct Fixture {
     OutputArchive output_archive{strm};
 };
 
+Game MakeGame(uint64_t seed) {
+    boost::json::array loot_types;
+    loot_types.push_back(boost::json::object{{"value", 1}});
+
+    Map map{Map::Id{"town"s}, "Town"s, extra_data::ExtraData{loot_types}};
+    map.AddRoad(Road{Road::HORIZONTAL, Point{0, 0}, 100});
+    map.AddRoad(Road{Road::VERTICAL, Point{0, 0}, 100});
+    map.BuildRoadIndexes();
+
+    Game game;
+    game.AddMap(std::move(map));
+    game.SetRandomSeed(seed);
+    return game;
+}
+
 }  // namespace
 
 SCENARIO_METHOD(Fixture, "Point serialization") {
@@ -85,3 +100,45 @@ SCENARIO_METHOD(Fixture, "Dog Serialization") {
         }
     }
 }
+
+SCENARIO_METHOD(Fixture, "Game session serialization") {
+    GIVEN("a session that has already used its random generator") {
+        Game game = MakeGame(42);
+        auto session = game.FindOrAddGameSession(Map::Id{"town"s});
+        session->AddDog("Rex"s, true);
+        session->UpdateState(100ms);
+        session->UpdateState(100ms);
+
+        WHEN("the session is serialized and restored") {
+            {
+                serialization::GameSessionRepr repr{*session};
+                output_archive << repr;
+            }
+            Game restored_game = MakeGame(7);
+            InputArchive input_archive{strm};
+            serialization::GameSessionRepr repr;
+            input_archive >> repr;
+            auto restored = repr.Restore(restored_game);
+
+            THEN("the random sequence continues from the same place") {
+                for (int i = 0; i < 5; ++i) {
+                    const auto expected = session->AddDog("Dog"s, true)->GetPosition();
+                    const auto actual = restored->AddDog("Dog"s, true)->GetPosition();
+                    CHECK(expected.x == actual.x);
+                    CHECK(expected.y == actual.y);
+                }
+            }
+
+            THEN("tick and version numbers continue after the restore") {
+                CHECK(restored->GetGameState()->tick == 2);
+                const uint64_t version = restored->GetGameState()->version;
+                CHECK(version > session->GetGameState()->version);
+                // Журнал изменений не сохраняется, клиент со старым номером получает всё
+                CHECK(restored->GetGameStateDelta(session->GetGameState()->version).full);
+                restored->UpdateState(100ms);
+                CHECK(restored->GetGameState()->tick == 3);
+                CHECK(restored->GetGameState()->version == version + 1);
+            }
+        }
+    }
+}
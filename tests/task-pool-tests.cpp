@@ -0,0 +1,70 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/task_pool.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace util;
+
+SCENARIO("Task pool runs every task once") {
+    GIVEN("a pool with helper threads") {
+        TaskPool pool{3};
+
+        WHEN("many tasks are submitted") {
+            std::vector<int> visits(1000, 0);
+            pool.ParallelFor(visits.size(), [&](size_t idx) {
+                ++visits[idx];
+            });
+
+            THEN("each task is executed exactly once") {
+                for (int count : visits) {
+                    CHECK(count == 1);
+                }
+            }
+        }
+
+        WHEN("the pool is reused for several rounds") {
+            std::atomic<size_t> sum = 0;
+            for (int round = 0; round < 100; ++round) {
+                pool.ParallelFor(10, [&](size_t idx) {
+                    sum += idx;
+                });
+            }
+
+            THEN("no round is lost") {
+                CHECK(sum == 100 * 45);
+            }
+        }
+
+        WHEN("a task throws") {
+            std::atomic<size_t> executed = 0;
+            auto run = [&] {
+                pool.ParallelFor(50, [&](size_t idx) {
+                    ++executed;
+                    if (idx == 7) {
+                        throw std::runtime_error("task failed");
+                    }
+                });
+            };
+
+            THEN("the exception is rethrown after all tasks are done") {
+                CHECK_THROWS_AS(run(), std::runtime_error);
+                CHECK(executed == 50);
+            }
+        }
+    }
+
+    GIVEN("a pool without helpers") {
+        TaskPool pool{0};
+
+        THEN("tasks run sequentially in the calling thread") {
+            std::vector<size_t> order;
+            pool.ParallelFor(5, [&](size_t idx) {
+                order.push_back(idx);
+            });
+            CHECK(order == std::vector<size_t>{0, 1, 2, 3, 4});
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../src/ticker.h"
+
+using namespace std::literals;
+
+namespace {
+
+constexpr auto PERIOD = 20ms;
+// Обработчик второго тика задерживает следующий примерно на 2.5 периода
+constexpr auto SLOW_TICK = 70ms;
+constexpr size_t TICK_COUNT = 8;
+
+struct TickerRun {
+    std::vector<std::chrono::milliseconds> deltas;
+    Ticker::Stats stats;
+};
+
+// Запускает тикер, пока обработчик не будет вызван TICK_COUNT раз
+TickerRun RunTicker(Ticker::CatchUpPolicy policy) {
+    metrics::Registry registry;
+    net::io_context ioc;
+    // Тикер владеет таймером, поэтому должен быть разрушен раньше io_context
+    std::shared_ptr<Ticker> ticker;
+
+    TickerRun run;
+    ticker = std::make_shared<Ticker>(net::make_strand(ioc), PERIOD, [&](std::chrono::milliseconds delta) {
+        run.deltas.push_back(delta);
+        if (run.deltas.size() == 2) {
+            std::this_thread::sleep_for(SLOW_TICK);
+        }
+        if (run.deltas.size() == TICK_COUNT) {
+            ticker->Stop();
+        }
+    }, policy, Ticker::RegisterMetrics(registry));
+    ticker->Start();
+    ioc.run();
+
+    run.stats = ticker->GetStats();
+    return run;
+}
+
+}  // namespace
+
+SCENARIO("Fixed-step ticker") {
+    GIVEN("a ticker that skips missed periods") {
+        const auto [deltas, stats] = RunTicker(Ticker::CatchUpPolicy::SKIP);
+
+        THEN("every tick advances the game by one period and missed periods are counted") {
+            REQUIRE(deltas.size() == TICK_COUNT);
+            for (auto delta : deltas) {
+                CHECK(delta == PERIOD);
+            }
+            CHECK(stats.ticks == TICK_COUNT);
+            CHECK(stats.overruns >= 1);
+            CHECK(stats.skipped_ticks >= 2);
+            CHECK(stats.max_lateness >= SLOW_TICK - PERIOD);
+        }
+    }
+
+    GIVEN("a ticker that runs sub-steps for missed periods") {
+        const auto [deltas, stats] = RunTicker(Ticker::CatchUpPolicy::SUB_STEP);
+
+        THEN("missed periods are caught up with regular steps") {
+            REQUIRE(deltas.size() == TICK_COUNT);
+            for (auto delta : deltas) {
+                CHECK(delta == PERIOD);
+            }
+            CHECK(stats.overruns >= 1);
+            CHECK(stats.skipped_ticks == 0);
+        }
+    }
+
+    GIVEN("a ticker that clamps the step") {
+        const auto [deltas, stats] = RunTicker(Ticker::CatchUpPolicy::CLAMP);
+
+        THEN("the late tick gets a longer step no longer than the limit") {
+            REQUIRE(deltas.size() == TICK_COUNT);
+            CHECK(deltas[2] >= SLOW_TICK);
+            CHECK(deltas[2] <= PERIOD * Ticker::MAX_CATCH_UP_STEPS);
+        }
+    }
+
+    GIVEN("a ticker whose handler throws") {
+        metrics::Registry registry;
+        net::io_context ioc;
+        std::shared_ptr<Ticker> ticker;
+        size_t calls = 0;
+        std::vector<std::string> errors;
+        ticker = std::make_shared<Ticker>(net::make_strand(ioc), PERIOD, [&](std::chrono::milliseconds) {
+            if (++calls == 3) {
+                ticker->Stop();
+            }
+            throw std::runtime_error("tick failed");
+        }, Ticker::CatchUpPolicy::SKIP, Ticker::RegisterMetrics(registry));
+        ticker->SetErrorHandler([&](const std::exception& ex) {
+            errors.push_back(ex.what());
+        });
+        ticker->Start();
+        ioc.run();
+
+        const auto stats = ticker->GetStats();
+        ticker.reset();
+
+        THEN("errors are reported and ticking goes on") {
+            CHECK(calls == 3);
+            CHECK(errors.size() == 3);
+            CHECK(stats.handler_errors == 3);
+        }
+    }
+}